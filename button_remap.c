@@ -0,0 +1,77 @@
+// PSP-EmulatedControllerTest
+// Button remapping stage of the input pipeline. See button_remap.h.
+//
+// Ryan Crosby 2025
+
+#include "button_remap.h"
+#include "config.h"
+#include "common.h"
+
+// The tables are double buffered. A new remap is compiled into the inactive set, which is then published
+// by swapping the active pointer, so the callback never sees a half built table.
+static ButtonRemapTables g_button_remap_tables[2];
+ButtonRemapTables * volatile g_button_remap_active = NULL;
+
+static const ButtonRemap g_button_remap_defaults[] = {
+    BUTTON_REMAP_DEFAULTS
+    { 0, 0 }
+};
+
+void button_remap_build(const u32 map[32])
+{
+    bool identity = true;
+
+    for(u32 bit = 0; bit < 32; bit++) {
+        if(map[bit] != (1u << bit)) {
+            identity = false;
+            break;
+        }
+    }
+
+    if(identity) {
+        g_button_remap_active = NULL;
+        return;
+    }
+
+    ButtonRemapTables *tables = g_button_remap_active == &g_button_remap_tables[0] ? &g_button_remap_tables[1] : &g_button_remap_tables[0];
+
+    for(u32 byte = 0; byte < 4; byte++) {
+        u32 *lut = tables->lut[byte];
+        const u32 *byte_map = &map[byte * 8];
+
+        // Each entry is the entry with its lowest set bit cleared, plus the mapping of that bit
+        lut[0] = 0;
+        for(u32 value = 1; value < 256; value++) {
+            // Allegrex has clz but no ctz
+            u32 lowest_bit = 31 - __builtin_clz(value & -value);
+            lut[value] = lut[value & (value - 1)] | byte_map[lowest_bit];
+        }
+    }
+
+    MEMORY_BARRIER();
+    g_button_remap_active = tables;
+}
+
+void button_remap_build_from_list(const ButtonRemap *remaps)
+{
+    u32 map[32];
+
+    for(u32 bit = 0; bit < 32; bit++) {
+        map[bit] = 1u << bit;
+    }
+
+    for(; remaps->from != 0; remaps++) {
+        for(u32 bit = 0; bit < 32; bit++) {
+            if(remaps->from & (1u << bit)) {
+                map[bit] = remaps->to;
+            }
+        }
+    }
+
+    button_remap_build(map);
+}
+
+void button_remap_build_defaults(void)
+{
+    button_remap_build_from_list(g_button_remap_defaults);
+}
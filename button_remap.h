@@ -0,0 +1,51 @@
+// PSP-EmulatedControllerTest
+// Button remapping stage of the input pipeline.
+//
+// Ryan Crosby 2025
+//
+// A remap is compiled into four tables, one per byte of the buttons word. Each entry is the OR of the
+// remapped buttons for every bit set in that byte, so remapping any set of buttons is four loads and three ORs.
+
+#ifndef BUTTON_REMAP_H
+#define BUTTON_REMAP_H
+
+#include "ctrl_imports.h"
+
+typedef struct {
+    u32 lut[4][256];
+} ButtonRemapTables;
+
+typedef struct {
+    u32 from;
+    u32 to;
+} ButtonRemap;
+
+// The tables the controller callback remaps with. NULL while no remap is configured, which skips the lookups entirely.
+extern ButtonRemapTables * volatile g_button_remap_active;
+
+// Compiles map, where map[i] holds the buttons produced by button bit i, into the inactive tables and publishes them.
+// Only called with the configuration writer lock held, or before the controller callback is registered.
+void button_remap_build(const u32 map[32]);
+
+// Builds the remap from a { from, to } list terminated by a zero from.
+void button_remap_build_from_list(const ButtonRemap *remaps);
+
+// Builds the BUTTON_REMAP_DEFAULTS remap. Called once before the controller callback is registered.
+void button_remap_build_defaults(void);
+
+static inline
+u32 remap_buttons(u32 buttons)
+{
+    const ButtonRemapTables *tables = g_button_remap_active;
+
+    if(tables == NULL) {
+        return buttons;
+    }
+
+    return tables->lut[0][buttons & 0xFF]
+        | tables->lut[1][(buttons >> 8) & 0xFF]
+        | tables->lut[2][(buttons >> 16) & 0xFF]
+        | tables->lut[3][buttons >> 24];
+}
+
+#endif /* BUTTON_REMAP_H */
@@ -0,0 +1,70 @@
+// PSP-EmulatedControllerTest
+// Definitions shared by the plugin's source files.
+//
+// Ryan Crosby 2025
+
+#ifndef COMMON_H
+#define COMMON_H
+
+#include "ctrl_imports.h"
+
+#ifdef DEBUG
+#include <pspdebug.h>
+#endif
+
+#include <stdbool.h>
+
+#define str(s) #s // For stringizing defines
+#define xstr(s) str(s)
+
+#ifdef DEBUG
+#define DEBUG_PRINT(...) pspDebugScreenKprintf( __VA_ARGS__ )
+#else
+#define DEBUG_PRINT(...) do{ } while ( 0 )
+#endif
+
+// https://github.com/uofw/uofw/blob/7ca6ba13966a38667fa7c5c30a428ccd248186cf/include/common/errors.h
+#define SCE_ERROR_OK                                0x0
+#define SCE_ERROR_BUSY                              0x80000021
+#define SCE_ERROR_NOT_SUPPORTED                     0x80000004
+#define SCE_ERROR_PRIV_REQUIRED                     0x80000023
+#define SCE_ERROR_INVALID_POINTER                   0x80000103
+#define SCE_ERROR_INVALID_SIZE                      0x80000104
+#define SCE_ERROR_INVALID_VALUE                     0x800001FE
+
+// Orders the surrounding memory accesses, for both the compiler and the CPU.
+#if defined(__mips__)
+#define MEMORY_BARRIER() __asm__ __volatile__("sync" ::: "memory")
+#else
+// The host build, see host/
+#define MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+// Copies size bytes a word at a time, without relying on memcpy() being available.
+// Both buffers must be word aligned, and size a multiple of 4. The source is read through a volatile
+// pointer, so the copy is never merged with the barriers around it.
+static inline
+void copy_words(void *dst, const volatile void *src, u32 size)
+{
+    u32 *d = (u32 *)dst;
+    const volatile u32 *s = (const volatile u32 *)src;
+
+    for(u32 i = 0; i < size / sizeof(u32); i++) {
+        d[i] = s[i];
+    }
+}
+
+// Expands f(i) for every i in [0, 255], as a comma separated initializer list.
+#define LUT16(f, base) \
+    f((base) + 0x0), f((base) + 0x1), f((base) + 0x2), f((base) + 0x3), \
+    f((base) + 0x4), f((base) + 0x5), f((base) + 0x6), f((base) + 0x7), \
+    f((base) + 0x8), f((base) + 0x9), f((base) + 0xA), f((base) + 0xB), \
+    f((base) + 0xC), f((base) + 0xD), f((base) + 0xE), f((base) + 0xF)
+
+#define LUT256(f) \
+    LUT16(f, 0x00), LUT16(f, 0x10), LUT16(f, 0x20), LUT16(f, 0x30), \
+    LUT16(f, 0x40), LUT16(f, 0x50), LUT16(f, 0x60), LUT16(f, 0x70), \
+    LUT16(f, 0x80), LUT16(f, 0x90), LUT16(f, 0xA0), LUT16(f, 0xB0), \
+    LUT16(f, 0xC0), LUT16(f, 0xD0), LUT16(f, 0xE0), LUT16(f, 0xF0)
+
+#endif /* COMMON_H */
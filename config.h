@@ -0,0 +1,250 @@
+// PSP-EmulatedControllerTest
+// Compile-time configuration of the plugin.
+//
+// Ryan Crosby 2025
+//
+// This only holds preprocessor definitions, so it can be included by any of the plugin's source files,
+// imports.S included.
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#define ONE_MSEC (1000)
+
+#define TIMER_PERIOD (10 * ONE_MSEC)
+
+// The stages of the input pipeline that runs on every poll, in pipeline order. Each is compiled in (1) or out (0),
+// so the controller callback only contains the enabled stages, with no function pointers and no checks
+// for disabled stages left in it.
+// * PIPELINE_DIRECTIONS: The PSP stick drives the D-pad, through the direction thresholds and deadzones.
+// * PIPELINE_CURVES: The PSP stick drives the emulated sticks, through their response curves.
+// * PIPELINE_REMAP: Button remapping.
+// * PIPELINE_TURBO: Turbo.
+// * PIPELINE_PRESSURE: Pressure synthesis.
+//
+// The injected input source and the port output are always part of the pipeline. Tilt synthesis is
+// a stage too, enabled by TILT_SOURCE, and recording is the last stage, enabled by INPUT_TRACE_MODE.
+// If no enabled stage reads the PSP stick, the PSP controller isn't sampled at all.
+#define PIPELINE_DIRECTIONS (1)
+#define PIPELINE_CURVES (1)
+#define PIPELINE_REMAP (1)
+#define PIPELINE_TURBO (1)
+#define PIPELINE_PRESSURE (1)
+
+// Skips the pipeline on idle polls: no injected input and the PSP stick within CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN,
+// once the previous poll settled every stage. The idle frame is written directly instead, which gives the same result.
+// Not available with TILT_SOURCE_STICK, or with direction thresholds inside the center error margin.
+#define PIPELINE_IDLE_FAST_PATH (1)
+
+// How the stick bytes are handled by the pipeline.
+// * 1: All four stick bytes (aX, aY, rX, rY) are loaded, compared, merged and stored as a single word.
+// * 0: Each stick byte is handled on its own. This is the scalar reference the word path is checked against.
+#define STICK_SWAR (1)
+
+// Whether every poll is timed, for emuCtrlGetPollStats(). See EmuCtrlPollStats in emu_ctrl.h for what is measured.
+#define POLL_STATS (1)
+
+// Response curves of the emulated port's stick axes. The emulated left stick (aX/aY) and right stick (rX/rY)
+// are both driven by the PSP analog stick, through one curve per axis. See AxisCurve for the settings.
+//
+// The emulated left stick stays centered, since the PSP stick already drives the D-pad, and the emulated right
+// stick mirrors the PSP stick. AXIS_CURVE_AX and AXIS_CURVE_AY must be AXIS_CURVE_CENTER, or module_start()
+// fails: with either backend the driver merges the output left stick back over the PSP stick the callback reads.
+#define AXIS_CURVE_AX { .type = AXIS_CURVE_CENTER }
+#define AXIS_CURVE_AY { .type = AXIS_CURVE_CENTER }
+#define AXIS_CURVE_RX { .type = AXIS_CURVE_LINEAR, .invert = true }
+#define AXIS_CURVE_RY { .type = AXIS_CURVE_LINEAR, .invert = true }
+
+// Button remaps applied to the buttons of the emulated port, as a list of { from, to } entries.
+// Each entry makes the from button report as the to buttons instead. Buttons without an entry report as themselves.
+// These are the defaults, emuCtrlSetButtonRemap() replaces them at runtime.
+//
+// Example, swap Cross and Circle and move L1/R1 onto the L/R triggers:
+//     { SCE_CTRL_CROSS, SCE_CTRL_CIRCLE }, { SCE_CTRL_CIRCLE, SCE_CTRL_CROSS },
+//     { SCE_CTRL_L1TRIGGER, SCE_CTRL_LTRIGGER }, { SCE_CTRL_R1TRIGGER, SCE_CTRL_RTRIGGER },
+#define BUTTON_REMAP_DEFAULTS
+
+// Turbo (rapid fire) settings applied to the buttons of the emulated port, as a list of
+// { buttons, on polls, off polls } entries. While held, the buttons alternate between being reported
+// for on polls and being suppressed for off polls, starting with on. Both periods are 1 - TURBO_MAX_PERIOD.
+// These are the defaults, emuCtrlSetTurbo() changes them at runtime.
+//
+// Example, fire Square at 10Hz with a 60Hz sampling cycle:
+//     { SCE_CTRL_SQUARE, 3, 3 },
+#define TURBO_DEFAULTS
+
+// Pressure reported for the emulated port's pressure sensitive buttons, for titles that read the DS3 pressure fields.
+//
+// D-pad directions produced by the PSP stick report a pressure that follows the stick deflection, from
+// DPAD_PRESSURE_MIN at the direction threshold to 255 at full deflection. D-pad directions without any
+// stick deflection behind them (injected or remapped) report full pressure.
+//
+// Face and shoulder buttons are digital on the PSP, so their pressure ramps up while they are held:
+// BUTTON_PRESSURE_RAMP_START on the first poll, rising by BUTTON_PRESSURE_RAMP_STEP every poll after that up to 255.
+// Set BUTTON_PRESSURE_RAMP_START to 255 to report full pressure straight away. All values are 1 - 255.
+#define DPAD_PRESSURE_MIN (64)
+#define BUTTON_PRESSURE_RAMP_START (96)
+#define BUTTON_PRESSURE_RAMP_STEP (32)
+
+// Where the DS3 tilt values (TiltA for the x-axis, TiltB for the y-axis) of the emulated port come from.
+// Can be either:
+// * TILT_SOURCE_NONE: Tilt is only reported if it is injected.
+// * TILT_SOURCE_STICK: The PSP analog stick tilts the emulated controller.
+// * TILT_SOURCE_BUTTONS: The PSP buttons set by TILT_BUTTON_* tilt the emulated controller fully in their direction.
+#define TILT_SOURCE_NONE (0)
+#define TILT_SOURCE_STICK (1)
+#define TILT_SOURCE_BUTTONS (2)
+#define TILT_SOURCE TILT_SOURCE_NONE
+
+// TILT_SOURCE_BUTTONS only: The PSP buttons that tilt the emulated controller.
+#define TILT_BUTTON_LEFT SCE_CTRL_LEFT
+#define TILT_BUTTON_RIGHT SCE_CTRL_RIGHT
+#define TILT_BUTTON_UP SCE_CTRL_UP
+#define TILT_BUTTON_DOWN SCE_CTRL_DOWN
+
+// The tilt value reported at full tilt, in either direction. The tilt at rest is 0.
+#define TILT_FULL_SCALE (511)
+
+// The tilt is smoothed by a low-pass filter of TILT_FILTER_ORDER (1 or 2) identical stages. Every poll each
+// stage moves 1 / 2^TILT_FILTER_SHIFT of the way towards its input, so larger shifts give slower, smoother motion.
+//
+// With a shift of 2 and two stages a full step reaches 90% in 14 polls, and is within a count of its target after 28.
+#define TILT_FILTER_ORDER (2)
+#define TILT_FILTER_SHIFT (2)
+
+// What the plugin does with input traces.
+// Can be either:
+// * INPUT_TRACE_MODE_OFF
+// * INPUT_TRACE_MODE_RECORD: Every frame produced for the emulated port is recorded to INPUT_TRACE_PATH.
+// * INPUT_TRACE_MODE_REPLAY: The emulated port replays INPUT_TRACE_PATH instead of translating the live stick.
+#define INPUT_TRACE_MODE_OFF (0)
+#define INPUT_TRACE_MODE_RECORD (1)
+#define INPUT_TRACE_MODE_REPLAY (2)
+#define INPUT_TRACE_MODE INPUT_TRACE_MODE_OFF
+
+// The input trace file. See input_trace.h for the format.
+#define INPUT_TRACE_PATH "ms0:/SEPLUGINS/emu_ctrl_input.trc"
+
+// The port whose frames are recorded or replayed. Must be one of CONTROLLER_PORTS.
+#define INPUT_TRACE_PORT SCE_CTRL_PORT_DS3
+
+// The size of each Memory Stick read or write of the input trace.
+#define INPUT_TRACE_CHUNK_SIZE (32 * 1024)
+
+// How the plugin manages the sampling cycle, the interval at which the ctrl driver samples the PSP's controls and
+// polls the emulated ports. The cycle also paces the app's own sceCtrlReadBuffer*() calls, so the policy is
+// picked by the kind of app running.
+// Can be either:
+// * SAMPLING_CYCLE_POLICY_APP: The cycle is left as the app sets it.
+// * SAMPLING_CYCLE_POLICY_LOW_LATENCY: SAMPLING_CYCLE_FAST while there is input, and the app's cycle once
+//   there has been none for SAMPLING_CYCLE_IDLE_TIMEOUT.
+// * SAMPLING_CYCLE_POLICY_POWER_SAVING: The app's cycle while there is input, and SAMPLING_CYCLE_SLOW once
+//   there has been none for SAMPLING_CYCLE_IDLE_TIMEOUT.
+//
+// Input is any output of an emulated port other than centered sticks, noted by the controller callback as it
+// polls, or the PSP's user buttons or stick outside CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN when the policy is
+// checked. If the app changes the cycle while it is managed, the new cycle becomes the app's cycle. The app's
+// cycle is restored when the plugin stops.
+//
+// Every kind of app is left at SAMPLING_CYCLE_POLICY_APP by default. Even the longest cycle only samples
+// about 17% less often than the VBlank-synced cycle most apps use, which is not worth second guessing the app for.
+#define SAMPLING_CYCLE_POLICY_APP (0)
+#define SAMPLING_CYCLE_POLICY_LOW_LATENCY (1)
+#define SAMPLING_CYCLE_POLICY_POWER_SAVING (2)
+
+// The policy for the XMB, for PSP games and homebrew, and for PS1 games.
+#define SAMPLING_CYCLE_POLICY_VSH SAMPLING_CYCLE_POLICY_APP
+#define SAMPLING_CYCLE_POLICY_GAME SAMPLING_CYCLE_POLICY_APP
+#define SAMPLING_CYCLE_POLICY_POPS SAMPLING_CYCLE_POLICY_APP
+
+// The sampling cycles the policies switch to, in microseconds. Each is either 5555 - 20000, or 0 to sample on
+// every VBlank (about 16683us).
+#define SAMPLING_CYCLE_FAST (5555)
+#define SAMPLING_CYCLE_SLOW (20000)
+
+// How long there must be no input before the policy switches to its idle cycle.
+#define SAMPLING_CYCLE_IDLE_TIMEOUT (3000 * ONE_MSEC)
+
+// How often the main thread checks for input and switches the cycle. Input resuming after an idle stretch
+// takes up to this long to bring back the active cycle. Should be a multiple of TIMER_PERIOD.
+#define SAMPLING_CYCLE_CHECK_PERIOD (250 * ONE_MSEC)
+
+// Whether any kind of app has its sampling cycle managed.
+#if SAMPLING_CYCLE_POLICY_VSH != SAMPLING_CYCLE_POLICY_APP || SAMPLING_CYCLE_POLICY_GAME != SAMPLING_CYCLE_POLICY_APP \
+    || SAMPLING_CYCLE_POLICY_POPS != SAMPLING_CYCLE_POLICY_APP
+#define SAMPLING_CYCLE_MANAGED (1)
+#else
+#define SAMPLING_CYCLE_MANAGED (0)
+#endif
+
+// How the output of the emulated ports reaches the ctrl driver.
+// Can be either:
+// * INJECTION_BACKEND_PORT_HANDLER: Each port is registered as an external port input source with
+//   sceCtrl_driver_E467BEC8(). The driver calls the controller callback every sampling cycle, and passes the
+//   output through into the emulation slot with the port's index.
+// * INJECTION_BACKEND_EMULATION_SLOTS: A thread runs the controller callback itself every EMULATION_SLOT_PERIOD,
+//   and writes the output into the same emulation slots with sceCtrlSetButtonEmulation() and
+//   sceCtrlSetAnalogEmulation(). For firmwares or titles where the external port path is unavailable.
+//   Only the buttons and the left stick reach the driver, since the slots don't carry the rest of SceCtrlData2,
+//   and the left stick only while it is off center, so the slot doesn't hold the PSP stick the callback reads.
+#define INJECTION_BACKEND_PORT_HANDLER (0)
+#define INJECTION_BACKEND_EMULATION_SLOTS (1)
+#define INJECTION_BACKEND INJECTION_BACKEND_PORT_HANDLER
+
+// INJECTION_BACKEND_EMULATION_SLOTS only: How often the emulation slots are updated, in microseconds,
+// or 0 to update them on every VBlank.
+#define EMULATION_SLOT_PERIOD (0)
+
+// INJECTION_BACKEND_EMULATION_SLOTS only: How many samples the ctrl driver applies each update for. This has to
+// cover every sample until the next update, including a late one: at a 5555us sampling cycle there are three
+// samples per VBlank. If the thread stops updating, the slots expire after this many samples.
+#define EMULATION_SLOT_DURATION (8)
+
+// The controller ports for which to handle input, as a mask of CONTROLLER_PORT_BIT() values for:
+// * SCE_CTRL_PORT_DS3
+// * SCE_CTRL_PORT_UNKNOWN_2
+//
+// Each port has its own input source for other modules to feed, and its own translation state.
+#define CONTROLLER_PORT_BIT(port) (1 << ((port) - 1))
+#define CONTROLLER_PORTS (CONTROLLER_PORT_BIT(SCE_CTRL_PORT_DS3))
+
+// The ports out of CONTROLLER_PORTS that are driven by the PSP's own controls, on top of their injected input.
+// The remaining ports only report injected input.
+#define CONTROLLER_PSP_INPUT_PORTS (CONTROLLER_PORT_BIT(SCE_CTRL_PORT_DS3))
+
+// The smallest offset from the analog stick's center position defining the guaranteed
+// range (center position +/- this offset) the stick returns to when being released.
+//
+// This is the same value used within the firmware to register analogue input and cancel the idle timer.
+//
+#define CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN (37)
+
+// The minimum amount of stick movement from center to register as a directional input.
+#define ANALOG_PAD_DIRECTION_THRESHOLD (CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN + 23)
+
+// Once a direction is registered, the amount of stick movement from center below which it is released again.
+// Keeping this below ANALOG_PAD_DIRECTION_THRESHOLD stops a stick resting near the threshold from
+// chattering the D-pad on and off between polls. Set it equal to ANALOG_PAD_DIRECTION_THRESHOLD to disable hysteresis.
+#define ANALOG_PAD_DIRECTION_RELEASE_THRESHOLD (ANALOG_PAD_DIRECTION_THRESHOLD - 10)
+
+// How the stick position is classified into D-pad directions.
+// Can be either:
+// * ANALOG_PAD_MODE_SQUARE: Each axis is compared against ANALOG_PAD_DIRECTION_THRESHOLD on its own.
+// * ANALOG_PAD_MODE_RADIAL: The stick must leave a circular deadzone, and its angle is quantized into sectors.
+#define ANALOG_PAD_MODE_SQUARE (0)
+#define ANALOG_PAD_MODE_RADIAL (1)
+#define ANALOG_PAD_MODE ANALOG_PAD_MODE_SQUARE
+
+// ANALOG_PAD_MODE_RADIAL only: The radius of the circular deadzone around the stick center,
+// and the radius below which a registered direction is released again.
+#define ANALOG_PAD_RADIAL_DEADZONE (ANALOG_PAD_DIRECTION_THRESHOLD)
+#define ANALOG_PAD_RADIAL_RELEASE_DEADZONE (ANALOG_PAD_DIRECTION_RELEASE_THRESHOLD)
+
+// ANALOG_PAD_MODE_RADIAL only: The number of direction sectors. Can be either 4 or 8.
+#define ANALOG_PAD_SECTORS (8)
+
+// ANALOG_PAD_MODE_RADIAL only: The angular width of each diagonal sector, in degrees (0 - 90, even).
+// 45 gives eight equally sized sectors. Smaller values make the cardinal directions easier to hold.
+#define ANALOG_PAD_DIAGONAL_WIDTH_DEG (30)
+
+#endif /* CONFIG_H */
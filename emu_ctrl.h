@@ -0,0 +1,111 @@
+// PSP-EmulatedControllerTest
+// Exported API for feeding the emulated external controller port from other modules.
+//
+// Ryan Crosby 2025
+//
+// The functions are exported twice:
+// * EmuCtrl_driver: Kernel exports, for other kernel mode plugins.
+// * EmuCtrl: Syscall exports, for user mode code.
+//
+// Buffers passed from user mode are checked against the caller's privilege level.
+//
+// Each emulated port (SCE_CTRL_PORT_DS3 or SCE_CTRL_PORT_UNKNOWN_2) has its own input, selected by the
+// port argument. Functions taking a port fail with SCE_ERROR_INVALID_VALUE (0x800001FE) for a port the
+// plugin doesn't emulate.
+//
+// Two ways of feeding input are provided:
+// * A live frame set with emuCtrlSetInputFrame(), which is applied on every poll until it is replaced.
+// * A queue of frames submitted in batches with emuCtrlSubmitFrames(), which are applied in order,
+//   exactly one per poll, in place of the live frame.
+//
+// In both cases the frame is merged into the emulated controller port output:
+// buttons are OR'ed in, stick axes take over when they are deflected past the center error margin,
+// and the pressure and tilt fields are passed through.
+
+#ifndef EMU_CTRL_H
+#define EMU_CTRL_H
+
+#include "ctrl_imports.h"
+
+// Replaces the live input frame. The timeStamp field is ignored.
+//
+// Returns 0 on success, < 0 on error.
+s32 emuCtrlSetInputFrame(u32 port, const SceCtrlData2 *frame);
+
+// Queues a batch of input frames, to be consumed in order by the polling loop, one per poll.
+//
+// Each frame is held back until the poll timestamp reaches its timeStamp (in microseconds, on the
+// same clock as sceKernelGetSystemTimeLow()). A timeStamp of 0 applies the frame on the next poll.
+//
+// Submitting a batch costs a single kernel transition and a single lock, regardless of its size.
+//
+// Returns the number of frames queued, which is less than count once the queue is full, or < 0 on error.
+s32 emuCtrlSubmitFrames(u32 port, const SceCtrlData2 *frames, u32 count);
+
+// Replaces the button remap applied to the emulated ports.
+//
+// map points to 32 words. map[i] holds the buttons that button bit i (1 << i) reports as, so an identity
+// remap has map[i] == 1 << i. Passing NULL removes the remap.
+//
+// The remap is compiled into lookup tables once per call, so this should not be called per frame.
+//
+// Returns 0 on success, < 0 on error.
+s32 emuCtrlSetButtonRemap(const u32 *map);
+
+// Sets up turbo (rapid fire) for buttons on the emulated ports.
+//
+// While held, the buttons alternate between being reported for on_polls polls and being suppressed for
+// off_polls polls, starting with on. Both periods are 1 - 15 polls. on_polls == 0 disables turbo for the buttons.
+// Only the 16 user buttons (0x0000FFFF) can be set up.
+//
+// Returns 0 on success, < 0 on error.
+s32 emuCtrlSetTurbo(u32 buttons, u32 on_polls, u32 off_polls);
+
+// Returns the number of frames queued for the port that have not been consumed yet, or < 0 on error.
+s32 emuCtrlGetQueuedFrameCount(u32 port);
+
+// The number of poll interval histogram buckets, and the width of each bucket as a power of 2 in microseconds.
+#define EMU_CTRL_POLL_HISTOGRAM_BUCKETS (32)
+#define EMU_CTRL_POLL_HISTOGRAM_SHIFT (10)
+
+// Timing statistics of the polls of an emulated port, since the port was registered.
+// Times are in microseconds, on the clock of the driver's poll timestamps, unless stated otherwise.
+typedef struct {
+    // The number of polls.
+    u32 polls;
+    // Histogram of the intervals between consecutive polls. Bucket i counts the intervals from
+    // i << EMU_CTRL_POLL_HISTOGRAM_SHIFT up to (i + 1) << EMU_CTRL_POLL_HISTOGRAM_SHIFT, the last bucket
+    // also counts every longer interval.
+    u32 interval_histogram[EMU_CTRL_POLL_HISTOGRAM_BUCKETS];
+    u32 interval_last;
+    u32 interval_min;
+    u32 interval_max;
+    // The jitter of the poll interval: the smoothed difference between consecutive intervals (as in RFC 3550),
+    // and the largest difference seen.
+    u32 jitter;
+    u32 jitter_max;
+    // The delay between the driver's poll timestamp and the callback starting.
+    u32 entry_delay_last;
+    u32 entry_delay_max;
+    // The age of the PSP sample each poll used, from the sample's timestamp to the poll's. A stale sample predates
+    // the previous poll, so the PSP input reached the port a sampling cycle late. Polls without a PSP sample
+    // aren't counted.
+    u32 sample_polls;
+    u32 sample_age_last;
+    u32 sample_age_max;
+    u32 stale_samples;
+    // The callback execution time, in CPU cycles.
+    u32 handler_cycles_last;
+    u32 handler_cycles_max;
+    u64 handler_cycles_total;
+    // The poll timestamp of the slowest callback.
+    u32 handler_cycles_max_timestamp;
+} EmuCtrlPollStats;
+
+// Copies the poll timing statistics of the port into stats. The statistics keep running.
+// Fails with 0x80000004 (not supported) if the plugin was built without POLL_STATS.
+//
+// Returns 0 on success, < 0 on error.
+s32 emuCtrlGetPollStats(u32 port, EmuCtrlPollStats *stats);
+
+#endif /* EMU_CTRL_H */
@@ -6,310 +6,1974 @@
 // We use our own sceCtrl_driver imports with imports.S
 // Don't import <pspctrl.h> or link the pspctrl module or it will conflict!
 #include "ctrl_imports.h"
+#include "emu_ctrl.h"
+#include "config.h"
+#include "common.h"
+#include "button_remap.h"
+#include "turbo.h"
+#include "pressure.h"
+#include "tilt.h"
+#include "input_record.h"
+#include "input_replay.h"
+#include "poll_stats.h"
 
-#ifdef DEBUG
-#include <pspdebug.h>
 #include <pspdisplay.h>
+
+#include <pspsdk.h>
+#include <psptypes.h>
+#include <pspkerror.h>
+#include <pspkerneltypes.h>
+#include <pspthreadman.h>
+#include <pspiofilemgr.h>
+#include <pspinit.h>
+
+#include <stdbool.h>
+#include <inttypes.h>
+
+#define MODULE_NAME "EmulatedControllerTest"
+#define MAJOR_VER 1
+#define MINOR_VER 1
+
+#define MODULE_OK       0
+#define MODULE_ERROR    1
+
+//
+// PSP SDK
+//
+// We are building a kernel mode prx plugin
+PSP_MODULE_INFO(MODULE_NAME, PSP_MODULE_KERNEL, MAJOR_VER, MINOR_VER);
+
+// We don't allocate any heap memory, so set this to 0.
+PSP_HEAP_SIZE_KB(0);
+//PSP_MAIN_THREAD_ATTR(0);
+//PSP_MAIN_THREAD_NAME(MODULE_NAME);
+
+// We don't need a main thread since we only do basic setup during module start and won't stall module loading.
+// This will make us be called from the module loader thread directly, instead of a secondary kernel thread.
+PSP_NO_CREATE_MAIN_THREAD();
+
+// We don't need any of the newlib features since we're not calling into stdio or stdlib etc
+PSP_DISABLE_NEWLIB();
+
+//
+// Forward declarations
+//
+static int main_thread(SceSize args, void *argp);
+static int start_main_thread(void);
+static int stop_main_thread(void);
+static s32 lock_input_writer(void);
+static void unlock_input_writer(void);
+#if INJECTION_BACKEND == INJECTION_BACKEND_PORT_HANDLER
+static s32 register_controller_port(u8 port, void *input_source);
+static s32 unregister_controller_port(u8 port);
+#endif
+int module_start(SceSize args, void *argp);
+int module_stop(SceSize args, void *argp);
+
+//
+// Stick words
+//
+
+// aX, aY, rX and rY are adjacent and word aligned in both SceCtrlData and SceCtrlData2, so all four can be
+// handled as one little endian word with aX in the low byte. Only aX and aY are valid in SceCtrlData.
+_Static_assert(__builtin_offsetof(SceCtrlData, aX) % 4 == 0, "SceCtrlData sticks must be word aligned");
+_Static_assert(__builtin_offsetof(SceCtrlData2, aX) % 4 == 0, "SceCtrlData2 sticks must be word aligned");
+_Static_assert(__builtin_offsetof(SceCtrlData2, rY) == __builtin_offsetof(SceCtrlData2, aX) + 3, "SceCtrlData2 sticks must be adjacent");
+
+// A u32 allowed to alias the stick bytes.
+typedef u32 __attribute__((__may_alias__)) StickWord;
+
+// The byte of each stick axis within a stick word.
+#define STICK_WORD_AX_SHIFT (0)
+#define STICK_WORD_AY_SHIFT (8)
+#define STICK_WORD_RX_SHIFT (16)
+#define STICK_WORD_RY_SHIFT (24)
+
+// The bytes of a stick word that are valid for a SceCtrlData.
+#define STICK_WORD_LEFT_STICK (0x0000FFFF)
+
+// A stick word with all four axes centered.
+#define STICK_WORD_CENTERED (SCE_CTRL_ANALOG_PAD_CENTER_VALUE * 0x01010101u)
+
+static inline
+u32 load_stick_word(const u8 *aX)
+{
+    return *(const StickWord *)aX;
+}
+
+static inline
+void store_stick_word(u8 *aX, u32 sticks)
+{
+    *(StickWord *)aX = sticks;
+}
+
+// Each stick byte spread into the low byte of a 16-bit lane, leaving a spare byte above it for carries.
+#define STICK_LANE_ONES (0x00010001)
+#define STICK_LANE_BYTES (0x00FF00FF)
+
+// Adding these to a lane leaves bit 8 set if the lane is above the center error margin, or at least at its
+// lower end, respectively. Lanes never exceed 0x1FF, so neither add carries into the next lane.
+#define STICK_LANE_ABOVE_MARGIN ((0x100 - (SCE_CTRL_ANALOG_PAD_CENTER_VALUE + CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN + 1)) * STICK_LANE_ONES)
+#define STICK_LANE_NOT_BELOW_MARGIN ((0x100 - (SCE_CTRL_ANALOG_PAD_CENTER_VALUE - CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN)) * STICK_LANE_ONES)
+
+// Returns a mask with 0xFF in every byte of the stick word that is deflected past the center error margin,
+// and 0x00 in every other byte. Two lanes of two bytes each are compared at once.
+static inline
+u32 stick_word_outside_margin(u32 sticks)
+{
+    u32 even = sticks & STICK_LANE_BYTES;
+    u32 odd = (sticks >> 8) & STICK_LANE_BYTES;
+
+    u32 even_outside = (((even + STICK_LANE_ABOVE_MARGIN) | ~(even + STICK_LANE_NOT_BELOW_MARGIN)) >> 8) & STICK_LANE_ONES;
+    u32 odd_outside = (((odd + STICK_LANE_ABOVE_MARGIN) | ~(odd + STICK_LANE_NOT_BELOW_MARGIN)) >> 8) & STICK_LANE_ONES;
+
+    return even_outside * 0xFF | (odd_outside * 0xFF) << 8;
+}
+
+//
+// Input injection channel
+//
+
+// A single-writer/single-reader channel carrying full SceCtrlData2 frames into the controller callback.
+//
+// This is a sequence lock over two frame slots. The writer fills the slot the reader is not currently
+// being pointed at, and then publishes it by bumping the sequence number. The reader copies the
+// published slot and checks that the sequence number did not move while it was copying. If it did,
+// the copy may be torn, so the reader falls back to the last frame it read successfully instead of
+// retrying. Neither side ever blocks, spins or disables interrupts.
+//
+// With INJECTION_BACKEND_PORT_HANDLER the callback runs in the driver's sampling interrupt, which no writer
+// thread can preempt. With INJECTION_BACKEND_EMULATION_SLOTS it runs in a preemptible thread, but under the
+// input writer lock, see emulation_slot_thread(). Either way a read never overlaps a write on a single core,
+// and the fallback is only there for readers without either guarantee.
+typedef struct {
+    // Incremented once per published frame. The published frame is frames[sequence & 1].
+    volatile u32 sequence;
+    SceCtrlData2 frames[2];
+    // Set for each slot by the writer if the frame injects nothing, see input_frame_is_idle().
+    bool idle[2];
+    // Reader owned. The last frame that was read without tearing.
+    SceCtrlData2 last_read;
+} InputChannel;
+
+// A frame that injects nothing: no buttons, both sticks centered, no pressure or tilt.
+#define INPUT_CHANNEL_NEUTRAL_FRAME { \
+    .aX = SCE_CTRL_ANALOG_PAD_CENTER_VALUE, \
+    .aY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE, \
+    .rX = SCE_CTRL_ANALOG_PAD_CENTER_VALUE, \
+    .rY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE, \
+}
+
+// True if the stick axis value is within the center error margin.
+static inline
+bool axis_is_centered(u8 value)
+{
+    return (u32)(value - SCE_CTRL_ANALOG_PAD_CENTER_VALUE + CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN)
+        <= 2 * CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN;
+}
+
+// True if merging the frame into the port output changes nothing: no buttons, no pressure or tilt,
+// and no stick axis deflected far enough to take over from the response curves.
+// Without the curve stage the injected sticks are reported as they are, so they have to be exactly centered.
+static
+bool input_frame_is_idle(const SceCtrlData2 *frame)
+{
+    if((frame->buttons | frame->DPadSenseA | frame->DPadSenseB | frame->GPadSenseA | frame->GPadSenseB
+            | frame->AxisSenseA | frame->AxisSenseB | frame->TiltA | frame->TiltB) != 0) {
+        return false;
+    }
+
+#if PIPELINE_CURVES && STICK_SWAR
+    return stick_word_outside_margin(load_stick_word(&frame->aX)) == 0;
+#elif PIPELINE_CURVES
+    return axis_is_centered(frame->aX) && axis_is_centered(frame->aY)
+        && axis_is_centered(frame->rX) && axis_is_centered(frame->rY);
+#else
+    return frame->aX == SCE_CTRL_ANALOG_PAD_CENTER_VALUE && frame->aY == SCE_CTRL_ANALOG_PAD_CENTER_VALUE
+        && frame->rX == SCE_CTRL_ANALOG_PAD_CENTER_VALUE && frame->rY == SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+#endif
+}
+
+// Publishes a new frame. Must only be called from one thread at a time.
+static
+void input_channel_write(InputChannel *channel, const SceCtrlData2 *frame)
+{
+    u32 next = channel->sequence + 1;
+
+    copy_words(&channel->frames[next & 1], frame, sizeof(SceCtrlData2));
+    channel->idle[next & 1] = input_frame_is_idle(frame);
+    MEMORY_BARRIER();
+    channel->sequence = next;
+}
+
+// Reads the most recently published frame into frame. Never blocks.
+// Returns true if the frame was freshly read, false if the previous good frame was returned instead.
+static inline
+bool input_channel_read(InputChannel *channel, SceCtrlData2 *frame)
+{
+    u32 sequence = channel->sequence;
+    MEMORY_BARRIER();
+
+    copy_words(frame, &channel->frames[sequence & 1], sizeof(SceCtrlData2));
+
+    MEMORY_BARRIER();
+    if(channel->sequence != sequence) {
+        // The writer published at least once while we were copying, and may have started
+        // rewriting the slot we were reading. Drop the copy.
+        copy_words(frame, &channel->last_read, sizeof(SceCtrlData2));
+        return false;
+    }
+
+    copy_words(&channel->last_read, frame, sizeof(SceCtrlData2));
+    return true;
+}
+
+// True if the most recently published frame injects nothing. Never blocks.
+static inline
+bool input_channel_idle(InputChannel *channel)
+{
+    u32 sequence = channel->sequence;
+    MEMORY_BARRIER();
+
+    return channel->idle[sequence & 1];
+}
+
+//
+// Queued input frames
+//
+
+// The number of frames that can be queued through emuCtrlSubmitFrames(). Must be a power of 2.
+#define INPUT_QUEUE_LENGTH (64)
+
+// A single-producer/single-consumer ring of timestamped frames, consumed one per poll.
+//
+// head and tail are free running, so tail - head is the number of queued frames.
+// Only the producer writes tail and only the consumer writes head.
+typedef struct {
+    volatile u32 head;
+    volatile u32 tail;
+    SceCtrlData2 frames[INPUT_QUEUE_LENGTH];
+} InputQueue;
+
+// Appends up to count frames. Must only be called from one thread at a time.
+// Returns the number of frames queued, which is less than count if the queue filled up.
+static
+u32 input_queue_push(InputQueue *queue, const SceCtrlData2 *frames, u32 count)
+{
+    u32 tail = queue->tail;
+    u32 space = INPUT_QUEUE_LENGTH - (tail - queue->head);
+    u32 n = count < space ? count : space;
+
+    for(u32 i = 0; i < n; i++) {
+        copy_words(&queue->frames[(tail + i) & (INPUT_QUEUE_LENGTH - 1)], &frames[i], sizeof(SceCtrlData2));
+    }
+
+    // Publish the frames only once they are fully written
+    MEMORY_BARRIER();
+    queue->tail = tail + n;
+
+    return n;
+}
+
+// Pops the next queued frame into frame if it is due at time now. Never blocks.
+//
+// A frame is due once now has reached its timeStamp. A timeStamp of 0 means as soon as possible.
+// Returns true if a frame was popped.
+static inline
+bool input_queue_pop_due(InputQueue *queue, u32 now, SceCtrlData2 *frame)
+{
+    u32 head = queue->head;
+
+    if(head == queue->tail) {
+        return false;
+    }
+
+    MEMORY_BARRIER();
+    const SceCtrlData2 *next = &queue->frames[head & (INPUT_QUEUE_LENGTH - 1)];
+
+    // Wrap safe comparison of the microsecond timestamps
+    if(next->timeStamp != 0 && (s32)(now - next->timeStamp) < 0) {
+        return false;
+    }
+
+    copy_words(frame, next, sizeof(SceCtrlData2));
+
+    // Hand the slot back to the producer only once it has been copied
+    MEMORY_BARRIER();
+    queue->head = head + 1;
+
+    return true;
+}
+
+//
+// Globals
+//
+
+// Everything that feeds the emulated controller port, passed to the controller callback as its input source.
+typedef struct {
+    // The live input frame, applied on every poll that has no queued frame.
+    InputChannel channel;
+    // Queued frames, each applied on exactly one poll in place of the live frame.
+    InputQueue queue;
+} PortInputSource;
+
+// Serializes the writers of the port input sources and the runtime configuration, since they only support a single writer.
+// Only the exported functions take it, never the controller callback.
+static SceUID g_input_writer_sema = -1;
+
+static SceUID g_mainThreadId = -1;
+
+// Whether the main thread has periodic work to do, rather than just sleeping until it is stopped.
+#if INPUT_TRACE_MODE != INPUT_TRACE_MODE_OFF || defined(DEBUG) || SAMPLING_CYCLE_MANAGED
+#define MAIN_THREAD_SERVICE_LOOP (1)
+#else
+#define MAIN_THREAD_SERVICE_LOOP (0)
+#endif
+
+// How often the main thread's service loop runs. The input trace and the debug log need draining every
+// TIMER_PERIOD, while the sampling cycle policy alone only needs a pass every SAMPLING_CYCLE_CHECK_PERIOD.
+#if INPUT_TRACE_MODE != INPUT_TRACE_MODE_OFF || defined(DEBUG)
+#define MAIN_THREAD_PERIOD (TIMER_PERIOD)
+#else
+#define MAIN_THREAD_PERIOD (SAMPLING_CYCLE_CHECK_PERIOD)
+#endif
+
+// Set by stop_main_thread() to end the main thread's service loop.
+static volatile bool g_stop_requested = false;
+
+#if INPUT_TRACE_MODE == INPUT_TRACE_MODE_RECORD
+static RecordRing g_record_ring = { 0 };
+static InputRecorder g_recorder = { .fd = -1 };
+#elif INPUT_TRACE_MODE == INPUT_TRACE_MODE_REPLAY
+static ReplayState g_replay = { 0 };
+static InputReplayer g_replayer = { .fd = -1 };
+#endif
+
+//
+// Threads
+//
+
+// Creates and starts a kernel thread, and stores its id in thid once it is running.
+// Returns an error if the thread could not be created or started, leaving thid unchanged.
+static
+int start_thread(const char *name, SceKernelThreadEntry entry, int priority, SceUID *thid)
+{
+    int result;
+
+    // name, entry, initPriority, stackSize, PspThreadAttributes, SceKernelThreadOptParam
+    SceUID id = sceKernelCreateThread(name, entry, priority, 0x800, 0, 0);
+    if(id < 0) {
+        DEBUG_PRINT("Failed to create thread %s: ret 0x%08x\n", name, id);
+        return id;
+    }
+
+    DEBUG_PRINT("Starting thread %s\n", name);
+    result = sceKernelStartThread(id, 0, 0);
+    if(result < 0) {
+        DEBUG_PRINT("Failed to start thread %s: ret 0x%08x\n", name, result);
+        sceKernelDeleteThread(id);
+        return result;
+    }
+
+    *thid = id;
+    return SCE_ERROR_OK;
+}
+
+// Waits for the thread in thid to exit and deletes it, terminating it if it doesn't exit within timeout
+// microseconds. A timeout of 0 waits forever. The thread must already have been asked to stop.
+// Sets thid to -1 once the thread is gone.
+static
+int stop_thread(SceUID *thid, SceUInt timeout)
+{
+    int result;
+    SceUID id = *thid;
+
+    if(id < 0) {
+        return SCE_ERROR_OK;
+    }
+
+    result = sceKernelWaitThreadEnd(id, timeout != 0 ? &timeout : NULL);
+    if(result < 0) {
+        // Thread did not stop, force terminate and delete it
+        DEBUG_PRINT("Thread 0x%08x did not exit: ret 0x%08x, terminating it\n", id, result);
+        result = sceKernelTerminateDeleteThread(id);
+    }
+    else {
+        result = sceKernelDeleteThread(id);
+    }
+
+    if(result < 0) {
+        DEBUG_PRINT("Failed to delete thread 0x%08x: ret 0x%08x\n", id, result);
+        return result;
+    }
+
+    *thid = -1;
+    return SCE_ERROR_OK;
+}
+
+//
+// Debug log
+//
+
+// The controller callback can't print to the screen itself, since a screen print takes far longer than a poll.
+// It logs binary records instead, a format and its arguments, which the main thread formats and prints
+// every TIMER_PERIOD. DEBUG_LOG() is the callback's DEBUG_PRINT().
+
+#ifdef DEBUG
+
+// The messages that can be logged. Each format takes up to DEBUG_LOG_ARGS u32 arguments.
+typedef enum {
+    DEBUG_LOG_POLL_BUTTONS,
+    DEBUG_LOG_FORMAT_COUNT
+} DebugLogFormat;
+
+static const char * const g_debug_log_formats[DEBUG_LOG_FORMAT_COUNT] = {
+    [DEBUG_LOG_POLL_BUTTONS] = "Ctrl handler port %d timestamp: 0x%08x, buttons: 0x%08x\n",
+};
+
+#define DEBUG_LOG_ARGS (3)
+
+// The number of records the log ring can hold. Must be a power of 2.
+#define DEBUG_LOG_RING_LENGTH (64)
+
+typedef struct {
+    u32 format;
+    u32 args[DEBUG_LOG_ARGS];
+} DebugLogRecord;
+
+// A single-producer/single-consumer ring carrying the log records from the controller callback
+// to the main thread. The callback never waits for space, it counts the record as dropped instead.
+typedef struct {
+    volatile u32 head;
+    volatile u32 tail;
+    // The number of records dropped because the ring was full.
+    volatile u32 drops;
+    // The number of drops the main thread has reported so far.
+    u32 drops_reported;
+    DebugLogRecord records[DEBUG_LOG_RING_LENGTH];
+} DebugLogRing;
+
+static DebugLogRing g_debug_log = { 0 };
+
+// Called from the controller callback. Never blocks.
+static inline
+void debug_log(DebugLogRing *ring, u32 format, u32 arg0, u32 arg1, u32 arg2)
+{
+    u32 tail = ring->tail;
+
+    if(tail - ring->head >= DEBUG_LOG_RING_LENGTH) {
+        ring->drops++;
+        return;
+    }
+
+    DebugLogRecord *record = &ring->records[tail & (DEBUG_LOG_RING_LENGTH - 1)];
+    record->format = format;
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+    record->args[2] = arg2;
+    MEMORY_BARRIER();
+    ring->tail = tail + 1;
+}
+
+// Prints every record waiting in the ring, and how many were dropped since the last drain. Called from the main thread.
+static
+void debug_log_drain(DebugLogRing *ring)
+{
+    DebugLogRecord record;
+    u32 head = ring->head;
+    u32 tail = ring->tail;
+
+    MEMORY_BARRIER();
+
+    while(head != tail) {
+        record = ring->records[head & (DEBUG_LOG_RING_LENGTH - 1)];
+        head++;
+
+        // Hand the slot back before the slow print
+        MEMORY_BARRIER();
+        ring->head = head;
+
+        if(record.format < DEBUG_LOG_FORMAT_COUNT) {
+            DEBUG_PRINT(g_debug_log_formats[record.format], record.args[0], record.args[1], record.args[2]);
+        }
+    }
+
+    u32 drops = ring->drops;
+    if(drops != ring->drops_reported) {
+        DEBUG_PRINT("Debug log dropped %u records\n", drops - ring->drops_reported);
+        ring->drops_reported = drops;
+    }
+}
+
+#define DEBUG_LOG(format, arg0, arg1, arg2) debug_log(&g_debug_log, (format), (u32)(arg0), (u32)(arg1), (u32)(arg2))
+#else
+#define DEBUG_LOG(...) do{ } while ( 0 )
+#endif
+
+//
+// PSP controller sampling
+//
+
+// The controller callback reads the PSP's own controls with sceCtrlPeekBufferPositive(), which returns the newest
+// sample in the ctrl driver's sample buffer. The driver calls the callback from inside its sampling pass, so that
+// sample is only this cycle's if the driver stores it before it runs the port handlers. If it stores it after them,
+// the peek returns the previous cycle's sample and the PSP input reaches the emulated ports a cycle late.
+// The stale_samples count of the poll statistics shows which order the firmware uses.
+//
+// Taking the sample from a thread blocked in sceCtrlReadBufferPositive() instead doesn't help: the driver only
+// wakes readers once the whole pass, port handlers included, has completed, so that sample is always a cycle late.
+//
+// The sample is the merged one, and its stick isn't always the PSP's: the driver merges each port's output left
+// stick over the PSP stick when it is outside the center error margin, through the emulation slots. In either
+// order the callback then reads back the output of the previous cycle. There's no sample of the PSP stick from
+// before the merge, so while an output left stick is off center the PSP stick is taken as centered, rather than
+// letting the output feed back into the D-pad, the tilt and the curves. For the same reason the left stick curves
+// have to be AXIS_CURVE_CENTER, see module_start().
+
+// Counters of the PSP samples seen by the controller callback.
+typedef struct {
+    // Samples taken with sceCtrlPeekBufferPositive().
+    u32 samples;
+    // Samples that were the same as the previous one, so the emulated ports ran a cycle behind.
+    u32 repeated;
+    // Attempts to take a sample that found none available.
+    u32 missing;
+    // Polls that reused the sample another port took in the same cycle.
+    u32 shared;
+    // The timestamp of the previous sample.
+    u32 last_timestamp;
+} PadSampleStats;
+
+static PadSampleStats g_pad_sample_stats = { 0 };
+
+// Gets the current PSP controller sample for the controller callback.
+// Returns false if there is no sample for this poll.
+static inline
+bool pad_sample_get(PadSampleStats *stats, SceCtrlData *sample)
+{
+    bool have_sample = sceCtrlPeekBufferPositive(sample, 1) >= 0;
+
+    if(!have_sample) {
+        stats->missing++;
+        return false;
+    }
+
+    stats->samples++;
+    stats->repeated += sample->timeStamp == stats->last_timestamp;
+    stats->last_timestamp = sample->timeStamp;
+    return true;
+}
+
+// Every emulated port is polled in the same sampling cycle, within microseconds of each other.
+// A poll within this many microseconds of the poll that took the current sample reuses it, rather than
+// taking another one. This is far below the shortest sampling cycle of 5555us.
+#define PAD_SAMPLE_SHARE_WINDOW (1000)
+
+// The PSP sample of the current sampling cycle, shared by all emulated ports.
+typedef struct {
+    // The timestamp of the poll the sample was taken for.
+    u32 poll_time;
+    // False until the first sample is taken.
+    bool taken;
+    // False if no sample was available for that poll.
+    bool have_sample;
+    // Set by a poll whose output left stick is outside the center error margin, cleared when the next sample
+    // is taken. That sample's stick is then the port output rather than the PSP stick.
+    bool output_stick_merged;
+    SceCtrlData sample;
+} SharedPadSample;
+
+static SharedPadSample g_shared_pad_sample = { 0 };
+
+// Gets the PSP sample for the poll at now, taking it only once per sampling cycle.
+// Returns false if there is no sample for this cycle.
+static inline
+bool shared_pad_sample_get(SharedPadSample *shared, PadSampleStats *stats, u32 now, SceCtrlData *sample)
+{
+    if(!shared->taken || now - shared->poll_time >= PAD_SAMPLE_SHARE_WINDOW) {
+        shared->have_sample = pad_sample_get(stats, &shared->sample);
+        shared->poll_time = now;
+        shared->taken = true;
+
+        if(shared->output_stick_merged) {
+            shared->sample.aX = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+            shared->sample.aY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+            shared->output_stick_merged = false;
+        }
+    }
+    else {
+        stats->shared++;
+    }
+
+    *sample = shared->sample;
+    return shared->have_sample;
+}
+
+// Notes a poll's output for the next sample. Called from the controller callback.
+static inline
+void shared_pad_sample_note_output(SharedPadSample *shared, const SceCtrlData2 *frame)
+{
+    if(!axis_is_centered(frame->aX) || !axis_is_centered(frame->aY)) {
+        shared->output_stick_merged = true;
+    }
+}
+
+
+//
+// Analog to D-pad lookup tables
+//
+
+// Classifies a raw axis value into the negative or positive direction button of that axis.
+#define ANALOG_AXIS_DIRECTION(value, threshold, negative_button, positive_button) \
+    ((((int)(value) - SCE_CTRL_ANALOG_PAD_CENTER_VALUE) > (threshold)) ? (positive_button) : \
+     (((int)(value) - SCE_CTRL_ANALOG_PAD_CENTER_VALUE) <= -(threshold)) ? (negative_button) : 0)
+
+#define ANALOG_X_PRESS(value) ANALOG_AXIS_DIRECTION(value, ANALOG_PAD_DIRECTION_THRESHOLD, SCE_CTRL_LEFT, SCE_CTRL_RIGHT)
+#define ANALOG_Y_PRESS(value) ANALOG_AXIS_DIRECTION(value, ANALOG_PAD_DIRECTION_THRESHOLD, SCE_CTRL_UP, SCE_CTRL_DOWN)
+#define ANALOG_X_HOLD(value) ANALOG_AXIS_DIRECTION(value, ANALOG_PAD_DIRECTION_RELEASE_THRESHOLD, SCE_CTRL_LEFT, SCE_CTRL_RIGHT)
+#define ANALOG_Y_HOLD(value) ANALOG_AXIS_DIRECTION(value, ANALOG_PAD_DIRECTION_RELEASE_THRESHOLD, SCE_CTRL_UP, SCE_CTRL_DOWN)
+
+// The D-pad buttons all live in the low byte of the buttons word, so the tables only need to be u8.
+// These are generated entirely by the preprocessor from the threshold and center constants.
+//
+// The press tables give the directions that register from released, the hold tables give the directions
+// that stay registered if they were already held on the previous poll.
+static const u8 g_analog_x_press_lut[256] = { LUT256(ANALOG_X_PRESS) };
+static const u8 g_analog_y_press_lut[256] = { LUT256(ANALOG_Y_PRESS) };
+static const u8 g_analog_x_hold_lut[256] = { LUT256(ANALOG_X_HOLD) };
+static const u8 g_analog_y_hold_lut[256] = { LUT256(ANALOG_Y_HOLD) };
+
+// Direction classification state carried between handler invocations.
+typedef struct {
+    // The directions reported on the previous poll.
+    u32 buttons;
+    // The directions the plain press thresholds would have reported on the previous poll, without hysteresis.
+    u32 raw_buttons;
+    // The number of polls on which the reported directions changed.
+    u32 edges;
+    // The number of polls on which the directions would have changed without hysteresis.
+    // raw_edges - edges is the number of spurious make/break events removed.
+    u32 raw_edges;
+} AnalogDirectionState;
+
+#if ANALOG_PAD_MODE == ANALOG_PAD_MODE_RADIAL
+
+#if ANALOG_PAD_SECTORS == 4
+// Diagonals are never reported, the boundary sits on the octant edge.
+#define ANALOG_PAD_DIAGONAL_BOUNDARY_DEG (45)
+#elif ANALOG_PAD_SECTORS == 8
+#define ANALOG_PAD_DIAGONAL_BOUNDARY_DEG (45 - (ANALOG_PAD_DIAGONAL_WIDTH_DEG / 2))
+#else
+#error "ANALOG_PAD_SECTORS must be either 4 or 8"
+#endif
+
+#if ANALOG_PAD_DIAGONAL_BOUNDARY_DEG < 0 || ANALOG_PAD_DIAGONAL_BOUNDARY_DEG > 45
+#error "ANALOG_PAD_DIAGONAL_WIDTH_DEG must be within 0 - 90"
+#endif
+
+// tan(n degrees) in unsigned 16.16 fixed point, for n = 0 - 45.
+// Within an octant the stick angle from the major axis is atan(minor / major), so comparing
+// minor * 2^16 against major * tan(boundary) places the stick on either side of the boundary
+// without any division or trig at runtime.
+static const u32 g_tan_q16_lut[46] = {
+    0x00000, 0x00478, 0x008F1, 0x00D6B, 0x011E7, 0x01666, 0x01AE8, 0x01F6F,
+    0x023FA, 0x0288C, 0x02D24, 0x031C3, 0x0366A, 0x03B1A, 0x03FD4, 0x04498,
+    0x04968, 0x04E44, 0x0532E, 0x05826, 0x05D2D, 0x06245, 0x0676E, 0x06CAA,
+    0x071FB, 0x07760, 0x07CDC, 0x08270, 0x0881E, 0x08DE7, 0x093CD, 0x099D2,
+    0x09FF7, 0x0A640, 0x0ACAD, 0x0B341, 0x0B9FF, 0x0C0E9, 0x0C802, 0x0CF4E,
+    0x0D6CF, 0x0DE8A, 0x0E681, 0x0EEB9, 0x0F737, 0x10000,
+};
+
+// Octant table index bits
+#define OCTANT_X_NEGATIVE   (1 << 0)
+#define OCTANT_Y_NEGATIVE   (1 << 1)
+#define OCTANT_Y_MAJOR      (1 << 2)
+#define OCTANT_DIAGONAL     (1 << 3)
+
+// Maps the octant and diagonal classification of the stick to D-pad buttons.
+static const u8 g_octant_direction_lut[16] = {
+    // Cardinal, X major axis
+    [0]                                                     = SCE_CTRL_RIGHT,
+    [OCTANT_X_NEGATIVE]                                     = SCE_CTRL_LEFT,
+    [OCTANT_Y_NEGATIVE]                                     = SCE_CTRL_RIGHT,
+    [OCTANT_X_NEGATIVE | OCTANT_Y_NEGATIVE]                 = SCE_CTRL_LEFT,
+    // Cardinal, Y major axis
+    [OCTANT_Y_MAJOR]                                        = SCE_CTRL_DOWN,
+    [OCTANT_Y_MAJOR | OCTANT_X_NEGATIVE]                    = SCE_CTRL_DOWN,
+    [OCTANT_Y_MAJOR | OCTANT_Y_NEGATIVE]                    = SCE_CTRL_UP,
+    [OCTANT_Y_MAJOR | OCTANT_X_NEGATIVE | OCTANT_Y_NEGATIVE] = SCE_CTRL_UP,
+    // Diagonal, either major axis
+    [OCTANT_DIAGONAL]                                       = SCE_CTRL_DOWN | SCE_CTRL_RIGHT,
+    [OCTANT_DIAGONAL | OCTANT_X_NEGATIVE]                   = SCE_CTRL_DOWN | SCE_CTRL_LEFT,
+    [OCTANT_DIAGONAL | OCTANT_Y_NEGATIVE]                   = SCE_CTRL_UP | SCE_CTRL_RIGHT,
+    [OCTANT_DIAGONAL | OCTANT_X_NEGATIVE | OCTANT_Y_NEGATIVE] = SCE_CTRL_UP | SCE_CTRL_LEFT,
+    [OCTANT_DIAGONAL | OCTANT_Y_MAJOR]                      = SCE_CTRL_DOWN | SCE_CTRL_RIGHT,
+    [OCTANT_DIAGONAL | OCTANT_Y_MAJOR | OCTANT_X_NEGATIVE]  = SCE_CTRL_DOWN | SCE_CTRL_LEFT,
+    [OCTANT_DIAGONAL | OCTANT_Y_MAJOR | OCTANT_Y_NEGATIVE]  = SCE_CTRL_UP | SCE_CTRL_RIGHT,
+    [OCTANT_DIAGONAL | OCTANT_Y_MAJOR | OCTANT_X_NEGATIVE | OCTANT_Y_NEGATIVE] = SCE_CTRL_UP | SCE_CTRL_LEFT,
+};
+
+#endif
+
+// Classifies a raw stick position into D-pad direction buttons, and updates the direction state.
+static inline
+u32 analog_direction_buttons(AnalogDirectionState *state, u8 aX, u8 aY)
+{
+    u32 buttons;
+    u32 raw_buttons;
+
+#if ANALOG_PAD_MODE == ANALOG_PAD_MODE_SQUARE
+    // Per axis Schmitt trigger: a direction registers past the press threshold, and then stays
+    // registered until the stick drops back under the release threshold.
+    // Four table loads, no data dependent branches.
+    raw_buttons = g_analog_x_press_lut[aX] | g_analog_y_press_lut[aY];
+    buttons = raw_buttons | ((g_analog_x_hold_lut[aX] | g_analog_y_hold_lut[aY]) & state->buttons);
+#elif ANALOG_PAD_MODE == ANALOG_PAD_MODE_RADIAL
+    s32 dx = (s32)aX - SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    s32 dy = (s32)aY - SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+
+    // Radial deadzone. Both terms are at most 128^2, so the sum can't overflow.
+    // The deadzone shrinks to the release radius while a direction is held.
+    u32 radius_sq = dx * dx + dy * dy;
+    bool outside_press = radius_sq > (u32)(ANALOG_PAD_RADIAL_DEADZONE * ANALOG_PAD_RADIAL_DEADZONE);
+    bool outside_release = radius_sq > (u32)(ANALOG_PAD_RADIAL_RELEASE_DEADZONE * ANALOG_PAD_RADIAL_RELEASE_DEADZONE);
+
+    u32 abs_x = dx < 0 ? -dx : dx;
+    u32 abs_y = dy < 0 ? -dy : dy;
+    u32 major = abs_x > abs_y ? abs_x : abs_y;
+    u32 minor = abs_x > abs_y ? abs_y : abs_x;
+
+    u32 octant = (dx < 0 ? OCTANT_X_NEGATIVE : 0)
+        | (dy < 0 ? OCTANT_Y_NEGATIVE : 0)
+        | (abs_y > abs_x ? OCTANT_Y_MAJOR : 0)
+        | ((minor << 16) > major * g_tan_q16_lut[ANALOG_PAD_DIAGONAL_BOUNDARY_DEG] ? OCTANT_DIAGONAL : 0);
+
+    u32 sector_buttons = g_octant_direction_lut[octant];
+    raw_buttons = outside_press ? sector_buttons : 0;
+    buttons = (outside_press || (outside_release && state->buttons != 0)) ? sector_buttons : 0;
+#else
+#error "Unknown ANALOG_PAD_MODE"
 #endif
 
-#include <pspsdk.h>
-#include <psptypes.h>
-#include <pspkerror.h>
-#include <pspkerneltypes.h>
-#include <pspthreadman.h>
+    state->edges += buttons != state->buttons;
+    state->raw_edges += raw_buttons != state->raw_buttons;
+    state->buttons = buttons;
+    state->raw_buttons = raw_buttons;
+
+    return buttons;
+}
+
+//
+// Analog response curves
+//
+
+// Curve shapes. All shapes map the stick deflection from center, and keep its direction.
+enum AxisCurveType {
+    // The axis always reports center.
+    AXIS_CURVE_CENTER = 0,
+    // Output deflection equals input deflection.
+    AXIS_CURVE_LINEAR,
+    // Power curve, output = input^2. Fine control near center, full speed at the edge.
+    AXIS_CURVE_EXPONENTIAL,
+    // Smoothstep, output = 3 * input^2 - 2 * input^3. Slow near center and near the edge.
+    AXIS_CURVE_S_CURVE,
+    // Piecewise linear through the AxisCurve points.
+    AXIS_CURVE_CUSTOM,
+};
+
+// The most points a custom curve can have.
+#define AXIS_CURVE_MAX_POINTS (8)
+
+typedef struct {
+    // One of AxisCurveType.
+    u8 type;
+    // Mirrors the input around center before applying the curve.
+    bool invert;
+    // Input deflection from center (0 - 127) that still reports center.
+    u8 inner_deadzone;
+    // Input deflection short of full (0 - 127) that already reports full deflection.
+    u8 outer_deadzone;
+    // AXIS_CURVE_CUSTOM only: { input, output } deflection pairs, where 255 is full deflection, in ascending
+    // input order. (0, 0) and (255, 255) are implied at either end.
+    u8 point_count;
+    u8 points[AXIS_CURVE_MAX_POINTS][2];
+} AxisCurve;
+
+// Output axes of the emulated port, in curve table order.
+enum EmulatedAxis {
+    EMULATED_AXIS_AX = 0,
+    EMULATED_AXIS_AY,
+    EMULATED_AXIS_RX,
+    EMULATED_AXIS_RY,
+    EMULATED_AXIS_COUNT,
+};
+
+// The curves baked into one table per axis, indexed by the raw PSP stick value. However complex the
+// curve is, applying it costs one load per axis.
+//
+// The same tables are also merged into stick words, one for the axes driven by the PSP stick's x-axis
+// and one for the y-axis, so the whole output stick word is two loads and an OR.
+typedef struct {
+    u8 lut[EMULATED_AXIS_COUNT][256];
+    u32 x_words[256];
+    u32 y_words[256];
+} AxisCurveTables;
+
+static const AxisCurve g_axis_curves[EMULATED_AXIS_COUNT] = {
+    [EMULATED_AXIS_AX] = AXIS_CURVE_AX,
+    [EMULATED_AXIS_AY] = AXIS_CURVE_AY,
+    [EMULATED_AXIS_RX] = AXIS_CURVE_RX,
+    [EMULATED_AXIS_RY] = AXIS_CURVE_RY,
+};
+
+static AxisCurveTables g_axis_curve_tables;
+
+// Maps a normalized deflection through the curve shape. Both are Q15, 0 - 32768.
+static
+u32 axis_curve_shape(const AxisCurve *curve, u32 t)
+{
+    switch(curve->type) {
+    case AXIS_CURVE_LINEAR:
+        return t;
+    case AXIS_CURVE_EXPONENTIAL:
+        return (t * t) >> 15;
+    case AXIS_CURVE_S_CURVE: {
+        u32 t2 = (t * t) >> 15;
+        u32 t3 = (t2 * t) >> 15;
+        return 3 * t2 - 2 * t3;
+    }
+    case AXIS_CURVE_CUSTOM: {
+        // Find the segment containing t, scaled to the 0 - 255 point range.
+        // Signed, since a segment's output may fall as its input rises.
+        s32 x0 = 0, y0 = 0;
+        s32 x = (s32)((t * 255) >> 15);
+        for(u32 i = 0; i <= curve->point_count; i++) {
+            s32 x1 = i < curve->point_count ? curve->points[i][0] : 255;
+            s32 y1 = i < curve->point_count ? curve->points[i][1] : 255;
+            if(x <= x1) {
+                s32 y = x1 == x0 ? y1 : y0 + ((y1 - y0) * (x - x0)) / (x1 - x0);
+                return ((u32)y << 15) / 255;
+            }
+            x0 = x1;
+            y0 = y1;
+        }
+        return 32768;
+    }
+    case AXIS_CURVE_CENTER:
+    default:
+        return 0;
+    }
+}
+
+// Evaluates the full curve, including inversion and deadzones, for a raw stick value.
+// This runs at load time only, so it is free to divide.
+static
+u8 axis_curve_eval(const AxisCurve *curve, u32 value)
+{
+    if(curve->invert) {
+        value = 255 - value;
+    }
+
+    s32 deflection = (s32)value - SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    u32 magnitude = deflection < 0 ? -deflection : deflection;
+
+    // Normalize the deflection between the deadzones to Q15
+    u32 t;
+    if(magnitude <= curve->inner_deadzone) {
+        t = 0;
+    }
+    else if(magnitude >= 128u - curve->outer_deadzone) {
+        t = 32768;
+    }
+    else {
+        t = ((magnitude - curve->inner_deadzone) << 15) / (128 - curve->outer_deadzone - curve->inner_deadzone);
+    }
+
+    s32 output = (s32)((axis_curve_shape(curve, t) * 128 + (1 << 14)) >> 15);
+    output = SCE_CTRL_ANALOG_PAD_CENTER_VALUE + (deflection < 0 ? -output : output);
+
+    return output < 0 ? 0 : output > 255 ? 255 : output;
+}
+
+// Bakes the configured curves into their tables. Called once before the controller callback is registered.
+static
+void axis_curves_build(AxisCurveTables *tables, const AxisCurve curves[EMULATED_AXIS_COUNT])
+{
+    for(u32 axis = 0; axis < EMULATED_AXIS_COUNT; axis++) {
+        for(u32 value = 0; value < 256; value++) {
+            tables->lut[axis][value] = axis_curve_eval(&curves[axis], value);
+        }
+    }
+
+    for(u32 value = 0; value < 256; value++) {
+        tables->x_words[value] = (u32)tables->lut[EMULATED_AXIS_AX][value] << STICK_WORD_AX_SHIFT
+            | (u32)tables->lut[EMULATED_AXIS_RX][value] << STICK_WORD_RX_SHIFT;
+        tables->y_words[value] = (u32)tables->lut[EMULATED_AXIS_AY][value] << STICK_WORD_AY_SHIFT
+            | (u32)tables->lut[EMULATED_AXIS_RY][value] << STICK_WORD_RY_SHIFT;
+    }
+}
+
+//
+// Input translation
+//
+
+// Picks the injected stick axis value if it is deflected past the center error margin, otherwise the translated one.
+static inline
+u8 merge_injected_axis(u8 translated, u8 injected)
+{
+    s32 offset = (s32)injected - SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    return (offset > CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN || offset < -CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN) ? injected : translated;
+}
+
+// merge_injected_axis() for all four axes of two stick words at once.
+static inline
+u32 merge_injected_sticks(u32 translated, u32 injected)
+{
+    u32 take_injected = stick_word_outside_margin(injected);
+    return (injected & take_injected) | (translated & ~take_injected);
+}
+
+// Starts the emulated controller port frame from the injected frame, with the PSP stick driving the
+// emulated sticks through their response curves (PIPELINE_CURVES).
+//
+// This only touches its arguments and never calls into the ctrl driver, so the per-poll
+// translation cost can be measured separately from the sceCtrlPeekBufferPositive() sample.
+//
+// pad_state may be NULL if no PSP sample was available for this cycle.
+//
+// Each of the injected stick axes takes over from the curves when it is outside the center error margin.
+// The injected buttons, pressure and tilt values are passed through for the later stages to build on.
+// synthesize_pressure() and synthesize_tilt() fill in any of the fields it left at 0.
+static inline
+void translate_pad_input(const AxisCurveTables *curves, const SceCtrlData *pad_state,
+    const SceCtrlData2 *injected, SceCtrlData2 *pDst)
+{
+    pDst->buttons = injected->buttons;
+    pDst->DPadSenseA = injected->DPadSenseA;
+    pDst->DPadSenseB = injected->DPadSenseB;
+    pDst->GPadSenseA = injected->GPadSenseA;
+    pDst->GPadSenseB = injected->GPadSenseB;
+    pDst->AxisSenseA = injected->AxisSenseA;
+    pDst->AxisSenseB = injected->AxisSenseB;
+    pDst->TiltA = injected->TiltA;
+    pDst->TiltB = injected->TiltB;
+#if PIPELINE_CURVES
+    // Without a sample, report the stick at rest
+    u8 padX = pad_state != NULL ? pad_state->aX : SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    u8 padY = pad_state != NULL ? pad_state->aY : SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+
+    // Both emulated sticks are driven from the PSP stick, through their response curves
+#if STICK_SWAR
+    u32 translated = curves->x_words[padX] | curves->y_words[padY];
+    store_stick_word(&pDst->aX, merge_injected_sticks(translated, load_stick_word(&injected->aX)));
+#else
+    pDst->aX = merge_injected_axis(curves->lut[EMULATED_AXIS_AX][padX], injected->aX);
+    pDst->aY = merge_injected_axis(curves->lut[EMULATED_AXIS_AY][padY], injected->aY);
+    pDst->rX = merge_injected_axis(curves->lut[EMULATED_AXIS_RX][padX], injected->rX);
+    pDst->rY = merge_injected_axis(curves->lut[EMULATED_AXIS_RY][padY], injected->rY);
+#endif
+#elif STICK_SWAR
+    store_stick_word(&pDst->aX, load_stick_word(&injected->aX));
+#else
+    pDst->aX = injected->aX;
+    pDst->aY = injected->aY;
+    pDst->rX = injected->rX;
+    pDst->rY = injected->rY;
+#endif
+    pDst->rsrv[0] = -128;
+    pDst->rsrv[1] = -128;
+}
+
+//
+// Emulated ports
+//
+
+// The number of external controller ports the ctrl driver supports.
+#define EMULATED_PORT_COUNT (2)
+
+// Everything belonging to one emulated controller port. Passed to the controller callback as its input source.
+//
+// The configuration (response curves, remap, turbo periods) is shared by all ports, the state derived
+// from each port's own input history is not.
+typedef struct {
+    // The port number, SCE_CTRL_PORT_DS3 or SCE_CTRL_PORT_UNKNOWN_2.
+    u8 port;
+    // True if the PSP's own controls drive this port.
+    bool psp_input;
+    // True while the port is registered with the ctrl driver. Main thread owned.
+    bool registered;
+    PortInputSource input;
+    AnalogDirectionState direction_state;
+    TurboState turbo_state;
+    PressureState pressure_state;
+#if TILT_SOURCE != TILT_SOURCE_NONE
+    TiltFilterState tilt_state;
+#endif
+    // True if the previous poll ran the whole pipeline on idle input, and left every stage at rest.
+    bool idle_settled;
+    // The number of polls, and the number of them that took the idle fast path.
+    u32 polls;
+    u32 idle_polls;
+#if INJECTION_BACKEND == INJECTION_BACKEND_EMULATION_SLOTS
+    // True while the port's emulation slot holds an off center left stick.
+    bool slot_stick;
+#endif
+#if POLL_STATS
+    PollStats poll_stats;
+    // Whether the last poll used a PSP sample, and the sample's timestamp.
+    bool pad_sampled;
+    u32 pad_sample_time;
+#endif
+} EmulatedPort;
+
+#define EMULATED_PORT_INIT(port_number) { \
+    .port = (port_number), \
+    .psp_input = (CONTROLLER_PSP_INPUT_PORTS & CONTROLLER_PORT_BIT(port_number)) != 0, \
+    .input = { \
+        .channel = { \
+            .sequence = 0, \
+            .frames = { INPUT_CHANNEL_NEUTRAL_FRAME, INPUT_CHANNEL_NEUTRAL_FRAME }, \
+            .idle = { true, true }, \
+            .last_read = INPUT_CHANNEL_NEUTRAL_FRAME, \
+        }, \
+    }, \
+}
+
+// Indexed by port number - 1.
+static EmulatedPort g_ports[EMULATED_PORT_COUNT] = {
+    EMULATED_PORT_INIT(SCE_CTRL_PORT_DS3),
+    EMULATED_PORT_INIT(SCE_CTRL_PORT_UNKNOWN_2),
+};
+
+#if INJECTION_BACKEND == INJECTION_BACKEND_PORT_HANDLER
+// The ports currently passed through into their emulation slots, as the bit field taken by sceCtrl_driver_6C86AF22().
+// Main thread owned.
+static u32 g_passthrough_mask = 0;
+#endif
+
+// Returns the emulated port with the given port number, or NULL if the port is not one of CONTROLLER_PORTS.
+static inline
+EmulatedPort *emulated_port(u32 port)
+{
+    if(port < 1 || port > EMULATED_PORT_COUNT || (CONTROLLER_PORTS & CONTROLLER_PORT_BIT(port)) == 0) {
+        return NULL;
+    }
+
+    return &g_ports[port - 1];
+}
+
+//
+// Idle fast path
+//
+
+#if PIPELINE_IDLE_FAST_PATH && TILT_SOURCE != TILT_SOURCE_STICK \
+    && ANALOG_PAD_DIRECTION_RELEASE_THRESHOLD > CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN \
+    && (ANALOG_PAD_MODE != ANALOG_PAD_MODE_RADIAL || ANALOG_PAD_RADIAL_RELEASE_DEADZONE > CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN)
+#define IDLE_FAST_PATH (1)
+#else
+#define IDLE_FAST_PATH (0)
+#endif
+
+#if IDLE_FAST_PATH
+
+// True if nothing feeds the port on this poll: no injected input, and the PSP stick within the center error margin.
+// Within the margin the stick never reaches a direction threshold, so it only moves the emulated sticks.
+static inline
+bool port_input_idle(EmulatedPort *port, const SceCtrlData *pad)
+{
+    if(port->input.queue.head != port->input.queue.tail || !input_channel_idle(&port->input.channel)) {
+        return false;
+    }
+
+    if(pad == NULL) {
+        return true;
+    }
+
+#if TILT_SOURCE == TILT_SOURCE_BUTTONS
+    if((pad->buttons & (TILT_BUTTON_LEFT | TILT_BUTTON_RIGHT | TILT_BUTTON_UP | TILT_BUTTON_DOWN)) != 0) {
+        return false;
+    }
+#endif
+
+#if STICK_SWAR
+    return (stick_word_outside_margin(load_stick_word(&pad->aX)) & STICK_WORD_LEFT_STICK) == 0;
+#else
+    return axis_is_centered(pad->aX) && axis_is_centered(pad->aY);
+#endif
+}
+
+// True if the stages left no state behind that would change the output of the next idle poll.
+// Called after the whole pipeline ran on idle input.
+static inline
+bool port_pipeline_settled(const EmulatedPort *port, const SceCtrlData2 *frame)
+{
+    // The output carries no buttons (so no pressure either), and no tilt
+    bool settled = frame->buttons == 0 && frame->TiltA == 0 && frame->TiltB == 0;
+
+#if PIPELINE_DIRECTIONS
+    settled = settled && port->direction_state.buttons == 0 && port->direction_state.raw_buttons == 0;
+#endif
+#if PIPELINE_TURBO
+    settled = settled && port->turbo_state.off_phase == 0;
+#endif
+#if PIPELINE_PRESSURE
+    settled = settled && (port->pressure_state.button_ramp[0] | port->pressure_state.button_ramp[1]
+        | port->pressure_state.button_ramp[2] | port->pressure_state.button_ramp[3]) == 0;
+#endif
+#if TILT_SOURCE != TILT_SOURCE_NONE
+    settled = settled && tilt_filter_settled(&port->tilt_state);
+#endif
+
+    return settled;
+}
+
+// Writes the output of an idle poll: nothing but the emulated sticks, which still follow the PSP stick
+// through their response curves inside the center error margin.
+static inline
+void write_idle_frame(const AxisCurveTables *curves, const SceCtrlData *pad, SceCtrlData2 *pDst)
+{
+    pDst->buttons = 0;
+    pDst->DPadSenseA = 0;
+    pDst->DPadSenseB = 0;
+    pDst->GPadSenseA = 0;
+    pDst->GPadSenseB = 0;
+    pDst->AxisSenseA = 0;
+    pDst->AxisSenseB = 0;
+    pDst->TiltA = 0;
+    pDst->TiltB = 0;
+#if PIPELINE_CURVES
+    u8 padX = pad != NULL ? pad->aX : SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    u8 padY = pad != NULL ? pad->aY : SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+
+#if STICK_SWAR
+    store_stick_word(&pDst->aX, curves->x_words[padX] | curves->y_words[padY]);
+#else
+    pDst->aX = curves->lut[EMULATED_AXIS_AX][padX];
+    pDst->aY = curves->lut[EMULATED_AXIS_AY][padY];
+    pDst->rX = curves->lut[EMULATED_AXIS_RX][padX];
+    pDst->rY = curves->lut[EMULATED_AXIS_RY][padY];
+#endif
+#elif STICK_SWAR
+    store_stick_word(&pDst->aX, STICK_WORD_CENTERED);
+#else
+    pDst->aX = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    pDst->aY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    pDst->rX = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    pDst->rY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+#endif
+    pDst->rsrv[0] = -128;
+    pDst->rsrv[1] = -128;
+}
+
+#endif
+
+//
+// Controller callback function
+//
+
+#if SAMPLING_CYCLE_MANAGED
+
+// Set by the controller callback when a poll produces any output, and cleared by the main thread when it
+// checks the sampling cycle policy. This stands in for the main thread looking at the ports itself.
+static volatile bool g_sampling_cycle_input_seen = false;
+
+// Notes a poll's output as input for the policy. Called from the controller callback.
+static inline
+void sampling_cycle_note_poll(const SceCtrlData2 *frame)
+{
+    if(!input_frame_is_idle(frame)) {
+        g_sampling_cycle_input_seen = true;
+    }
+}
+
+#endif
+
+// True if any enabled pipeline stage reads the PSP controller sample.
+#define PIPELINE_PAD_SAMPLE (PIPELINE_DIRECTIONS || PIPELINE_CURVES || TILT_SOURCE != TILT_SOURCE_NONE)
+
+// Produces the port's output frame for one poll.
+static inline
+void process_poll(EmulatedPort *port, SceCtrlData2 *pDst)
+{
+#if INPUT_TRACE_MODE == INPUT_TRACE_MODE_REPLAY
+    // While a replay is running it replaces the live input entirely
+    u32 timeStamp = pDst->timeStamp;
+    if(port->port == INPUT_TRACE_PORT && replay_frame(&g_replay, timeStamp, pDst)) {
+        pDst->timeStamp = timeStamp;
+        return;
+    }
+#endif
+
+    // Source: the PSP controller, if a stage reads it.
+    // The sample is taken once per cycle, by the first port that needs it, and shared with the other
+    const SceCtrlData *pad = NULL;
+#if PIPELINE_PAD_SAMPLE
+    SceCtrlData pad_state;
+    if(port->psp_input && shared_pad_sample_get(&g_shared_pad_sample, &g_pad_sample_stats, pDst->timeStamp, &pad_state)) {
+        pad = &pad_state;
+#if POLL_STATS
+        port->pad_sampled = true;
+        port->pad_sample_time = pad_state.timeStamp;
+#endif
+    }
+#endif
+
+    port->polls++;
+
+#if IDLE_FAST_PATH
+    bool idle = port_input_idle(port, pad);
+    if(idle && port->idle_settled) {
+        write_idle_frame(&g_axis_curve_tables, pad, pDst);
+        port->idle_polls++;
+    }
+    else
+#endif
+    {
+        // Source: the injected input. A due queued frame replaces the live frame for this poll
+        SceCtrlData2 injected = INPUT_CHANNEL_NEUTRAL_FRAME;
+        if(!input_queue_pop_due(&port->input.queue, pDst->timeStamp, &injected)) {
+            input_channel_read(&port->input.channel, &injected);
+        }
+
+        translate_pad_input(&g_axis_curve_tables, pad, &injected, pDst);
+
+#if PIPELINE_DIRECTIONS
+        // Demo - translate PSP analog input into DS3 directional pad buttons
+        u32 direction_buttons = 0;
+        if(pad != NULL) {
+            direction_buttons = analog_direction_buttons(&port->direction_state, pad->aX, pad->aY);
+            pDst->buttons |= direction_buttons;
+        }
+#endif
+
+#if PIPELINE_REMAP
+        pDst->buttons = remap_buttons(pDst->buttons);
+#endif
+
+#if PIPELINE_TURBO
+        pDst->buttons = apply_turbo(&port->turbo_state, pDst->buttons);
+#endif
+
+#if PIPELINE_PRESSURE
+#if PIPELINE_DIRECTIONS
+        synthesize_pressure(&port->pressure_state, direction_buttons,
+            pad != NULL ? pad->aX : SCE_CTRL_ANALOG_PAD_CENTER_VALUE,
+            pad != NULL ? pad->aY : SCE_CTRL_ANALOG_PAD_CENTER_VALUE, pDst);
+#else
+        // Without stick driven directions every D-pad press is digital
+        synthesize_pressure(&port->pressure_state, 0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, pDst);
+#endif
+#endif
+
+#if TILT_SOURCE != TILT_SOURCE_NONE
+        synthesize_tilt(&port->tilt_state, pad, pDst);
+#endif
+
+#if IDLE_FAST_PATH
+        port->idle_settled = idle && port_pipeline_settled(port, pDst);
+#endif
+    }
+
+#if INPUT_TRACE_MODE == INPUT_TRACE_MODE_RECORD
+    if(port->port == INPUT_TRACE_PORT) {
+        record_frame(&g_record_ring, pDst);
+    }
+#endif
+
+    if(pDst->buttons) {
+        DEBUG_LOG(DEBUG_LOG_POLL_BUTTONS, port->port, pDst->timeStamp, pDst->buttons);
+    }
+}
+
+static
+s32 ctrl_input_data_handler_func(void *pSrc, SceCtrlData2 *pDst)
+{
+    // pSrc is set up to point to the EmulatedPort being polled.
+    EmulatedPort *port = (EmulatedPort *)pSrc;
+    if(port == NULL) {
+        return 0;
+    }
+
+#if POLL_STATS
+    u32 start_cycles = read_cycle_counter();
+    u32 entry_time = sceKernelGetSystemTimeLow();
+    u32 timestamp = pDst->timeStamp;
+    port->pad_sampled = false;
+
+    process_poll(port, pDst);
+
+    poll_stats_update(&port->poll_stats, timestamp, entry_time, read_cycle_counter() - start_cycles,
+        port->pad_sampled, port->pad_sample_time);
+#else
+    process_poll(port, pDst);
+#endif
+
+    shared_pad_sample_note_output(&g_shared_pad_sample, pDst);
+
+#if SAMPLING_CYCLE_MANAGED
+    sampling_cycle_note_poll(pDst);
+#endif
+
+    // Success
+    return 0;
+}
+
+#if INJECTION_BACKEND == INJECTION_BACKEND_PORT_HANDLER
+
+// Setup sceCtrl_driver_E467BEC8() external controller port input handler.
+// This set the input data source for a controller port, similar to how the DS3 controller
+// is wired up internally to padsvc (Bluetooth -> DS3) on PSP Go.
+//
+// The copyInputData function is type SceCtrlInputDataTransferHandler and is called on every polling loop.
+static SceCtrlInputDataTransferHandler g_controller_data_transfer_handler = {
+    // GUESS: unk1 is the handler structure size. This is common in many SCE handler structures.
+    .unk1 = sizeof(SceCtrlInputDataTransferHandler),
+    .copyInputData = ctrl_input_data_handler_func
+};
+
+//
+// Controller port registration
+//
+
+// Registers ctrl_input_data_handler_func() as the input source of an external controller port and enables
+// passthrough of that port into its emulation slot, on top of the ports already passed through.
+//
+// This is the whole contract between the plugin and the ctrl driver: after this call the driver invokes
+// copyInputData once per sampling cycle, and copies the result into the emulation slot for the normal
+// read/peek functions.
+static
+s32 register_controller_port(u8 port, void *input_source)
+{
+    s32 result;
+
+    DEBUG_PRINT("Setting controller input handler for port %d\n", port);
+
+    // sceCtrl_driver_E467BEC8(u8 externalPort, SceCtrlInputDataTransferHandler *transferHandler, void *inputSource)
+    // The inputSource ptr is passed through into the handler function as the first argument, so it can be
+    // used as an input buffer for controller inputs.
+    //
+    // The driver keeps the transferHandler pointer rather than copying the structure, so it must stay valid
+    // until the handler is unset.
+    result = sceCtrl_driver_E467BEC8(port, &g_controller_data_transfer_handler, input_source);
+
+    if(result != SCE_ERROR_OK) {
+        DEBUG_PRINT("Failed to set controller input handler: ret 0x%08x\n", result);
+        return result;
+    }
+
+    // sceCtrl_driver_6C86AF22() enables passing through controller state from a specific external controller port buffer
+    // into the emulation state slot with the same index as the port.
+    // This is the same emulation state set by sceCtrlSetButtonEmulation() and sceCtrlSetAnalogEmulation().
+    //
+    // It is effectively a thin setter function for g_ctrl.unk768.
+    // For how this enables passthrough, see: https://github.com/uofw/uofw/blob/7ca6ba13966a38667fa7c5c30a428ccd248186cf/src/kd/ctrl/ctrl.c#L1782-L1803
+    //
+    // This allows the state to be read with the basic controller read functions that return SceCtrlData, such as
+    // sceCtrlReadBufferPositive, because these functions sample the emulation state.
+    //
+    // The argument is a bit field with bits set corresponding to the ports.
+    // 0x01 enables SCE_CTRL_PORT_DS3 passthrough
+    // 0x02 enables SCE_CTRL_PORT_UNKNOWN_2
+    // 0x00 disables passthrough such that it can only be read by the extended/extra functions that return SceCtrlData2,
+    // such as sceCtrlReadBufferPositive2(), that takes the specific port number as an argument 
+    //
+    // The setter replaces the whole bit field, so it is always passed every port registered so far.
+    g_passthrough_mask |= CONTROLLER_PORT_BIT(port);
+    sceCtrl_driver_6C86AF22(g_passthrough_mask);
+
+    return result;
+}
+
+// Unsets the input source of an external controller port previously set by register_controller_port().
+static
+s32 unregister_controller_port(u8 port)
+{
+    s32 result;
+
+    DEBUG_PRINT("Unsetting controller input handler for port %d\n", port);
+
+    g_passthrough_mask &= ~CONTROLLER_PORT_BIT(port);
+    sceCtrl_driver_6C86AF22(g_passthrough_mask);
+
+    result = sceCtrl_driver_E467BEC8(port, NULL, NULL);
+    if(result < 0) {
+        DEBUG_PRINT("Failed to unset controller input handler: ret 0x%08x\n", result);
+    }
+
+    return result;
+}
+
+#endif
+
+//
+// Emulation slot backend
+//
+
+#if INJECTION_BACKEND == INJECTION_BACKEND_EMULATION_SLOTS
+
+// The emulation slot thread's priority. Like the driver's own polls, it has to run ahead of the game threads.
+#define EMULATION_SLOT_THREAD_PRIORITY (0x10)
+
+// The buttons the emulation slots report to user mode apps. Kernel mode apps get all of them.
+#define EMULATION_SLOT_USER_BUTTONS (0x0000FFFF)
+
+static SceUID g_emulationSlotThreadId = -1;
+
+// Runs the controller callback for one port, as the driver would, and writes the output into the port's emulation slot.
+static
+void update_emulation_slot(EmulatedPort *port)
+{
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+    frame.timeStamp = sceKernelGetSystemTimeLow();
+
+    ctrl_input_data_handler_func(port, &frame);
+
+    sceCtrlSetButtonEmulation(port->port, frame.buttons & EMULATION_SLOT_USER_BUTTONS, frame.buttons, EMULATION_SLOT_DURATION);
+
+    // A centered stick isn't written, and the slot's stick is cleared, so the PSP stick shows through again
+    // from the next sample on, as the callback expects
+    if(!axis_is_centered(frame.aX) || !axis_is_centered(frame.aY)) {
+        sceCtrlSetAnalogEmulation(port->port, frame.aX, frame.aY, EMULATION_SLOT_DURATION);
+        port->slot_stick = true;
+    }
+    else if(port->slot_stick) {
+        sceCtrlSetAnalogEmulation(port->port, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, 0);
+        port->slot_stick = false;
+    }
+}
+
+// The emulation slot thread. Updates the slot of every registered port each period, until a stop is requested.
+//
+// Unlike the driver's sampling interrupt, this thread can be preempted by the exported functions. The remap
+// and turbo configurations are published by swapping a pointer to one of two buffers, and rebuilt in the
+// other buffer on the next change, which is only safe if the callback can't still be reading it. So the
+// updates run under the input writer lock, and a change can't start until the callback has finished.
+static
+int emulation_slot_thread(SceSize args, void *argp)
+{
+    while(!g_stop_requested) {
+#if EMULATION_SLOT_PERIOD == 0
+        sceDisplayWaitVblankStart();
+#else
+        sceKernelDelayThread(EMULATION_SLOT_PERIOD);
+#endif
+
+        if(lock_input_writer() < 0) {
+            continue;
+        }
+
+        for(u32 i = 0; i < EMULATED_PORT_COUNT; i++) {
+            if(g_ports[i].registered) {
+                update_emulation_slot(&g_ports[i]);
+            }
+        }
+
+        unlock_input_writer();
+    }
+
+    return 0;
+}
+
+// Marks the enabled ports as registered, and starts the thread that feeds their emulation slots.
+static
+int start_emulation_slot_thread(void)
+{
+    for(u32 i = 0; i < EMULATED_PORT_COUNT; i++) {
+        EmulatedPort *port = emulated_port(i + 1);
+        if(port != NULL) {
+            port->registered = true;
+        }
+    }
+
+    return start_thread(MODULE_NAME "EmulationSlots", emulation_slot_thread, EMULATION_SLOT_THREAD_PRIORITY, &g_emulationSlotThreadId);
+}
+
+// Must be called after g_stop_requested is set.
+// The slots aren't cleared, they expire EMULATION_SLOT_DURATION samples after the last update.
+static
+void stop_emulation_slot_thread(void)
+{
+    stop_thread(&g_emulationSlotThreadId, 4 * TIMER_PERIOD);
+}
+
+#endif
+
+//
+// Exported API
+//
+// These are exported to other kernel modules through the EmuCtrl_driver library, and to user mode
+// through the EmuCtrl syscall library. See emu_ctrl.h.
+//
+
+// True if the buffer is accessible to the caller that the k1 value belongs to.
+// k1 has its top bit set for syscalls from user mode, which user buffers never have set.
+#define K1_BUFFER_OK(k1, ptr, size) \
+    ((s32)(((((u32)(ptr)) + (size)) | ((u32)(ptr)) | (size)) & (k1)) >= 0)
 
-#include <stdbool.h>
-#include <inttypes.h>
+static
+s32 lock_input_writer(void)
+{
+    return sceKernelWaitSema(g_input_writer_sema, 1, NULL);
+}
 
+static
+void unlock_input_writer(void)
+{
+    sceKernelSignalSema(g_input_writer_sema, 1);
+}
 
-#define str(s) #s // For stringizing defines
-#define xstr(s) str(s)
+s32 emuCtrlSetInputFrame(u32 port, const SceCtrlData2 *frame)
+{
+    u32 k1 = pspSdkGetK1();
+    EmulatedPort *emulated = emulated_port(port);
+    s32 result;
 
-#ifdef DEBUG
-#define DEBUG_PRINT(...) pspDebugScreenKprintf( __VA_ARGS__ )
-#else
-#define DEBUG_PRINT(...) do{ } while ( 0 )
-#endif
+    if(emulated == NULL) {
+        return SCE_ERROR_INVALID_VALUE;
+    }
 
-#define ONE_MSEC (1000)
+    if(frame == NULL || ((u32)frame & 3) != 0) {
+        return SCE_ERROR_INVALID_POINTER;
+    }
 
-#define TIMER_PERIOD (10 * ONE_MSEC)
+    if(!K1_BUFFER_OK(k1, frame, sizeof(SceCtrlData2))) {
+        return SCE_ERROR_PRIV_REQUIRED;
+    }
 
-// The controller port for which to handle input.
-// Can be either:
-// * SCE_CTRL_PORT_DS3
-// * SCE_CTRL_PORT_UNKNOWN_2
-#define CONTROLLER_PORT SCE_CTRL_PORT_DS3
+    pspSdkSetK1(0);
 
-// The smallest offset from the analog stick's center position defining the guaranteed
-// range (center position +/- this offset) the stick returns to when being released.
-//
-// This is the same value used within the firmware to register analogue input and cancel the idle timer.
-//
-#define CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN (37)
+    result = lock_input_writer();
+    if(result >= 0) {
+        input_channel_write(&emulated->input.channel, frame);
+        unlock_input_writer();
+        result = SCE_ERROR_OK;
+    }
 
-// The minimum amount of stick movement from center to register as a directional input.
-#define ANALOG_PAD_DIRECTION_THRESHOLD (CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN + 23)
+    pspSdkSetK1(k1);
+    return result;
+}
 
+s32 emuCtrlSubmitFrames(u32 port, const SceCtrlData2 *frames, u32 count)
+{
+    u32 k1 = pspSdkGetK1();
+    EmulatedPort *emulated = emulated_port(port);
+    s32 result;
 
-#define MODULE_NAME "EmulatedControllerTest"
-#define MAJOR_VER 1
-#define MINOR_VER 1
+    if(emulated == NULL) {
+        return SCE_ERROR_INVALID_VALUE;
+    }
 
-#define MODULE_OK       0
-#define MODULE_ERROR    1
+    if(count == 0) {
+        return 0;
+    }
 
-// https://github.com/uofw/uofw/blob/7ca6ba13966a38667fa7c5c30a428ccd248186cf/include/common/errors.h
-#define SCE_ERROR_OK                                0x0
-#define SCE_ERROR_BUSY                              0x80000021
+    if(frames == NULL || ((u32)frames & 3) != 0) {
+        return SCE_ERROR_INVALID_POINTER;
+    }
 
-//
-// PSP SDK
-//
-// We are building a kernel mode prx plugin
-PSP_MODULE_INFO(MODULE_NAME, PSP_MODULE_KERNEL, MAJOR_VER, MINOR_VER);
+    if(count > INPUT_QUEUE_LENGTH) {
+        count = INPUT_QUEUE_LENGTH;
+    }
 
-// We don't allocate any heap memory, so set this to 0.
-PSP_HEAP_SIZE_KB(0);
-//PSP_MAIN_THREAD_ATTR(0);
-//PSP_MAIN_THREAD_NAME(MODULE_NAME);
+    if(!K1_BUFFER_OK(k1, frames, count * sizeof(SceCtrlData2))) {
+        return SCE_ERROR_PRIV_REQUIRED;
+    }
 
-// We don't need a main thread since we only do basic setup during module start and won't stall module loading.
-// This will make us be called from the module loader thread directly, instead of a secondary kernel thread.
-PSP_NO_CREATE_MAIN_THREAD();
+    pspSdkSetK1(0);
 
-// We don't need any of the newlib features since we're not calling into stdio or stdlib etc
-PSP_DISABLE_NEWLIB();
+    // The whole batch goes in under a single lock and a single publish of the queue tail
+    result = lock_input_writer();
+    if(result >= 0) {
+        result = input_queue_push(&emulated->input.queue, frames, count);
+        unlock_input_writer();
+    }
 
-//
-// Forward declarations
-//
-static int main_thread(SceSize args, void *argp);
-static int start_main_thread(void);
-static int stop_main_thread(void);
-int module_start(SceSize args, void *argp);
-int module_stop(SceSize args, void *argp);
+    pspSdkSetK1(k1);
+    return result;
+}
 
-//
-// Globals
-//
-static SceUInt g_button_state = 0;
-static SceUID g_mainThreadId = -1;
+s32 emuCtrlSetButtonRemap(const u32 *map)
+{
+    u32 k1 = pspSdkGetK1();
+    u32 local_map[32];
+    s32 result;
+
+    if(map != NULL) {
+        if(((u32)map & 3) != 0) {
+            return SCE_ERROR_INVALID_POINTER;
+        }
+
+        if(!K1_BUFFER_OK(k1, map, sizeof(local_map))) {
+            return SCE_ERROR_PRIV_REQUIRED;
+        }
+
+        for(u32 bit = 0; bit < 32; bit++) {
+            local_map[bit] = map[bit];
+        }
+    }
+    else {
+        for(u32 bit = 0; bit < 32; bit++) {
+            local_map[bit] = 1u << bit;
+        }
+    }
+
+    pspSdkSetK1(0);
+
+    result = lock_input_writer();
+    if(result >= 0) {
+        button_remap_build(local_map);
+        unlock_input_writer();
+        result = SCE_ERROR_OK;
+    }
+
+    pspSdkSetK1(k1);
+    return result;
+}
+
+s32 emuCtrlSetTurbo(u32 buttons, u32 on_polls, u32 off_polls)
+{
+    u32 k1;
+    s32 result;
+
+    if((buttons & ~TURBO_BUTTONS_MASK) != 0 || on_polls > TURBO_MAX_PERIOD || off_polls > TURBO_MAX_PERIOD
+        || (on_polls != 0 && off_polls == 0)) {
+        return SCE_ERROR_INVALID_VALUE;
+    }
+
+    k1 = pspSdkSetK1(0);
+
+    result = lock_input_writer();
+    if(result >= 0) {
+        turbo_configure(buttons, on_polls, off_polls);
+        unlock_input_writer();
+        result = SCE_ERROR_OK;
+    }
+
+    pspSdkSetK1(k1);
+    return result;
+}
+
+s32 emuCtrlGetPollStats(u32 port, EmuCtrlPollStats *stats)
+{
+    u32 k1 = pspSdkGetK1();
+    EmulatedPort *emulated = emulated_port(port);
+    s32 result;
+
+    if(emulated == NULL) {
+        return SCE_ERROR_INVALID_VALUE;
+    }
+
+    if(stats == NULL || ((u32)stats & 3) != 0) {
+        return SCE_ERROR_INVALID_POINTER;
+    }
+
+    if(!K1_BUFFER_OK(k1, stats, sizeof(EmuCtrlPollStats))) {
+        return SCE_ERROR_PRIV_REQUIRED;
+    }
+
+#if POLL_STATS
+    pspSdkSetK1(0);
+
+    // Only reads, so it doesn't need the writer lock
+    result = poll_stats_read(&emulated->poll_stats, stats) ? SCE_ERROR_OK : SCE_ERROR_BUSY;
+
+    pspSdkSetK1(k1);
+#else
+    result = SCE_ERROR_NOT_SUPPORTED;
+#endif
+
+    return result;
+}
+
+s32 emuCtrlGetQueuedFrameCount(u32 port)
+{
+    EmulatedPort *emulated = emulated_port(port);
+
+    if(emulated == NULL) {
+        return SCE_ERROR_INVALID_VALUE;
+    }
+
+    return emulated->input.queue.tail - emulated->input.queue.head;
+}
 
 //
-// Controller callback function
+// Sampling cycle policy
 //
+
+#if SAMPLING_CYCLE_MANAGED
+
+// The PSP buttons that count as input. The kernel buttons (HOME, volume, HOLD etc) don't.
+#define SAMPLING_CYCLE_INPUT_BUTTONS (0x0000FFFF)
+
+// The number of passes of the main thread's service loop between checks of the policy.
+#define SAMPLING_CYCLE_CHECK_PASSES (SAMPLING_CYCLE_CHECK_PERIOD / MAIN_THREAD_PERIOD)
+
+// Main thread state of the sampling cycle policy.
+typedef struct {
+    u32 policy;
+    // The cycle the app set, which the policies fall back to and which is restored on stop.
+    u32 app_cycle;
+    // The cycle as of the last update, to notice the app changing it.
+    u32 cycle;
+    // The system time input was last seen at.
+    u32 last_input_time;
+    // Service loop passes since the last check.
+    u32 passes;
+} SamplingCyclePolicy;
+
+static SamplingCyclePolicy g_sampling_cycle_policy = { 0 };
+
+// True if there is any input: emulated port output the callback saw since the last check, or the PSP controls
+// as they are now. The PSP controls are only looked at here, so a press shorter than a check can be missed.
 static
-s32 ctrl_input_data_handler_func(void *pSrc, SceCtrlData2 *pDst)
+bool sampling_cycle_input_active(void)
 {
-    // pSrc is set up to point to g_button_state.
-    // Currently g_button_state is always 0, but it is included here for extensibility.
-    SceUInt* p_new_buttons = (SceUInt*)pSrc;
-    SceUInt new_buttons = p_new_buttons != NULL ? *p_new_buttons : 0;
+    SceCtrlData pad;
 
-    u8 rightX = 0;
-    u8 rightY = 0;
+    if(g_sampling_cycle_input_seen) {
+        g_sampling_cycle_input_seen = false;
+        return true;
+    }
 
-    // Demo - translate PSP analog input into DS3 directional pad buttons
-    SceCtrlData pad_state;
-    if(sceCtrlPeekBufferPositive(&pad_state, 1) >= 0) {
+    return sceCtrlPeekBufferPositive(&pad, 1) > 0
+        && ((pad.buttons & SAMPLING_CYCLE_INPUT_BUTTONS) != 0 || !axis_is_centered(pad.aX) || !axis_is_centered(pad.aY));
+}
 
-        // Test: Write right stick values as inverse of left stick
-        rightX = 255 - pad_state.aX;
-        rightY = 255 - pad_state.aY;
+static
+void sampling_cycle_policy_start(SamplingCyclePolicy *state)
+{
+    switch(sceKernelInitKeyConfig()) {
+        case PSP_INIT_KEYCONFIG_VSH:
+            state->policy = SAMPLING_CYCLE_POLICY_VSH;
+            break;
+        case PSP_INIT_KEYCONFIG_GAME:
+            state->policy = SAMPLING_CYCLE_POLICY_GAME;
+            break;
+        case PSP_INIT_KEYCONFIG_POPS:
+            state->policy = SAMPLING_CYCLE_POLICY_POPS;
+            break;
+        default:
+            state->policy = SAMPLING_CYCLE_POLICY_APP;
+            break;
+    }
 
-        int pad_x = pad_state.aX - SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
-        int pad_y = pad_state.aY - SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    sceCtrlGetSamplingCycle(&state->app_cycle);
+    state->cycle = state->app_cycle;
+    state->last_input_time = sceKernelGetSystemTimeLow();
+    state->passes = 0;
 
-        SceUInt direction_buttons = 0;
-        if(pad_x > ANALOG_PAD_DIRECTION_THRESHOLD) {
-            direction_buttons |= SCE_CTRL_RIGHT;
-        }
+    DEBUG_PRINT("Sampling cycle policy %u, app cycle %u\n", state->policy, state->app_cycle);
+}
 
-        if(pad_x <= -ANALOG_PAD_DIRECTION_THRESHOLD) {
-            direction_buttons |= SCE_CTRL_LEFT;
-        }
+// Switches the sampling cycle as the policy requires. Called from the main thread every MAIN_THREAD_PERIOD,
+// and checks every SAMPLING_CYCLE_CHECK_PERIOD.
+static
+void sampling_cycle_policy_update(SamplingCyclePolicy *state)
+{
+    if(state->policy == SAMPLING_CYCLE_POLICY_APP || ++state->passes < SAMPLING_CYCLE_CHECK_PASSES) {
+        return;
+    }
+    state->passes = 0;
+
+    u32 cycle;
+    sceCtrlGetSamplingCycle(&cycle);
+    if(cycle != state->cycle) {
+        // The app set a cycle of its own
+        state->app_cycle = cycle;
+        state->cycle = cycle;
+    }
 
-        if(pad_y > ANALOG_PAD_DIRECTION_THRESHOLD) {
-            direction_buttons |= SCE_CTRL_DOWN;
-        }
+    u32 now = sceKernelGetSystemTimeLow();
+    if(sampling_cycle_input_active()) {
+        state->last_input_time = now;
+    }
+
+    bool idle = now - state->last_input_time >= SAMPLING_CYCLE_IDLE_TIMEOUT;
+    u32 target;
+    if(state->policy == SAMPLING_CYCLE_POLICY_LOW_LATENCY) {
+        target = idle ? state->app_cycle : SAMPLING_CYCLE_FAST;
+    }
+    else {
+        target = idle ? SAMPLING_CYCLE_SLOW : state->app_cycle;
+    }
 
-        if(pad_y <= -ANALOG_PAD_DIRECTION_THRESHOLD) {
-            direction_buttons |= SCE_CTRL_UP;
+    if(target != state->cycle) {
+        s32 result = sceCtrlSetSamplingCycle(target);
+        if(result < 0) {
+            DEBUG_PRINT("Failed to set sampling cycle %u: ret 0x%08x\n", target, result);
+            // Leave the cycle to the app from now on
+            state->policy = SAMPLING_CYCLE_POLICY_APP;
+            return;
         }
 
-        new_buttons |= direction_buttons;
+        state->cycle = target;
     }
+}
 
-    if(new_buttons) {
-        DEBUG_PRINT("Ctrl handler timestamp: 0x%08x, buttons: 0x%08x\n", pDst->timeStamp, new_buttons);
+// Restores the app's cycle. Called from the main thread on cleanup.
+static
+void sampling_cycle_policy_stop(SamplingCyclePolicy *state)
+{
+    if(state->cycle != state->app_cycle) {
+        sceCtrlSetSamplingCycle(state->app_cycle);
+        state->cycle = state->app_cycle;
     }
+}
 
-    pDst->buttons = new_buttons;
-    pDst->DPadSenseA = 0;
-    pDst->DPadSenseB = 0;
-    pDst->GPadSenseA = 0;
-    pDst->GPadSenseB = 0;
-    pDst->AxisSenseA = 0;
-    pDst->AxisSenseB = 0;
-    pDst->TiltA = 0;
-    pDst->TiltB = 0;
-    pDst->aX = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
-    pDst->aY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
-    pDst->rX = rightX;
-    pDst->rY = rightY;
-    pDst->rsrv[0] = -128;
-    pDst->rsrv[1] = -128;
+#endif
+
+//
+// Main thread
+//
 
-    // Success
-    return 0;
-}
 
 // The main thread.
 // * Sets up callbacks and timers
-// * Sleeps and processes callbacks
+// * Sleeps and processes callbacks, or every MAIN_THREAD_PERIOD services the input trace, the debug log and
+//   the sampling cycle policy
 // * Cleans up when awoken.
 static
 int main_thread(SceSize args, void *argp)
 {
-    SceUID ctrl_input_handler_res = -1;
-    int result;
-
     //
     // Setup
     //
 
-    DEBUG_PRINT("Setting controller input handler for " xstr(CONTROLLER_PORT) "\n");
-
-    // sceCtrl_driver_6C86AF22() enables passing through controller state from a specific external controller port buffer
-    // into the emulation state slot with the same index as the port.
-    // This is the same emulation state set by sceCtrlSetButtonEmulation() and sceCtrlSetAnalogEmulation().
-    //
-    // It is effectively a thin setter function for g_ctrl.unk768.
-    // For how this enables passthrough, see: https://github.com/uofw/uofw/blob/7ca6ba13966a38667fa7c5c30a428ccd248186cf/src/kd/ctrl/ctrl.c#L1782-L1803
-    //
-    // This allows the state to be read with the basic controller read functions that return SceCtrlData, such as
-    // sceCtrlReadBufferPositive, because these functions sample the emulation state.
-    //
-    // The argument is a bit field with bits set corresponding to the ports.
-    // 0x01 enables SCE_CTRL_PORT_DS3 passthrough
-    // 0x02 enables SCE_CTRL_PORT_UNKNOWN_2
-    // 0x00 disables passthrough such that it can only be read by the extended/extra functions that return SceCtrlData2,
-    // such as sceCtrlReadBufferPositive2(), that takes the specific port number as an argument 
-    sceCtrl_driver_6C86AF22(1 << (CONTROLLER_PORT - 1));
-
-    // Setup sceCtrl_driver_E467BEC8() external controller port input handler.
-    // This set the input data source for a controller port, similar to how the DS3 controller
-    // is wired up internally to padsvc (Bluetooth -> DS3) on PSP Go.
-    //
-    // The copyInputData function is type SceCtrlInputDataTransferHandler and is called on every polling loop.
-    SceCtrlInputDataTransferHandler controller_data_transfer_handler = {
-        // GUESS: unk1 is the handler structure size. This is common in many SCE handler structures.
-        .unk1 = sizeof(SceCtrlInputDataTransferHandler),
-        .copyInputData = ctrl_input_data_handler_func
-    };
-
-    // sceCtrl_driver_E467BEC8(u8 externalPort, SceCtrlInputDataTransferHandler *transferHandler, void *inputSource)
-    // The inputSource ptr is passed through into the handler function as the first argument, so it can be
-    // used as an input buffer for controller inputs.
-    ctrl_input_handler_res = sceCtrl_driver_E467BEC8(CONTROLLER_PORT, &controller_data_transfer_handler, &g_button_state);
+#if INPUT_TRACE_MODE == INPUT_TRACE_MODE_RECORD
+    // Open the trace before any frames can be recorded.
+    // If this fails the port still works, frames are just discarded.
+    recorder_open(&g_recorder);
+#elif INPUT_TRACE_MODE == INPUT_TRACE_MODE_REPLAY
+    // Fill both replay buffers before the first poll can ask for a frame.
+    // If this fails the port falls back to the live stick.
+    if(replayer_open(&g_replayer) >= 0) {
+        replayer_fill(&g_replayer, &g_replay);
+        replayer_fill(&g_replayer, &g_replay);
+    }
+#endif
 
-    if(ctrl_input_handler_res != SCE_ERROR_OK) {
-        DEBUG_PRINT("Failed to set controller input handler: ret 0x%08x\n", ctrl_input_handler_res);
+#if INJECTION_BACKEND == INJECTION_BACKEND_PORT_HANDLER
+    for(u32 i = 0; i < EMULATED_PORT_COUNT; i++) {
+        EmulatedPort *port = emulated_port(i + 1);
+        if(port != NULL) {
+            port->registered = register_controller_port(port->port, port) == SCE_ERROR_OK;
+        }
     }
+#elif INJECTION_BACKEND == INJECTION_BACKEND_EMULATION_SLOTS
+    start_emulation_slot_thread();
+#else
+#error "Unknown INJECTION_BACKEND"
+#endif
 
     DEBUG_PRINT("Setting controller polling mode to enable joystick\n");
     sceCtrlSetSamplingMode(SCE_CTRL_INPUT_DIGITAL_ANALOG);
 
+#if SAMPLING_CYCLE_MANAGED
+    sampling_cycle_policy_start(&g_sampling_cycle_policy);
+#endif
+
     //
     // Sleep and process callbacks until we get woken up
     //
     DEBUG_PRINT("Now processing callbacks\n");
+#if !MAIN_THREAD_SERVICE_LOOP
     sceKernelSleepThreadCB();
+#else
+    while(!g_stop_requested) {
+#if INPUT_TRACE_MODE == INPUT_TRACE_MODE_RECORD
+        recorder_drain(&g_recorder, &g_record_ring);
+#elif INPUT_TRACE_MODE == INPUT_TRACE_MODE_REPLAY
+        replayer_fill(&g_replayer, &g_replay);
+#endif
+#if SAMPLING_CYCLE_MANAGED
+        sampling_cycle_policy_update(&g_sampling_cycle_policy);
+#endif
+#ifdef DEBUG
+        debug_log_drain(&g_debug_log);
+#endif
+        sceKernelDelayThreadCB(MAIN_THREAD_PERIOD);
+    }
+#endif
 
     //
     // Cleanup
     //
-    if(ctrl_input_handler_res == SCE_ERROR_OK) {
-        DEBUG_PRINT("Unsetting controller input handler for " xstr(CONTROLLER_PORT) "\n");
+#if SAMPLING_CYCLE_MANAGED
+    sampling_cycle_policy_stop(&g_sampling_cycle_policy);
+#endif
 
-        result = sceCtrl_driver_E467BEC8(CONTROLLER_PORT, NULL, NULL);
-        if(result < 0) {
-            DEBUG_PRINT("Failed to unset controller input handler: ret 0x%08x\n", result);
+#if INJECTION_BACKEND == INJECTION_BACKEND_EMULATION_SLOTS
+    stop_emulation_slot_thread();
+#endif
+
+    for(u32 i = 0; i < EMULATED_PORT_COUNT; i++) {
+        if(g_ports[i].registered) {
+#if INJECTION_BACKEND == INJECTION_BACKEND_PORT_HANDLER
+            unregister_controller_port(g_ports[i].port);
+#endif
+            g_ports[i].registered = false;
+
+            DEBUG_PRINT("Port %d idle polls: %u of %u\n", g_ports[i].port, g_ports[i].idle_polls, g_ports[i].polls);
+#if POLL_STATS
+            DEBUG_PRINT("Port %d stale PSP samples: %u of %u, max age %uus\n", g_ports[i].port,
+                g_ports[i].poll_stats.stats.stale_samples, g_ports[i].poll_stats.stats.sample_polls,
+                g_ports[i].poll_stats.stats.sample_age_max);
+#endif
         }
     }
 
-    return 0;
-}
+#ifdef DEBUG
+    // The handlers are unset, so nothing more will be logged
+    debug_log_drain(&g_debug_log);
+#endif
 
-static
-int start_main_thread(void)
-{
-    int result;
-    SceUID thid;
+    DEBUG_PRINT("PSP samples: %u, repeated: %u, missing: %u, shared: %u\n",
+        g_pad_sample_stats.samples, g_pad_sample_stats.repeated, g_pad_sample_stats.missing, g_pad_sample_stats.shared);
 
-    // name, entry, initPriority, stackSize, PspThreadAttributes, SceKernelThreadOptParam
-    thid = sceKernelCreateThread(MODULE_NAME "MainThread", main_thread, 0x11, 0x800, 0, 0);
-    if (thid >= 0) {
-        DEBUG_PRINT("Starting main thread\n");
-        result = sceKernelStartThread(thid, 0, 0);
-        if(result < 0) {
-            DEBUG_PRINT("Failed to start main thread: ret 0x%08x\n", result);
-        }
+#if INPUT_TRACE_MODE == INPUT_TRACE_MODE_RECORD
+    // The handler is unset, so the ring won't grow any more
+    recorder_drain(&g_recorder, &g_record_ring);
+    recorder_close(&g_recorder);
 
-        g_mainThreadId = thid;
+    if(g_record_ring.overflows != 0) {
+        DEBUG_PRINT("Input recording dropped %u frames\n", g_record_ring.overflows);
     }
-    else {
-        result = thid;
-        DEBUG_PRINT("Failed to create main thread: ret 0x%08x\n", result);
+#elif INPUT_TRACE_MODE == INPUT_TRACE_MODE_REPLAY
+    replayer_close(&g_replayer);
+
+    if(g_replay.underruns != 0) {
+        DEBUG_PRINT("Input replay ran dry on %u polls\n", g_replay.underruns);
     }
+#endif
 
-    return result;
+    return 0;
+}
+
+static
+int start_main_thread(void)
+{
+    return start_thread(MODULE_NAME "MainThread", main_thread, 0x11, &g_mainThreadId);
 }
 
 static
 int stop_main_thread(void)
 {
-    int result = 0;
-    SceUID thid = g_mainThreadId;
+    int result;
 
-    if(thid >= 0) {
-        // Unblock sceKernelSleepThreadCB() and have thread begin cleanup
-        result = sceKernelWakeupThread(thid);
-        if(result < 0) {
-            DEBUG_PRINT("Failed to wakeup main thread: ret 0x%08x\n", result);
-        }
+    if(g_mainThreadId < 0) {
+        return SCE_ERROR_OK;
+    }
 
-        // Wait for the main thread to clean up and exit
-        DEBUG_PRINT("Waiting for main thread exit ...\n");
-        result = sceKernelWaitThreadEnd(thid, NULL);
-        if(result < 0) {
-            // Thread did not stop, force terminate and delete it
-            DEBUG_PRINT("Failed to wait for main thread exit: ret 0x%08x\n", result);
-            DEBUG_PRINT("Terminating and deleting main thread\n", result);
-            result = sceKernelTerminateDeleteThread(thid);
-            if(result >= 0) {
-                g_mainThreadId = -1;
-            }
-            else {
-                DEBUG_PRINT("Failed to terminate delete callback thread: ret 0x%08x\n", result);
-            }
-        }
-        else {
-            DEBUG_PRINT("Deleting main thread\n");
-            // Thead stopped cleanly, delete it
-            result = sceKernelDeleteThread(thid);
-            if(result >= 0) {
-                DEBUG_PRINT("Main thread cleanup complete.\n");
-                g_mainThreadId = -1;
-            }
-            else {
-                DEBUG_PRINT("Failed to delete main thread: ret 0x%08x\n", result);
-            }
-        }
+    // Unblock sceKernelSleepThreadCB() or end the service loop, and have thread begin cleanup
+    g_stop_requested = true;
+    result = sceKernelWakeupThread(g_mainThreadId);
+    if(result < 0) {
+        DEBUG_PRINT("Failed to wakeup main thread: ret 0x%08x\n", result);
     }
 
-    return result;
+    // Wait for the main thread to clean up and exit
+    DEBUG_PRINT("Waiting for main thread exit ...\n");
+    return stop_thread(&g_mainThreadId, 0);
 }
 
 // Called during module init
@@ -323,8 +1987,27 @@ int module_start(SceSize args, void *argp)
 
     DEBUG_PRINT(MODULE_NAME " v" xstr(MAJOR_VER) "." xstr(MINOR_VER) " Module Start\n");
 
+    // The callback reads the PSP stick back with the port's output left stick merged over it. A curve on the
+    // emulated left stick would either be applied to its own output again, or hide the PSP stick it reads from.
+    if(g_axis_curves[EMULATED_AXIS_AX].type != AXIS_CURVE_CENTER || g_axis_curves[EMULATED_AXIS_AY].type != AXIS_CURVE_CENTER) {
+        DEBUG_PRINT("AXIS_CURVE_AX and AXIS_CURVE_AY must be AXIS_CURVE_CENTER\n");
+        return MODULE_ERROR;
+    }
+
+    axis_curves_build(&g_axis_curve_tables, g_axis_curves);
+    button_remap_build_defaults();
+    turbo_configure_defaults();
+
+    g_input_writer_sema = sceKernelCreateSema(MODULE_NAME "InputWriter", 0, 1, 1, NULL);
+    if(g_input_writer_sema < 0) {
+        DEBUG_PRINT("Failed to create input writer semaphore: ret 0x%08x\n", g_input_writer_sema);
+        return MODULE_ERROR;
+    }
+
     result = start_main_thread();
     if(result < 0) {
+        sceKernelDeleteSema(g_input_writer_sema);
+        g_input_writer_sema = -1;
         return MODULE_ERROR;
     }
 
@@ -345,6 +2028,11 @@ int module_stop(SceSize args, void *argp)
         return MODULE_ERROR;
     }
 
+    if(g_input_writer_sema >= 0) {
+        sceKernelDeleteSema(g_input_writer_sema);
+        g_input_writer_sema = -1;
+    }
+
     DEBUG_PRINT(MODULE_NAME " v" xstr(MAJOR_VER) "." xstr(MINOR_VER) " Module Stop\n");
 
     return MODULE_OK;
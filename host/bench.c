@@ -0,0 +1,200 @@
+// PSP-EmulatedControllerTest host build
+// Timing helpers shared by the host benchmarks. See bench.h.
+//
+// Ryan Crosby 2025
+
+#include "bench.h"
+
+#include "ctrl_imports.h"
+
+#include <linux/perf_event.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static int g_instructions_fd = -1;
+static bool g_instructions_tried = false;
+
+bool bench_quick(int argc, char **argv)
+{
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--quick") == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+u64 bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000 + (u64)now.tv_nsec;
+}
+
+static
+int compare_u64(const void *a, const void *b)
+{
+    u64 x = *(const u64 *)a;
+    u64 y = *(const u64 *)b;
+    return x < y ? -1 : x > y;
+}
+
+u64 bench_timer_overhead_ns(void)
+{
+    enum { SAMPLES = 10000 };
+    static u64 samples[SAMPLES];
+
+    for(u32 i = 0; i < SAMPLES; i++) {
+        u64 start = bench_now_ns();
+        samples[i] = bench_now_ns() - start;
+    }
+
+    qsort(samples, SAMPLES, sizeof(u64), compare_u64);
+    return samples[SAMPLES / 2];
+}
+
+bool bench_instructions_start(void)
+{
+    if(!g_instructions_tried) {
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        g_instructions_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        g_instructions_tried = true;
+    }
+
+    if(g_instructions_fd < 0) {
+        return false;
+    }
+
+    ioctl(g_instructions_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(g_instructions_fd, PERF_EVENT_IOC_ENABLE, 0);
+    return true;
+}
+
+s64 bench_instructions_stop(void)
+{
+    u64 count;
+
+    if(g_instructions_fd < 0) {
+        return -1;
+    }
+
+    ioctl(g_instructions_fd, PERF_EVENT_IOC_DISABLE, 0);
+    if(read(g_instructions_fd, &count, sizeof(count)) != sizeof(count)) {
+        return -1;
+    }
+
+    return (s64)count;
+}
+
+void bench_summarize(u64 *samples, u32 count, BenchResult *result)
+{
+    qsort(samples, count, sizeof(u64), compare_u64);
+
+    result->p50_ns = samples[count / 2];
+    result->p99_ns = samples[(u64)count * 99 / 100];
+    result->max_ns = samples[count - 1];
+}
+
+void bench_print_header(const char *title)
+{
+    printf("%s\n", title);
+    printf("%-24s %10s %8s %8s %10s %12s\n", "", "ns/call", "p50", "p99", "max", "instr/call");
+}
+
+void bench_print_result(const char *name, const BenchResult *result)
+{
+    char instructions[32];
+
+    if(result->instructions < 0) {
+        snprintf(instructions, sizeof(instructions), "n/a");
+    }
+    else {
+        snprintf(instructions, sizeof(instructions), "%.1f", result->instructions);
+    }
+
+    printf("%-24s %10.1f %8llu %8llu %10llu %12s\n", name, result->mean_ns,
+        (unsigned long long)result->p50_ns, (unsigned long long)result->p99_ns,
+        (unsigned long long)result->max_ns, instructions);
+}
+
+u32 bench_random(u32 *seed)
+{
+    u32 x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+u8 bench_rest_axis(u32 *seed)
+{
+    return (u8)(SCE_CTRL_ANALOG_PAD_CENTER_VALUE - 2 + bench_random(seed) % 5);
+}
+
+void bench_fill_rest(BenchPadSample *samples, u32 count)
+{
+    u32 seed = 1;
+
+    for(u32 i = 0; i < count; i++) {
+        samples[i].buttons = 0;
+        samples[i].lx = bench_rest_axis(&seed);
+        samples[i].ly = bench_rest_axis(&seed);
+    }
+}
+
+void bench_fill_sweep(BenchPadSample *samples, u32 count)
+{
+    for(u32 i = 0; i < count; i++) {
+        u32 step = i % 16384;
+        double angle = (double)step * (2.0 * 3.14159265358979 / 256.0);
+        double radius = 128.0 * step / 16384.0;
+        int x = SCE_CTRL_ANALOG_PAD_CENTER_VALUE + (int)(radius * cos(angle));
+        int y = SCE_CTRL_ANALOG_PAD_CENTER_VALUE + (int)(radius * sin(angle));
+
+        samples[i].buttons = 0;
+        samples[i].lx = (u8)(x < 0 ? 0 : x > 255 ? 255 : x);
+        samples[i].ly = (u8)(y < 0 ? 0 : y > 255 ? 255 : y);
+    }
+}
+
+void bench_fill_noise(BenchPadSample *samples, u32 count)
+{
+    u32 seed = 0x12345678;
+
+    for(u32 i = 0; i < count; i++) {
+        u32 random = bench_random(&seed);
+        samples[i].buttons = random & 0xFFFF;
+        samples[i].lx = (u8)(random >> 16);
+        samples[i].ly = (u8)(random >> 24);
+    }
+}
+
+void bench_run_distributions(const BenchDistribution *distributions, u32 distribution_count, u32 count,
+    BenchRunFunc run, void *context)
+{
+    BenchPadSample *samples = malloc(sizeof(BenchPadSample) * count);
+
+    for(u32 i = 0; i < distribution_count; i++) {
+        distributions[i].fill(samples, count);
+        run(distributions[i].name, samples, count, context);
+    }
+
+    free(samples);
+}
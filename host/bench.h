@@ -0,0 +1,86 @@
+// PSP-EmulatedControllerTest host build
+// Timing helpers and generated input shared by the host benchmarks, and the generator by the tests too.
+//
+// Ryan Crosby 2025
+//
+// Host timings only rank the implementations against each other and catch regressions, they don't say
+// how long anything takes on the Allegrex. Instruction counts come from the CPU's performance counters
+// when the kernel allows it, and are reported as n/a otherwise.
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <psptypes.h>
+
+#include <stdbool.h>
+
+// The per-call timings of a benchmark, with the timer overhead taken off.
+typedef struct {
+    double mean_ns;
+    u64 p50_ns;
+    u64 p99_ns;
+    u64 max_ns;
+    // Negative when the instruction counter is unavailable.
+    double instructions;
+} BenchResult;
+
+// True if the benchmark was asked to do a short run, as ctest does.
+bool bench_quick(int argc, char **argv);
+
+// A monotonic timestamp in nanoseconds.
+u64 bench_now_ns(void);
+
+// The cost of a pair of bench_now_ns() calls, to take off each per-call timing.
+u64 bench_timer_overhead_ns(void);
+
+// Starts counting the instructions retired by this thread. Returns false if that isn't possible.
+bool bench_instructions_start(void);
+
+// Stops counting, and returns the instructions retired since bench_instructions_start(), or -1.
+s64 bench_instructions_stop(void);
+
+// Fills in the percentiles of result from count per-call timings. Sorts samples.
+void bench_summarize(u64 *samples, u32 count, BenchResult *result);
+
+// Prints the column headings, then one row per result.
+void bench_print_header(const char *title);
+void bench_print_result(const char *name, const BenchResult *result);
+
+// The next number of a xorshift32 sequence. Every input is generated from a fixed seed, so each run gets the same.
+u32 bench_random(u32 *seed);
+
+// A stick axis at rest, wobbling by a count or two around the center.
+u8 bench_rest_axis(u32 *seed);
+
+// A PSP controller sample, as fed to the code under test.
+typedef struct {
+    u32 buttons;
+    u8 lx;
+    u8 ly;
+} BenchPadSample;
+
+typedef void (*BenchFillFunc)(BenchPadSample *samples, u32 count);
+
+// The stick at rest, wobbling by a count or two around the center, and no buttons.
+void bench_fill_rest(BenchPadSample *samples, u32 count);
+
+// A spiral of 64 turns, from the center out to the edge, every 16384 samples, and no buttons.
+void bench_fill_sweep(BenchPadSample *samples, u32 count);
+
+// Random stick positions and user buttons.
+void bench_fill_noise(BenchPadSample *samples, u32 count);
+
+// An input distribution a benchmark is run on.
+typedef struct {
+    const char *name;
+    BenchFillFunc fill;
+} BenchDistribution;
+
+// Runs a benchmark on the count samples of one distribution.
+typedef void (*BenchRunFunc)(const char *name, const BenchPadSample *samples, u32 count, void *context);
+
+// Generates count samples of each distribution in turn, and runs the benchmark on them.
+void bench_run_distributions(const BenchDistribution *distributions, u32 distribution_count, u32 count,
+    BenchRunFunc run, void *context);
+
+#endif /* BENCH_H */
@@ -0,0 +1,219 @@
+// PSP-EmulatedControllerTest host build
+// Benchmarks an injection backend, built once for each: bench_backend_port for INJECTION_BACKEND_PORT_HANDLER,
+// bench_backend_slots for INJECTION_BACKEND_EMULATION_SLOTS. Each reports
+// * the work per frame: the callback as the driver calls it, or one update of the slot thread, writer lock and
+//   emulation slot writes included, over idle input and over changing injected and PSP input
+// * the frames per second on the ctrl driver model, and the share of a host core they would take
+// * the latency from an injected frame to the peeked sample, in microseconds and in samples
+//
+// The slot thread also costs a context switch per update on the PSP, which the host can't show.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#ifdef BENCH_EMULATION_SLOTS
+#undef INJECTION_BACKEND
+#define INJECTION_BACKEND INJECTION_BACKEND_EMULATION_SLOTS
+#define BENCH_BACKEND_NAME "emulation slots"
+#else
+#define BENCH_BACKEND_NAME "port handler"
+#endif
+
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_PORT (SCE_CTRL_PORT_DS3)
+
+#define BENCH_FRAMES (200000)
+#define BENCH_QUICK_FRAMES (20000)
+#define BENCH_WARMUP_FRAMES (1000)
+
+// Injected frames timed at these offsets into a VBlank, so the latencies cover every phase.
+#define LATENCY_TRIALS (16)
+
+// One frame of the backend's work for the port.
+static inline
+void run_frame(EmulatedPort *port, SceCtrlData2 *out)
+{
+#if INJECTION_BACKEND == INJECTION_BACKEND_EMULATION_SLOTS
+    if(lock_input_writer() >= 0) {
+        update_emulation_slot(port);
+        unlock_input_writer();
+    }
+    out->buttons = 0;
+#else
+    ctrl_input_data_handler_func(port, out);
+#endif
+}
+
+// Sets the input of frame i: nothing when idle, otherwise a new injected frame and PSP stick every 8 frames.
+static
+void set_input(u32 i, bool idle, u32 *seed)
+{
+    if(idle || i % 8 != 0) {
+        return;
+    }
+
+    u32 random = bench_random(seed);
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+    frame.buttons = random & 0xFFFF;
+    frame.aX = random & 0x10000 ? (u8)(random >> 24) : SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    emuCtrlSetInputFrame(BENCH_PORT, &frame);
+    sim_ctrl_set_pad(0, (u8)(random >> 16), (u8)(random >> 8));
+}
+
+static
+void run_overhead(const char *name, bool idle, u32 frames, EmulatedPort *port, BenchResult *result)
+{
+    u64 *timings = malloc(sizeof(u64) * frames);
+    u64 overhead = bench_timer_overhead_ns();
+    u32 seed = 0x13579BDF;
+    volatile u32 sink = 0;
+    SceCtrlData2 out;
+    u64 total_ns = 0;
+
+    for(u32 i = 0; i < BENCH_WARMUP_FRAMES + frames; i++) {
+        set_input(i, idle, &seed);
+        sim_advance_clock(SIM_VBLANK_PERIOD);
+        sim_ctrl_take_sample();
+
+        u64 start = bench_now_ns();
+        run_frame(port, &out);
+        u64 elapsed = bench_now_ns() - start;
+        sink += out.buttons;
+
+        if(i >= BENCH_WARMUP_FRAMES) {
+            elapsed = elapsed > overhead ? elapsed - overhead : 0;
+            timings[i - BENCH_WARMUP_FRAMES] = elapsed;
+            total_ns += elapsed;
+        }
+    }
+
+    result->mean_ns = (double)total_ns / frames;
+    result->instructions = -1;
+    bench_summarize(timings, frames, result);
+    bench_print_result(name, result);
+
+    free(timings);
+}
+
+// The frames the backend runs for the port per second of the ctrl driver model.
+static
+u32 frame_rate(void)
+{
+    EmuCtrlPollStats before, after;
+
+    emuCtrlGetPollStats(BENCH_PORT, &before);
+    sim_run_for(1000 * ONE_MSEC);
+    emuCtrlGetPollStats(BENCH_PORT, &after);
+
+    return after.polls - before.polls;
+}
+
+typedef struct {
+    // The time the frame was injected, when it first showed in a sample, and the samples published by then.
+    u64 injected;
+    u64 seen;
+    u32 samples;
+} LatencyProbe;
+
+static
+void probe_sample(void *context, const SceCtrlData *sample)
+{
+    LatencyProbe *probe = context;
+
+    if(probe->seen == 0 && (sample->buttons & SCE_CTRL_CROSS)) {
+        probe->seen = sim_now();
+        probe->samples = sim_ctrl_samples();
+    }
+}
+
+static
+void run_latency(void)
+{
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+    u64 total = 0, max = 0;
+    u32 total_samples = 0, max_samples = 0;
+
+    for(u32 i = 0; i < LATENCY_TRIALS; i++) {
+        LatencyProbe probe = { 0, 0, 0 };
+
+        sim_run_for(100 * ONE_MSEC + i * (SIM_VBLANK_PERIOD / LATENCY_TRIALS));
+
+        u32 samples = sim_ctrl_samples();
+        sim_ctrl_set_sample_hook(probe_sample, &probe);
+        probe.injected = sim_now();
+        frame.buttons = SCE_CTRL_CROSS;
+        emuCtrlSetInputFrame(BENCH_PORT, &frame);
+        sim_run_for(200 * ONE_MSEC);
+        sim_ctrl_set_sample_hook(NULL, NULL);
+
+        if(probe.seen == 0) {
+            fprintf(stderr, "The injected frame never reached a sample\n");
+            exit(1);
+        }
+
+        u64 latency = probe.seen - probe.injected;
+        u32 latency_samples = probe.samples - samples;
+        total += latency;
+        max = latency > max ? latency : max;
+        total_samples += latency_samples;
+        max_samples = latency_samples > max_samples ? latency_samples : max_samples;
+
+        frame.buttons = 0;
+        emuCtrlSetInputFrame(BENCH_PORT, &frame);
+    }
+
+    printf("%-16s %10.0f %10llu %12.2f %12u\n", BENCH_BACKEND_NAME, (double)total / LATENCY_TRIALS,
+        (unsigned long long)max, (double)total_samples / LATENCY_TRIALS, max_samples);
+}
+
+int main(int argc, char **argv)
+{
+    u32 frames = bench_quick(argc, argv) ? BENCH_QUICK_FRAMES : BENCH_FRAMES;
+    BenchResult idle, active;
+
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    if(module_start(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_start failed\n");
+        return 1;
+    }
+
+    // Let the main thread register the ports
+    sim_run_for(100 * ONE_MSEC);
+
+    EmulatedPort *port = emulated_port(BENCH_PORT);
+    if(port == NULL || !port->registered) {
+        fprintf(stderr, "The port wasn't registered\n");
+        return 1;
+    }
+
+    bench_print_header(BENCH_BACKEND_NAME ", work per frame");
+    run_overhead("idle", true, frames, port, &idle);
+    run_overhead("input", false, frames, port, &active);
+
+    // The frames run directly above didn't run the threads, so let them catch up first
+    sim_run_for(100 * ONE_MSEC);
+    u32 rate = frame_rate();
+    printf("\n%-16s %10s %14s\n", "backend", "frames/s", "host CPU %");
+    printf("%-16s %10u %14.5f\n", BENCH_BACKEND_NAME, rate, rate * active.mean_ns / 1e7);
+
+    printf("\nInjected frame to peeked sample\n");
+    printf("%-16s %10s %10s %12s %12s\n", "backend", "mean us", "max us", "mean samples", "max samples");
+    run_latency();
+
+    if(module_stop(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_stop failed\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+// PSP-EmulatedControllerTest host build
+// Measures the D-pad chatter the direction hysteresis removes. Noisy stick traces are played into the ctrl driver
+// model one sample per VBlank, and the direction edges with hysteresis are compared with the edges the plain
+// press thresholds would have given, from the counters in each port's AnalogDirectionState. The sample edges column
+// counts the D-pad changes in the peeked sample as well, which is what the XMB sees.
+// * rest: the stick resting right at the press threshold, a count or three of noise either way
+// * push: the stick slowly pushed out to the edge and let back, with noise, so every push crosses the threshold
+//   twice
+// * circle: the stick circling at the press threshold, so the diagonals hover at the threshold of both axes
+// * flicks: the stick resting at center with noise, and flicked to the edge now and then
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_PORT (SCE_CTRL_PORT_DS3)
+
+#define BENCH_SECONDS (60)
+#define BENCH_QUICK_SECONDS (5)
+
+#define DPAD_BUTTONS (SCE_CTRL_UP | SCE_CTRL_RIGHT | SCE_CTRL_DOWN | SCE_CTRL_LEFT)
+
+typedef u8 (*TraceFunc)(u32 i, u32 *seed, u8 *ly);
+
+static
+u8 clamp_axis(double value)
+{
+    return (u8)(value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+// Noise of -amplitude to +amplitude counts.
+static
+int noise(u32 *seed, u32 amplitude)
+{
+    return (int)(bench_random(seed) % (2 * amplitude + 1)) - (int)amplitude;
+}
+
+static
+u8 trace_rest(u32 i, u32 *seed, u8 *ly)
+{
+    *ly = (u8)(SCE_CTRL_ANALOG_PAD_CENTER_VALUE + noise(seed, 1));
+    return clamp_axis(SCE_CTRL_ANALOG_PAD_CENTER_VALUE + ANALOG_PAD_DIRECTION_THRESHOLD + noise(seed, 3));
+}
+
+static
+u8 trace_push(u32 i, u32 *seed, u8 *ly)
+{
+    // Out and back over two seconds
+    double t = (i % 120) / 120.0;
+    double deflection = 128 * (t < 0.5 ? 2 * t : 2 - 2 * t);
+
+    *ly = (u8)(SCE_CTRL_ANALOG_PAD_CENTER_VALUE + noise(seed, 1));
+    return clamp_axis(SCE_CTRL_ANALOG_PAD_CENTER_VALUE + deflection + noise(seed, 2));
+}
+
+static
+u8 trace_circle(u32 i, u32 *seed, u8 *ly)
+{
+    // Once around every four seconds
+    double angle = i * (2.0 * 3.14159265358979 / 240.0);
+    double radius = ANALOG_PAD_DIRECTION_THRESHOLD * 1.414;
+
+    *ly = clamp_axis(SCE_CTRL_ANALOG_PAD_CENTER_VALUE + radius * sin(angle) + noise(seed, 2));
+    return clamp_axis(SCE_CTRL_ANALOG_PAD_CENTER_VALUE + radius * cos(angle) + noise(seed, 2));
+}
+
+static
+u8 trace_flicks(u32 i, u32 *seed, u8 *ly)
+{
+    *ly = (u8)(SCE_CTRL_ANALOG_PAD_CENTER_VALUE + noise(seed, 2));
+
+    // A flick of a quarter of a second, about every three seconds
+    if(i % 180 < 15) {
+        return clamp_axis(0xFF - 4 + noise(seed, 4));
+    }
+    return (u8)(SCE_CTRL_ANALOG_PAD_CENTER_VALUE + noise(seed, 2));
+}
+
+typedef struct {
+    u32 buttons;
+    u32 edges;
+} SampleEdges;
+
+static
+void count_sample_edges(void *context, const SceCtrlData *sample)
+{
+    SampleEdges *edges = context;
+    u32 buttons = sample->buttons & DPAD_BUTTONS;
+
+    edges->edges += buttons != edges->buttons;
+    edges->buttons = buttons;
+}
+
+// Plays the trace for the given seconds, prints its row, and returns the number of edges the hysteresis removed.
+// An axis released later than its threshold can split a change of both axes in one poll into two, so the
+// count can come out negative when the stick moves between directions rather than chattering.
+static
+s32 run_trace(const char *name, TraceFunc trace, u32 seconds, EmulatedPort *port)
+{
+    u32 count = seconds * 60;
+    SimPadEvent *events = malloc(sizeof(SimPadEvent) * count);
+    u32 seed = 0xC0FFEE;
+
+    for(u32 i = 0; i < count; i++) {
+        events[i].time = (u64)i * SIM_VBLANK_PERIOD;
+        events[i].buttons = 0;
+        events[i].lx = trace(i, &seed, &events[i].ly);
+    }
+
+    AnalogDirectionState before = port->direction_state;
+    SampleEdges sample_edges = { 0, 0 };
+
+    sim_ctrl_set_sample_hook(count_sample_edges, &sample_edges);
+    sim_ctrl_play(events, count);
+    sim_run_for((u64)count * SIM_VBLANK_PERIOD);
+    sim_ctrl_set_sample_hook(NULL, NULL);
+
+    // Back to rest for the next trace
+    sim_ctrl_set_pad(0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    sim_run_for(10 * SIM_VBLANK_PERIOD);
+
+    u32 raw_edges = port->direction_state.raw_edges - before.raw_edges;
+    u32 edges = port->direction_state.edges - before.edges;
+    double elapsed = (double)count * SIM_VBLANK_PERIOD / 1e6;
+
+    s32 removed = (s32)(raw_edges - edges);
+
+    printf("%-8s %12.2f %12.2f %12.2f %9.1f%% %14.2f\n", name, raw_edges / elapsed, edges / elapsed,
+        removed / elapsed, raw_edges != 0 ? 100.0 * removed / raw_edges : 0.0, sample_edges.edges / elapsed);
+
+    free(events);
+    return removed;
+}
+
+int main(int argc, char **argv)
+{
+    u32 seconds = bench_quick(argc, argv) ? BENCH_QUICK_SECONDS : BENCH_SECONDS;
+
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    if(module_start(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_start failed\n");
+        return 1;
+    }
+
+    // Let the main thread register the ports
+    sim_run_for(100 * ONE_MSEC);
+
+    EmulatedPort *port = emulated_port(BENCH_PORT);
+    if(port == NULL || !port->registered) {
+        fprintf(stderr, "The port wasn't registered\n");
+        return 1;
+    }
+
+    printf("D-pad edges per second, press threshold %d, release threshold %d, %us per trace\n",
+        ANALOG_PAD_DIRECTION_THRESHOLD, ANALOG_PAD_DIRECTION_RELEASE_THRESHOLD, seconds);
+    printf("%-8s %12s %12s %12s %10s %14s\n", "trace", "thresholds", "hysteresis", "removed", "removed", "sample edges");
+
+    s32 removed = run_trace("rest", trace_rest, seconds, port);
+    run_trace("push", trace_push, seconds, port);
+    run_trace("circle", trace_circle, seconds, port);
+    run_trace("flicks", trace_flicks, seconds, port);
+
+    if(module_stop(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_stop failed\n");
+        return 1;
+    }
+
+    // A stick resting on the threshold is what the hysteresis is for
+    if(ANALOG_PAD_DIRECTION_RELEASE_THRESHOLD < ANALOG_PAD_DIRECTION_THRESHOLD && removed <= 0) {
+        fprintf(stderr, "The hysteresis removed no edges from a stick resting on the threshold\n");
+        return 1;
+    }
+
+    return 0;
+}
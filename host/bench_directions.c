@@ -0,0 +1,109 @@
+// PSP-EmulatedControllerTest host build
+// Benchmarks the stick to D-pad classification: the per-axis lookup tables the callback uses against the four
+// compares and branches they replaced, over the same idle, sweep and noise stick distributions as
+// bench_handler. Noise is the case the tables are for, since the branches can't be predicted there.
+// Before timing anything, both are checked to agree on every stick position.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+#include "plugin.c"
+
+#include "bench.h"
+
+#include <stdio.h>
+
+#define BENCH_SAMPLES (1 << 20)
+#define BENCH_QUICK_SAMPLES (1 << 16)
+#define BENCH_REPEATS (5)
+
+typedef u32 (*ClassifyFunc)(u8 aX, u8 aY);
+
+// The classification before the lookup tables.
+static __attribute__((noinline))
+u32 classify_branchy(u8 aX, u8 aY)
+{
+    int pad_x = aX - SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    int pad_y = aY - SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    u32 direction_buttons = 0;
+
+    if(pad_x > ANALOG_PAD_DIRECTION_THRESHOLD) {
+        direction_buttons |= SCE_CTRL_RIGHT;
+    }
+
+    if(pad_x <= -ANALOG_PAD_DIRECTION_THRESHOLD) {
+        direction_buttons |= SCE_CTRL_LEFT;
+    }
+
+    if(pad_y > ANALOG_PAD_DIRECTION_THRESHOLD) {
+        direction_buttons |= SCE_CTRL_DOWN;
+    }
+
+    if(pad_y <= -ANALOG_PAD_DIRECTION_THRESHOLD) {
+        direction_buttons |= SCE_CTRL_UP;
+    }
+
+    return direction_buttons;
+}
+
+static __attribute__((noinline))
+u32 classify_lut(u8 aX, u8 aY)
+{
+    return g_analog_x_press_lut[aX] | g_analog_y_press_lut[aY];
+}
+
+// The best time per sample over a few runs, in ns.
+static
+double time_classify(ClassifyFunc classify, const BenchPadSample *samples, u32 count)
+{
+    u64 best = ~0ull;
+    volatile u32 sink = 0;
+
+    for(u32 repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+        u32 buttons = 0;
+        u64 start = bench_now_ns();
+        for(u32 i = 0; i < count; i++) {
+            buttons += classify(samples[i].lx, samples[i].ly);
+        }
+        u64 elapsed = bench_now_ns() - start;
+
+        sink += buttons;
+        best = elapsed < best ? elapsed : best;
+    }
+
+    return (double)best / count;
+}
+
+static
+void run_classify(const char *name, const BenchPadSample *samples, u32 count, void *context)
+{
+    double branchy = time_classify(classify_branchy, samples, count);
+    double lut = time_classify(classify_lut, samples, count);
+    printf("%-8s %12.2f %12.2f %9.2fx\n", name, branchy, lut, branchy / lut);
+}
+
+int main(int argc, char **argv)
+{
+    static const BenchDistribution distributions[] = {
+        { "idle", bench_fill_rest },
+        { "sweep", bench_fill_sweep },
+        { "noise", bench_fill_noise },
+    };
+    u32 count = bench_quick(argc, argv) ? BENCH_QUICK_SAMPLES : BENCH_SAMPLES;
+
+    for(u32 x = 0; x < 256; x++) {
+        for(u32 y = 0; y < 256; y++) {
+            if(classify_lut(x, y) != classify_branchy(x, y)) {
+                fprintf(stderr, "The tables give 0x%02x for %u, %u, the compares 0x%02x\n",
+                    classify_lut(x, y), x, y, classify_branchy(x, y));
+                return 1;
+            }
+        }
+    }
+
+    printf("Stick to D-pad classification, ns per sample\n");
+    printf("%-8s %12s %12s %10s\n", "input", "compares", "tables", "speedup");
+    bench_run_distributions(distributions, sizeof(distributions) / sizeof(distributions[0]), count, run_classify, NULL);
+
+    return 0;
+}
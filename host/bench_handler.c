@@ -0,0 +1,131 @@
+// PSP-EmulatedControllerTest host build
+// Benchmarks the controller callback, ctrl_input_data_handler_func(), the way the ctrl driver calls it once
+// per sampling cycle, over fixed distributions of PSP controller input:
+// * idle: the stick resting within the center error margin, no buttons
+// * sweep: the stick spiralling out from the center over every angle and deflection
+// * noise: random buttons and stick positions
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_CALLS (200000)
+#define BENCH_QUICK_CALLS (20000)
+#define BENCH_WARMUP_CALLS (1000)
+
+// The handler the driver would call, and the input source it was registered with.
+typedef struct {
+    const SceCtrlInputDataTransferHandler *handler;
+    void *source;
+} HandlerTarget;
+
+// Feeds one sample to the PSP controller, as the driver samples it once per cycle.
+static inline
+void feed(const BenchPadSample *sample)
+{
+    sim_advance_clock(SIM_VBLANK_PERIOD);
+    sim_ctrl_set_pad(sample->buttons, sample->lx, sample->ly);
+    sim_ctrl_take_sample();
+}
+
+static
+void run_handler(const char *name, const BenchPadSample *samples, u32 calls, void *context)
+{
+    const SceCtrlInputDataTransferHandler *handler = ((HandlerTarget *)context)->handler;
+    void *source = ((HandlerTarget *)context)->source;
+    u64 *timings = malloc(sizeof(u64) * calls);
+    volatile u32 sink = 0;
+    SceCtrlData2 out;
+    BenchResult result;
+
+    for(u32 i = 0; i < BENCH_WARMUP_CALLS; i++) {
+        feed(&samples[i % calls]);
+        handler->copyInputData(source, &out);
+    }
+
+    // The harness alone, to take off the totals below
+    bool counting = bench_instructions_start();
+    u64 start = bench_now_ns();
+    for(u32 i = 0; i < calls; i++) {
+        feed(&samples[i]);
+        sink += samples[i].buttons;
+    }
+    u64 harness_ns = bench_now_ns() - start;
+    s64 harness_instructions = bench_instructions_stop();
+
+    counting = bench_instructions_start();
+    start = bench_now_ns();
+    for(u32 i = 0; i < calls; i++) {
+        feed(&samples[i]);
+        handler->copyInputData(source, &out);
+        sink += out.buttons;
+    }
+    u64 total_ns = bench_now_ns() - start;
+    s64 total_instructions = bench_instructions_stop();
+
+    u64 overhead = bench_timer_overhead_ns();
+    for(u32 i = 0; i < calls; i++) {
+        feed(&samples[i]);
+        u64 call_start = bench_now_ns();
+        handler->copyInputData(source, &out);
+        u64 elapsed = bench_now_ns() - call_start;
+        timings[i] = elapsed > overhead ? elapsed - overhead : 0;
+        sink += out.buttons;
+    }
+
+    result.mean_ns = (double)(total_ns > harness_ns ? total_ns - harness_ns : 0) / calls;
+    result.instructions = counting && total_instructions >= 0 && harness_instructions >= 0
+        ? (double)(total_instructions - harness_instructions) / calls : -1;
+    bench_summarize(timings, calls, &result);
+    bench_print_result(name, &result);
+
+    free(timings);
+}
+
+int main(int argc, char **argv)
+{
+    static const BenchDistribution distributions[] = {
+        { "idle", bench_fill_rest },
+        { "sweep", bench_fill_sweep },
+        { "noise", bench_fill_noise },
+    };
+    u32 calls = bench_quick(argc, argv) ? BENCH_QUICK_CALLS : BENCH_CALLS;
+    HandlerTarget target = { NULL, NULL };
+
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    if(module_start(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_start failed\n");
+        return 1;
+    }
+
+    // Let the main thread register the ports
+    sim_run_for(100 * ONE_MSEC);
+
+    for(u8 port = 1; port <= EMULATED_PORT_COUNT && target.handler == NULL; port++) {
+        target.handler = sim_ctrl_port_handler(port, &target.source);
+    }
+
+    if(target.handler == NULL) {
+        fprintf(stderr, "No controller port handler was registered\n");
+        return 1;
+    }
+
+    bench_print_header("ctrl_input_data_handler_func, one call per poll");
+    bench_run_distributions(distributions, sizeof(distributions) / sizeof(distributions[0]), calls, run_handler, &target);
+
+    if(module_stop(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_stop failed\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,265 @@
+// PSP-EmulatedControllerTest host build
+// Measures the idle fast path on traces of XMB browsing played into the controller callback one poll per VBlank.
+// There are no recordings from a PSP to play, so the traces model them: a resting stick wobbles by a count or
+// two, and is pushed to the edge for a moment to move through the menus, or held there to scroll.
+// * resting: the XMB left on a menu, the stick never touched
+// * browsing: a push every one to four seconds, a few of them held long enough to scroll
+// * scrolling: long holds through a list, with short pauses between them
+// * remote: browsing, with another module injecting a button press now and then
+//
+// Each trace is played twice, once as it is and once with every poll running the whole pipeline, and the
+// outputs of the two are checked to be the same. The row gives the share of the polls that took the fast
+// path, the mean time per poll without and with it, and the time saved per poll and per fast path poll.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_PORT (SCE_CTRL_PORT_DS3)
+
+#define BENCH_SECONDS (300)
+#define BENCH_QUICK_SECONDS (30)
+#define BENCH_WARMUP_POLLS (1000)
+#define BENCH_REPEATS (3)
+
+typedef struct {
+    u32 injected_buttons;
+    u8 lx;
+    u8 ly;
+} TracePoll;
+
+// Fills the trace with polls from i on, and returns the index after the last one filled.
+typedef u32 (*TraceFunc)(TracePoll *polls, u32 i, u32 count, u32 *seed);
+
+// The stick at rest for the given number of polls.
+static
+u32 rest(TracePoll *polls, u32 i, u32 count, u32 length, u32 *seed)
+{
+    for(u32 end = i + length; i < end && i < count; i++) {
+        polls[i].injected_buttons = 0;
+        polls[i].lx = bench_rest_axis(seed);
+        polls[i].ly = bench_rest_axis(seed);
+    }
+
+    return i;
+}
+
+// The stick pushed to the edge in a random direction for the given number of polls.
+static
+u32 push(TracePoll *polls, u32 i, u32 count, u32 length, u32 *seed)
+{
+    u32 direction = bench_random(seed) % 4;
+
+    for(u32 end = i + length; i < end && i < count; i++) {
+        u8 edge = (u8)((direction & 1) ? 0xFF - bench_random(seed) % 6 : bench_random(seed) % 6);
+
+        polls[i].injected_buttons = 0;
+        polls[i].lx = direction < 2 ? edge : bench_rest_axis(seed);
+        polls[i].ly = direction < 2 ? bench_rest_axis(seed) : edge;
+    }
+
+    return i;
+}
+
+static
+u32 trace_resting(TracePoll *polls, u32 i, u32 count, u32 *seed)
+{
+    return rest(polls, i, count, count, seed);
+}
+
+static
+u32 trace_browsing(TracePoll *polls, u32 i, u32 count, u32 *seed)
+{
+    // A push of 100 - 250ms, or a hold of one to two seconds now and then
+    i = push(polls, i, count, bench_random(seed) % 8 == 0 ? 60 + bench_random(seed) % 60 : 6 + bench_random(seed) % 10, seed);
+    return rest(polls, i, count, 60 + bench_random(seed) % 180, seed);
+}
+
+static
+u32 trace_scrolling(TracePoll *polls, u32 i, u32 count, u32 *seed)
+{
+    i = push(polls, i, count, 120 + bench_random(seed) % 240, seed);
+    return rest(polls, i, count, 20 + bench_random(seed) % 40, seed);
+}
+
+static
+u32 trace_remote(TracePoll *polls, u32 i, u32 count, u32 *seed)
+{
+    u32 start = i;
+
+    i = trace_browsing(polls, i, count, seed);
+
+    // A press of 100ms injected somewhere in the rest after the push
+    u32 press = start + (i - start) / 2;
+    for(u32 j = press; j < press + 6 && j < i; j++) {
+        polls[j].injected_buttons = SCE_CTRL_CROSS;
+    }
+
+    return i;
+}
+
+// Plays the trace into the callback, and returns the total time the polls took in ns. Writes the output of
+// every poll to frames, and counts the polls that took the fast path. With full set, the callback is made to
+// forget before every poll that the stages settled, so every poll runs the whole pipeline as without the fast path.
+static
+u64 play_trace(const TracePoll *polls, u32 count, const SceCtrlInputDataTransferHandler *handler, EmulatedPort *port,
+    bool full, SceCtrlData2 *frames, u32 *fast_polls)
+{
+    u64 overhead = bench_timer_overhead_ns();
+    u64 total = 0;
+    u32 injected = 0;
+    u32 idle_polls = port->idle_polls;
+
+    for(u32 i = 0; i < count; i++) {
+        const TracePoll *poll = &polls[i];
+
+        sim_advance_clock(SIM_VBLANK_PERIOD);
+        sim_ctrl_set_pad(0, poll->lx, poll->ly);
+        sim_ctrl_take_sample();
+
+        // Only injected when it changes, as a module feeding the port would
+        if(poll->injected_buttons != injected) {
+            SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+            frame.buttons = poll->injected_buttons;
+            emuCtrlSetInputFrame(BENCH_PORT, &frame);
+            injected = poll->injected_buttons;
+        }
+
+        if(full) {
+            port->idle_settled = false;
+        }
+
+        // As the driver hands it over
+        SceCtrlData2 *out = &frames[i];
+        memset(out, 0, sizeof(*out));
+        out->timeStamp = (u32)sim_now();
+        out->aX = out->aY = out->rX = out->rY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+
+        u64 start = bench_now_ns();
+        handler->copyInputData(port, out);
+        u64 elapsed = bench_now_ns() - start;
+        total += elapsed > overhead ? elapsed - overhead : 0;
+
+        // The timestamps differ from run to run
+        out->timeStamp = 0;
+    }
+
+    *fast_polls = port->idle_polls - idle_polls;
+    return total;
+}
+
+// Plays the trace with and without the fast path, and prints its row. Returns the share of the polls that took
+// the fast path, or -1 if the outputs differed.
+static
+double run_trace(const char *name, TraceFunc trace, u32 count, const SceCtrlInputDataTransferHandler *handler,
+    EmulatedPort *port)
+{
+    TracePoll *polls = malloc(sizeof(TracePoll) * count);
+    SceCtrlData2 *fast_frames = malloc(sizeof(SceCtrlData2) * count);
+    SceCtrlData2 *full_frames = malloc(sizeof(SceCtrlData2) * count);
+    TracePoll settle[60];
+    u32 seed = 0x0A11CE;
+    u32 fast_polls, unused;
+
+    for(u32 i = 0; i < count;) {
+        i = trace(polls, i, count, &seed);
+    }
+    rest(settle, 0, 60, 60, &seed);
+
+    // The best of a few runs each, every run starting from every stage at rest
+    u64 fast_ns = ~0ull, full_ns = ~0ull;
+    for(u32 repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+        play_trace(settle, 60, handler, port, false, fast_frames, &unused);
+        u64 elapsed = play_trace(polls, count, handler, port, false, fast_frames, &fast_polls);
+        fast_ns = elapsed < fast_ns ? elapsed : fast_ns;
+
+        play_trace(settle, 60, handler, port, false, full_frames, &unused);
+        elapsed = play_trace(polls, count, handler, port, true, full_frames, &unused);
+        full_ns = elapsed < full_ns ? elapsed : full_ns;
+    }
+
+    double hit_rate = (double)fast_polls / count;
+    double with_fast = (double)fast_ns / count;
+    double without_fast = (double)full_ns / count;
+    double saved = without_fast - with_fast;
+
+    printf("%-10s %8.1f%% %10.1f %10.1f %10.1f %12.1f\n", name, 100.0 * hit_rate, without_fast, with_fast, saved,
+        fast_polls != 0 ? saved / hit_rate : 0.0);
+
+    // The fast path changes nothing about the output
+    for(u32 i = 0; i < count; i++) {
+        if(memcmp(&fast_frames[i], &full_frames[i], sizeof(SceCtrlData2)) != 0) {
+            fprintf(stderr, "%s, poll %u: the output differs from the whole pipeline's\n", name, i);
+            hit_rate = -1;
+            break;
+        }
+    }
+
+    free(polls);
+    free(fast_frames);
+    free(full_frames);
+    return hit_rate;
+}
+
+int main(int argc, char **argv)
+{
+    u32 count = (bench_quick(argc, argv) ? BENCH_QUICK_SECONDS : BENCH_SECONDS) * 60;
+    void *source = NULL;
+
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    if(module_start(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_start failed\n");
+        return 1;
+    }
+
+    // Let the main thread register the ports
+    sim_run_for(100 * ONE_MSEC);
+
+    const SceCtrlInputDataTransferHandler *handler = sim_ctrl_port_handler(BENCH_PORT, &source);
+    EmulatedPort *port = source;
+    if(handler == NULL || port != emulated_port(BENCH_PORT)) {
+        fprintf(stderr, "The port wasn't registered\n");
+        return 1;
+    }
+
+    static TracePoll warmup[BENCH_WARMUP_POLLS];
+    static SceCtrlData2 warmup_frames[BENCH_WARMUP_POLLS];
+    u32 seed = 1, unused;
+    rest(warmup, 0, BENCH_WARMUP_POLLS, BENCH_WARMUP_POLLS, &seed);
+    play_trace(warmup, BENCH_WARMUP_POLLS, handler, port, false, warmup_frames, &unused);
+
+    printf("Idle fast path on XMB browsing traces, %u polls each, ns per poll\n", count);
+    printf("%-10s %9s %10s %10s %10s %12s\n", "trace", "fast path", "without", "with", "saved", "saved/hit");
+
+    double resting = run_trace("resting", trace_resting, count, handler, port);
+    double browsing = run_trace("browsing", trace_browsing, count, handler, port);
+    double scrolling = run_trace("scrolling", trace_scrolling, count, handler, port);
+    double remote = run_trace("remote", trace_remote, count, handler, port);
+
+    if(module_stop(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_stop failed\n");
+        return 1;
+    }
+
+    if(resting < 0 || browsing < 0 || scrolling < 0 || remote < 0) {
+        return 1;
+    }
+
+    // A stick left alone is what the fast path is for
+    if(IDLE_FAST_PATH && resting < 0.99) {
+        fprintf(stderr, "Only %.1f%% of the resting polls took the fast path\n", 100.0 * resting);
+        return 1;
+    }
+
+    return 0;
+}
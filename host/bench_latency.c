@@ -0,0 +1,189 @@
+// PSP-EmulatedControllerTest host build
+// Models the latency of the passthrough path end to end: from a move of the PSP stick to the stick driven
+// D-pad direction showing in the sample sceCtrlPeekBufferPositive() and sceCtrlReadBufferPositive() return,
+// after going through the emulated port and the emulation slot copy set up with sceCtrl_driver_6C86AF22().
+//
+// Each order of the driver's port polls and emulation slot merge is run at the VBlank-synced sampling cycle and
+// at a fast one, with moves timed at every phase of the cycle. The PSP stick's own value in the sample is the
+// baseline, and the lag column is how many polls later the direction shows. The stale column is the share
+// of polls where the callback's peek returned the previous cycle's sample, from the poll statistics.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_PORT (SCE_CTRL_PORT_DS3)
+
+#define BENCH_TRIALS (64)
+#define BENCH_QUICK_TRIALS (8)
+
+// How far the stick is moved, well past the center margin.
+#define BENCH_STICK_MOVED (0xF0)
+
+// The fast sampling cycle, in microseconds.
+#define BENCH_FAST_CYCLE (5555)
+
+typedef struct {
+    // The time of the move and the samples published before it.
+    u64 moved;
+    u32 samples;
+    // When the PSP stick and the direction first showed in a sample, and in which sample since the move.
+    // 0 while waiting.
+    u64 stick_seen;
+    u32 stick_polls;
+    u64 direction_seen;
+    u32 direction_polls;
+} LatencyProbe;
+
+typedef struct {
+    u64 total;
+    u64 max;
+    u32 polls_total;
+    u32 polls_min;
+    u32 polls_max;
+} LatencyStats;
+
+static
+void probe_sample(void *context, const SceCtrlData *sample)
+{
+    LatencyProbe *probe = context;
+
+    if(probe->stick_seen == 0 && sample->aX == BENCH_STICK_MOVED) {
+        probe->stick_seen = sim_now();
+        probe->stick_polls = sim_ctrl_samples() - probe->samples;
+    }
+
+    if(probe->direction_seen == 0 && (sample->buttons & SCE_CTRL_RIGHT)) {
+        probe->direction_seen = sim_now();
+        probe->direction_polls = sim_ctrl_samples() - probe->samples;
+    }
+}
+
+static
+void add_latency(LatencyStats *stats, u64 latency, u32 polls)
+{
+    stats->total += latency;
+    stats->max = latency > stats->max ? latency : stats->max;
+    stats->polls_total += polls;
+    stats->polls_min = polls < stats->polls_min ? polls : stats->polls_min;
+    stats->polls_max = polls > stats->polls_max ? polls : stats->polls_max;
+}
+
+static
+void print_latency(const char *order, const char *cycle, const char *path, const LatencyStats *stats, u32 trials)
+{
+    printf("%-15s %-7s %-10s %10.0f %10llu %11.2f %6u-%u", order, cycle, path, (double)stats->total / trials,
+        (unsigned long long)stats->max, (double)stats->polls_total / trials, stats->polls_min, stats->polls_max);
+}
+
+static
+void center_stick(void)
+{
+    sim_ctrl_set_pad(0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+}
+
+static
+void run_case(const char *order_name, SimCtrlOrder order, const char *cycle_name, u32 cycle, u32 trials)
+{
+    LatencyStats stick = { 0, 0, 0, ~0u, 0 };
+    LatencyStats direction = { 0, 0, 0, ~0u, 0 };
+    EmuCtrlPollStats before, after;
+    u32 period = cycle != 0 ? cycle : SIM_VBLANK_PERIOD;
+
+    sim_ctrl_set_order(order);
+    sceCtrlSetSamplingCycle(cycle);
+    center_stick();
+    sim_run_for(100 * ONE_MSEC);
+    emuCtrlGetPollStats(BENCH_PORT, &before);
+
+    for(u32 i = 0; i < trials; i++) {
+        LatencyProbe probe = { 0 };
+
+        // Every move lands at a different phase of the sampling cycle
+        sim_run_for(10 * period + (u64)i * period / trials);
+
+        sim_ctrl_set_sample_hook(probe_sample, &probe);
+        probe.samples = sim_ctrl_samples();
+        sim_ctrl_set_pad(0, BENCH_STICK_MOVED, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+        probe.moved = sim_ctrl_pad_changed();
+        sim_run_for(10 * period);
+        sim_ctrl_set_sample_hook(NULL, NULL);
+
+        if(probe.stick_seen == 0 || probe.direction_seen == 0) {
+            fprintf(stderr, "%s, %s: the move never reached a sample\n", order_name, cycle_name);
+            exit(1);
+        }
+
+        add_latency(&stick, probe.stick_seen - probe.moved, probe.stick_polls);
+        add_latency(&direction, probe.direction_seen - probe.moved, probe.direction_polls);
+        center_stick();
+    }
+
+    emuCtrlGetPollStats(BENCH_PORT, &after);
+    u32 sample_polls = after.sample_polls - before.sample_polls;
+    u32 stale = after.stale_samples - before.stale_samples;
+
+    print_latency(order_name, cycle_name, "PSP stick", &stick, trials);
+    printf("\n");
+    print_latency(order_name, cycle_name, "direction", &direction, trials);
+    printf("   %5.2f %7.1f%%\n", (double)(direction.polls_total - stick.polls_total) / trials,
+        sample_polls != 0 ? 100.0 * stale / sample_polls : 0.0);
+
+    // In either order the direction goes out on the poll after the move is sampled, and is merged by the
+    // sample after that. Anything later is a regression.
+    if(direction.polls_max > stick.polls_max + 1) {
+        fprintf(stderr, "%s, %s: the direction took %u polls\n", order_name, cycle_name, direction.polls_max);
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    u32 trials = bench_quick(argc, argv) ? BENCH_QUICK_TRIALS : BENCH_TRIALS;
+
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    if(module_start(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_start failed\n");
+        return 1;
+    }
+
+    // Let the main thread register the ports
+    sim_run_for(100 * ONE_MSEC);
+
+    if(sim_ctrl_passthrough_mask() == 0) {
+        fprintf(stderr, "No port is passed through into the emulation slots\n");
+        return 1;
+    }
+
+    printf("PSP stick move to peeked sample, %u moves per case\n", trials);
+    printf("%-15s %-7s %-10s %10s %10s %11s %10s %5s %8s\n", "order", "cycle", "path", "mean us", "max us",
+        "mean polls", "polls", "lag", "stale");
+
+    run_case("handlers first", SIM_CTRL_HANDLERS_FIRST, "vblank", 0, trials);
+    run_case("handlers first", SIM_CTRL_HANDLERS_FIRST, "5555us", BENCH_FAST_CYCLE, trials);
+    run_case("merge first", SIM_CTRL_MERGE_FIRST, "vblank", 0, trials);
+    run_case("merge first", SIM_CTRL_MERGE_FIRST, "5555us", BENCH_FAST_CYCLE, trials);
+
+    sceCtrlSetSamplingCycle(0);
+
+    if(module_stop(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_stop failed\n");
+        return 1;
+    }
+
+    if(sim_context_violations() != 0) {
+        fprintf(stderr, "%u blocking calls were made in interrupt context\n", sim_context_violations());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,367 @@
+// PSP-EmulatedControllerTest host build
+// Benchmarks the compile-time specialized pipeline against a generic chain that runs the same stages through
+// function pointers, each behind a runtime enabled flag, the way a pipeline configured at runtime would.
+// The generic chain is set up with the stages of the build, and both are first checked to give the same
+// output for the same input. Both then run every stage on every poll, without the idle fast path. Both handle
+// the sticks the way STICK_SWAR selects, so the difference between them is only the specialization.
+//
+// One row of the matrix per build, each built with one of:
+// * all the stages (no define)
+// * BENCH_STAGES_THREE: directions, curves and remap
+// * BENCH_STAGES_BUTTONS: remap, turbo and pressure, which don't read the PSP stick
+// * BENCH_STAGES_NONE: only the injected source and the port output
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#undef PIPELINE_IDLE_FAST_PATH
+#define PIPELINE_IDLE_FAST_PATH (0)
+
+#if defined(BENCH_STAGES_THREE) || defined(BENCH_STAGES_BUTTONS) || defined(BENCH_STAGES_NONE)
+#undef PIPELINE_DIRECTIONS
+#undef PIPELINE_CURVES
+#undef PIPELINE_REMAP
+#undef PIPELINE_TURBO
+#undef PIPELINE_PRESSURE
+#endif
+
+#if defined(BENCH_STAGES_THREE)
+#define BENCH_STAGES "three"
+#define PIPELINE_DIRECTIONS (1)
+#define PIPELINE_CURVES (1)
+#define PIPELINE_REMAP (1)
+#define PIPELINE_TURBO (0)
+#define PIPELINE_PRESSURE (0)
+#elif defined(BENCH_STAGES_BUTTONS)
+#define BENCH_STAGES "buttons"
+#define PIPELINE_DIRECTIONS (0)
+#define PIPELINE_CURVES (0)
+#define PIPELINE_REMAP (1)
+#define PIPELINE_TURBO (1)
+#define PIPELINE_PRESSURE (1)
+#elif defined(BENCH_STAGES_NONE)
+#define BENCH_STAGES "none"
+#define PIPELINE_DIRECTIONS (0)
+#define PIPELINE_CURVES (0)
+#define PIPELINE_REMAP (0)
+#define PIPELINE_TURBO (0)
+#define PIPELINE_PRESSURE (0)
+#else
+#define BENCH_STAGES "all"
+#endif
+
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_PORT (SCE_CTRL_PORT_DS3)
+
+#define BENCH_CALLS (200000)
+#define BENCH_QUICK_CALLS (20000)
+#define BENCH_REPEATS (3)
+
+#define CHECK_CALLS (20000)
+
+// The buttons of the noise input injected into the port: the face and shoulder buttons.
+#define BENCH_INJECTED_BUTTONS (0xFF00)
+
+//
+// Generic chain
+//
+
+// What the stages of one poll hand on to each other.
+typedef struct {
+    const SceCtrlData *pad;
+    SceCtrlData2 injected;
+    u32 direction_buttons;
+} GenericPoll;
+
+typedef void (*GenericStageFunc)(EmulatedPort *port, GenericPoll *poll, SceCtrlData2 *pDst);
+
+typedef struct {
+    GenericStageFunc run;
+    bool enabled;
+    // True if the stage reads the PSP stick.
+    bool reads_pad;
+} GenericStage;
+
+static __attribute__((noinline))
+void generic_stage_curves(EmulatedPort *port, GenericPoll *poll, SceCtrlData2 *pDst)
+{
+    u8 padX = poll->pad != NULL ? poll->pad->aX : SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    u8 padY = poll->pad != NULL ? poll->pad->aY : SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+
+#if STICK_SWAR
+    u32 translated = g_axis_curve_tables.x_words[padX] | g_axis_curve_tables.y_words[padY];
+    store_stick_word(&pDst->aX, merge_injected_sticks(translated, load_stick_word(&poll->injected.aX)));
+#else
+    for(u32 axis = 0; axis < EMULATED_AXIS_COUNT; axis++) {
+        u8 *output = &pDst->aX + axis;
+        const u8 *injected = &poll->injected.aX + axis;
+        bool x_axis = axis == EMULATED_AXIS_AX || axis == EMULATED_AXIS_RX;
+
+        *output = merge_injected_axis(g_axis_curve_tables.lut[axis][x_axis ? padX : padY], *injected);
+    }
+#endif
+}
+
+static __attribute__((noinline))
+void generic_stage_directions(EmulatedPort *port, GenericPoll *poll, SceCtrlData2 *pDst)
+{
+    if(poll->pad != NULL) {
+        poll->direction_buttons = analog_direction_buttons(&port->direction_state, poll->pad->aX, poll->pad->aY);
+        pDst->buttons |= poll->direction_buttons;
+    }
+}
+
+static __attribute__((noinline))
+void generic_stage_remap(EmulatedPort *port, GenericPoll *poll, SceCtrlData2 *pDst)
+{
+    pDst->buttons = remap_buttons(pDst->buttons);
+}
+
+static __attribute__((noinline))
+void generic_stage_turbo(EmulatedPort *port, GenericPoll *poll, SceCtrlData2 *pDst)
+{
+    pDst->buttons = apply_turbo(&port->turbo_state, pDst->buttons);
+}
+
+static __attribute__((noinline))
+void generic_stage_pressure(EmulatedPort *port, GenericPoll *poll, SceCtrlData2 *pDst)
+{
+    u8 padX = poll->pad != NULL ? poll->pad->aX : SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    u8 padY = poll->pad != NULL ? poll->pad->aY : SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+
+    synthesize_pressure(&port->pressure_state, poll->direction_buttons, padX, padY, pDst);
+}
+
+// In pipeline order. Not const, so the compiler can't see which stages are enabled.
+GenericStage g_generic_stages[] = {
+    { generic_stage_curves, false, true },
+    { generic_stage_directions, false, true },
+    { generic_stage_remap, false, false },
+    { generic_stage_turbo, false, false },
+    { generic_stage_pressure, false, false },
+};
+
+#define GENERIC_STAGE_COUNT (sizeof(g_generic_stages) / sizeof(g_generic_stages[0]))
+
+static EmulatedPort g_generic_port = EMULATED_PORT_INIT(BENCH_PORT);
+
+static
+void generic_chain_configure(void)
+{
+    const bool enabled[GENERIC_STAGE_COUNT] = {
+        PIPELINE_CURVES, PIPELINE_DIRECTIONS, PIPELINE_REMAP, PIPELINE_TURBO, PIPELINE_PRESSURE,
+    };
+
+    for(u32 i = 0; i < GENERIC_STAGE_COUNT; i++) {
+        g_generic_stages[i].enabled = enabled[i];
+    }
+}
+
+// process_poll() with the stages picked at runtime.
+static __attribute__((noinline))
+void generic_poll(EmulatedPort *port, SceCtrlData2 *pDst)
+{
+    GenericPoll poll = { NULL, INPUT_CHANNEL_NEUTRAL_FRAME, 0 };
+    SceCtrlData pad_state;
+    bool reads_pad = false;
+
+    for(u32 i = 0; i < GENERIC_STAGE_COUNT; i++) {
+        reads_pad = reads_pad || (g_generic_stages[i].enabled && g_generic_stages[i].reads_pad);
+    }
+
+    if(reads_pad && port->psp_input
+            && shared_pad_sample_get(&g_shared_pad_sample, &g_pad_sample_stats, pDst->timeStamp, &pad_state)) {
+        poll.pad = &pad_state;
+    }
+
+    port->polls++;
+
+    // The source and the port output are always there
+    if(!input_queue_pop_due(&port->input.queue, pDst->timeStamp, &poll.injected)) {
+        input_channel_read(&port->input.channel, &poll.injected);
+    }
+
+    pDst->buttons = poll.injected.buttons;
+    pDst->DPadSenseA = poll.injected.DPadSenseA;
+    pDst->DPadSenseB = poll.injected.DPadSenseB;
+    pDst->GPadSenseA = poll.injected.GPadSenseA;
+    pDst->GPadSenseB = poll.injected.GPadSenseB;
+    pDst->AxisSenseA = poll.injected.AxisSenseA;
+    pDst->AxisSenseB = poll.injected.AxisSenseB;
+    pDst->TiltA = poll.injected.TiltA;
+    pDst->TiltB = poll.injected.TiltB;
+#if STICK_SWAR
+    store_stick_word(&pDst->aX, load_stick_word(&poll.injected.aX));
+#else
+    pDst->aX = poll.injected.aX;
+    pDst->aY = poll.injected.aY;
+    pDst->rX = poll.injected.rX;
+    pDst->rY = poll.injected.rY;
+#endif
+    pDst->rsrv[0] = -128;
+    pDst->rsrv[1] = -128;
+
+    for(u32 i = 0; i < GENERIC_STAGE_COUNT; i++) {
+        if(g_generic_stages[i].enabled) {
+            g_generic_stages[i].run(port, &poll, pDst);
+        }
+    }
+}
+
+//
+// Benchmark
+//
+
+static __attribute__((noinline))
+void specialized_poll(EmulatedPort *port, SceCtrlData2 *pDst)
+{
+    process_poll(port, pDst);
+}
+
+// Samples the PSP stick and injects the buttons into both ports, as one cycle of the driver would see them.
+static inline
+void feed(EmulatedPort *port, const BenchPadSample *input)
+{
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+
+    sim_advance_clock(SIM_VBLANK_PERIOD);
+    sim_ctrl_set_pad(0, input->lx, input->ly);
+    sim_ctrl_take_sample();
+
+    frame.buttons = input->buttons & BENCH_INJECTED_BUTTONS;
+    input_channel_write(&port->input.channel, &frame);
+}
+
+static
+void start_frame(SceCtrlData2 *frame)
+{
+    memset(frame, 0, sizeof(*frame));
+    frame->timeStamp = (u32)sim_now();
+    frame->aX = frame->aY = frame->rX = frame->rY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+}
+
+// The best time over a few runs of the inputs through poll, or only through the harness if poll is NULL, in ns.
+static
+u64 time_polls(void (*poll)(EmulatedPort *port, SceCtrlData2 *pDst), EmulatedPort *port,
+    const BenchPadSample *inputs, u32 count)
+{
+    u64 best = ~0ull;
+    volatile u32 sink = 0;
+
+    for(u32 repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+        u64 start = bench_now_ns();
+        for(u32 i = 0; i < count; i++) {
+            SceCtrlData2 out;
+            feed(port, &inputs[i]);
+            start_frame(&out);
+            if(poll != NULL) {
+                poll(port, &out);
+            }
+            sink += out.buttons;
+        }
+        u64 elapsed = bench_now_ns() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+static
+void run_pipelines(const char *name, const BenchPadSample *inputs, u32 count, void *context)
+{
+    EmulatedPort *port = emulated_port(BENCH_PORT);
+
+    u64 harness = time_polls(NULL, port, inputs, count);
+    u64 specialized = time_polls(specialized_poll, port, inputs, count);
+    u64 generic = time_polls(generic_poll, &g_generic_port, inputs, count);
+
+    double specialized_ns = (double)(specialized > harness ? specialized - harness : 0) / count;
+    double generic_ns = (double)(generic > harness ? generic - harness : 0) / count;
+    printf("%-8s %-6s %12.2f %12.2f %9.2fx\n", BENCH_STAGES, name, specialized_ns, generic_ns,
+        specialized_ns > 0 ? generic_ns / specialized_ns : 0.0);
+}
+
+// Runs the same input through both, poll by poll. Returns false on the first poll they disagree on.
+static
+bool check_same_output(void)
+{
+    BenchPadSample *inputs = malloc(sizeof(BenchPadSample) * CHECK_CALLS);
+    EmulatedPort *port = emulated_port(BENCH_PORT);
+    bool same = true;
+
+    bench_fill_noise(inputs, CHECK_CALLS);
+    for(u32 i = 0; i < CHECK_CALLS && same; i++) {
+        SceCtrlData2 specialized, generic;
+
+        feed(port, &inputs[i]);
+        feed(&g_generic_port, &inputs[i]);
+        start_frame(&specialized);
+        start_frame(&generic);
+
+        specialized_poll(port, &specialized);
+        generic_poll(&g_generic_port, &generic);
+
+        if(memcmp(&specialized, &generic, sizeof(specialized)) != 0) {
+            fprintf(stderr, "Poll %u: the pipeline gives buttons 0x%08x, the generic chain 0x%08x\n", i,
+                specialized.buttons, generic.buttons);
+            same = false;
+        }
+    }
+
+    free(inputs);
+    return same;
+}
+
+int main(int argc, char **argv)
+{
+    static const BenchDistribution distributions[] = {
+        { "idle", bench_fill_rest },
+        { "noise", bench_fill_noise },
+    };
+    u32 count = bench_quick(argc, argv) ? BENCH_QUICK_CALLS : BENCH_CALLS;
+    static const ButtonRemap swap[] = {
+        { SCE_CTRL_CROSS, SCE_CTRL_CIRCLE },
+        { SCE_CTRL_CIRCLE, SCE_CTRL_CROSS },
+        { 0, 0 },
+    };
+
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    if(module_start(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_start failed\n");
+        return 1;
+    }
+
+    // Let the main thread register the ports
+    sim_run_for(100 * ONE_MSEC);
+
+    // Give the remap and turbo stages something to do, the same for both
+    button_remap_build_from_list(swap);
+    turbo_configure(SCE_CTRL_SQUARE, 2, 2);
+    generic_chain_configure();
+
+    if(!check_same_output()) {
+        return 1;
+    }
+
+    printf("Pipeline stages, ns per poll\n");
+    printf("%-8s %-6s %12s %12s %10s\n", "stages", "input", "specialized", "generic", "generic");
+    bench_run_distributions(distributions, sizeof(distributions) / sizeof(distributions[0]), count, run_pipelines, NULL);
+
+    if(module_stop(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_stop failed\n");
+        return 1;
+    }
+
+    return 0;
+}
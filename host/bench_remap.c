@@ -0,0 +1,231 @@
+// PSP-EmulatedControllerTest host build
+// Benchmarks the button remap: the byte-sliced tables the callback uses against a loop over the 32 button bits,
+// for a Cross/Circle swap, L1/R1 moved onto the L/R triggers, and every bit mapped somewhere at random. Each remap
+// is timed on buttons at rest, a few held buttons and random button words, and the time to compile the tables,
+// which only happens when the remap changes, is reported as well. Before timing anything, both are checked to
+// agree on every value of each byte and on random button words.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+#include "plugin.c"
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_SAMPLES (1 << 20)
+#define BENCH_QUICK_SAMPLES (1 << 16)
+#define BENCH_REPEATS (5)
+
+#define BENCH_BUILDS (1000)
+#define BENCH_QUICK_BUILDS (50)
+
+#define CHECK_WORDS (100000)
+
+typedef void (*FillFunc)(u32 *buttons, u32 count);
+typedef u32 (*RemapFunc)(const u32 map[32], u32 buttons);
+
+// The remap the tables replaced.
+static __attribute__((noinline))
+u32 remap_loop(const u32 map[32], u32 buttons)
+{
+    u32 remapped = 0;
+
+    for(u32 bit = 0; bit < 32; bit++) {
+        if(buttons & (1u << bit)) {
+            remapped |= map[bit];
+        }
+    }
+
+    return remapped;
+}
+
+static __attribute__((noinline))
+u32 remap_tables(const u32 map[32], u32 buttons)
+{
+    return remap_buttons(buttons);
+}
+
+static
+void identity_map(u32 map[32])
+{
+    for(u32 bit = 0; bit < 32; bit++) {
+        map[bit] = 1u << bit;
+    }
+}
+
+static
+void map_swap(u32 map[32])
+{
+    identity_map(map);
+    map[13] = SCE_CTRL_CROSS;
+    map[14] = SCE_CTRL_CIRCLE;
+}
+
+static
+void map_shoulders(u32 map[32])
+{
+    identity_map(map);
+    map[10] = SCE_CTRL_LTRIGGER;
+    map[11] = SCE_CTRL_RTRIGGER;
+}
+
+static
+void map_random(u32 map[32])
+{
+    u32 seed = 0x5EED;
+
+    for(u32 bit = 0; bit < 32; bit++) {
+        map[bit] = bench_random(&seed) & bench_random(&seed);
+    }
+}
+
+static
+void fill_rest(u32 *buttons, u32 count)
+{
+    for(u32 i = 0; i < count; i++) {
+        buttons[i] = 0;
+    }
+}
+
+// One or two of the face and shoulder buttons, changing every few polls.
+static
+void fill_held(u32 *buttons, u32 count)
+{
+    u32 seed = 7;
+    u32 held = 0;
+
+    for(u32 i = 0; i < count; i++) {
+        if(i % 8 == 0) {
+            u32 random = bench_random(&seed);
+            held = (1u << (8 + random % 8)) | ((random & 0x100) ? 1u << (8 + (random >> 9) % 8) : 0);
+        }
+        buttons[i] = held;
+    }
+}
+
+static
+void fill_random(u32 *buttons, u32 count)
+{
+    u32 seed = 0x12345678;
+
+    for(u32 i = 0; i < count; i++) {
+        buttons[i] = bench_random(&seed);
+    }
+}
+
+// The best time per remap over a few runs, in ns.
+static
+double time_remap(RemapFunc remap, const u32 map[32], const u32 *buttons, u32 count)
+{
+    u64 best = ~0ull;
+    volatile u32 sink = 0;
+
+    for(u32 repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+        u32 remapped = 0;
+        u64 start = bench_now_ns();
+        for(u32 i = 0; i < count; i++) {
+            remapped += remap(map, buttons[i]);
+        }
+        u64 elapsed = bench_now_ns() - start;
+
+        sink += remapped;
+        best = elapsed < best ? elapsed : best;
+    }
+
+    return (double)best / count;
+}
+
+// Checks the tables built from map against the loop. Returns false and reports the first disagreement if any.
+static
+bool check_remap(const char *name, const u32 map[32])
+{
+    u32 seed = 0xBADC0DE;
+
+    for(u32 i = 0; i < 4 * 256 + CHECK_WORDS; i++) {
+        // Every value of each byte on its own, then random words
+        u32 buttons = i < 4 * 256 ? (i % 256) << (8 * (i / 256)) : bench_random(&seed);
+
+        if(remap_tables(map, buttons) != remap_loop(map, buttons)) {
+            fprintf(stderr, "%s: the tables give 0x%08x for 0x%08x, the loop 0x%08x\n", name,
+                remap_tables(map, buttons), buttons, remap_loop(map, buttons));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static
+double time_build(const u32 map[32], u32 builds)
+{
+    u64 start = bench_now_ns();
+    for(u32 i = 0; i < builds; i++) {
+        button_remap_build(map);
+    }
+
+    return (double)(bench_now_ns() - start) / builds;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        const char *name;
+        void (*make)(u32 map[32]);
+    } remaps[] = {
+        { "swap", map_swap },
+        { "shoulders", map_shoulders },
+        { "random", map_random },
+    };
+    static const struct {
+        const char *name;
+        FillFunc fill;
+    } inputs[] = {
+        { "rest", fill_rest },
+        { "held", fill_held },
+        { "random", fill_random },
+    };
+    bool quick = bench_quick(argc, argv);
+    u32 count = quick ? BENCH_QUICK_SAMPLES : BENCH_SAMPLES;
+    u32 builds = quick ? BENCH_QUICK_BUILDS : BENCH_BUILDS;
+    u32 *buttons = malloc(sizeof(u32) * count);
+    u32 map[32];
+
+    // No remap is the identity, and skips the tables
+    identity_map(map);
+    button_remap_build(map);
+    if(g_button_remap_active != NULL) {
+        fprintf(stderr, "The identity remap built tables\n");
+        return 1;
+    }
+
+    for(u32 i = 0; i < sizeof(remaps) / sizeof(remaps[0]); i++) {
+        remaps[i].make(map);
+        button_remap_build(map);
+        if(g_button_remap_active == NULL || !check_remap(remaps[i].name, map)) {
+            return 1;
+        }
+    }
+
+    printf("Button remap, ns per poll, and us per table build\n");
+    printf("%-10s %-8s %12s %12s %10s %10s\n", "remap", "input", "loop", "tables", "speedup", "build");
+
+    for(u32 i = 0; i < sizeof(remaps) / sizeof(remaps[0]); i++) {
+        remaps[i].make(map);
+        double build = time_build(map, builds);
+
+        for(u32 j = 0; j < sizeof(inputs) / sizeof(inputs[0]); j++) {
+            inputs[j].fill(buttons, count);
+
+            double loop = time_remap(remap_loop, map, buttons, count);
+            double tables = time_remap(remap_tables, map, buttons, count);
+            printf("%-10s %-8s %12.2f %12.2f %9.2fx %10.2f\n", remaps[i].name, inputs[j].name, loop, tables,
+                loop / tables, build / 1000);
+        }
+    }
+
+    free(buttons);
+    return 0;
+}
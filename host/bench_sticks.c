@@ -0,0 +1,209 @@
+// PSP-EmulatedControllerTest host build
+// Benchmarks the stick word path against the per-axis code it replaced, for each step the callback does with
+// the four stick bytes:
+// * margin: checking which of the four axes are deflected past the center error margin
+// * merge: merging the injected sticks over the translated ones
+// * translate: the response curves from the PSP stick, merged with the injected sticks and stored
+// Over the sticks resting within the margin, random positions, and random positions with half the axes
+// within the margin, where the per-axis branches can't be predicted.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+#include "plugin.c"
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_SAMPLES (1 << 20)
+#define BENCH_QUICK_SAMPLES (1 << 16)
+#define BENCH_REPEATS (5)
+
+typedef struct {
+    // The PSP stick.
+    u8 lx;
+    u8 ly;
+    u8 rsrv[2];
+    // The injected sticks, in SceCtrlData2 order.
+    u8 sticks[4];
+} StickSample;
+
+typedef void (*FillFunc)(StickSample *samples, u32 count);
+typedef u32 (*StepFunc)(const StickSample *sample);
+
+static __attribute__((noinline))
+u32 margin_scalar(const StickSample *sample)
+{
+    return (u32)!axis_is_centered(sample->sticks[0]) | (u32)!axis_is_centered(sample->sticks[1]) << 1
+        | (u32)!axis_is_centered(sample->sticks[2]) << 2 | (u32)!axis_is_centered(sample->sticks[3]) << 3;
+}
+
+static __attribute__((noinline))
+u32 margin_word(const StickSample *sample)
+{
+    return stick_word_outside_margin(load_stick_word(sample->sticks));
+}
+
+static __attribute__((noinline))
+u32 merge_scalar(const StickSample *sample)
+{
+    u8 merged[4];
+
+    merged[0] = merge_injected_axis(sample->lx, sample->sticks[0]);
+    merged[1] = merge_injected_axis(sample->ly, sample->sticks[1]);
+    merged[2] = merge_injected_axis(sample->lx, sample->sticks[2]);
+    merged[3] = merge_injected_axis(sample->ly, sample->sticks[3]);
+    return load_stick_word(merged);
+}
+
+static __attribute__((noinline))
+u32 merge_word(const StickSample *sample)
+{
+    u32 translated = sample->lx * 0x00010001u | sample->ly * 0x01000100u;
+    return merge_injected_sticks(translated, load_stick_word(sample->sticks));
+}
+
+static __attribute__((noinline))
+u32 translate_scalar(const StickSample *sample)
+{
+    const AxisCurveTables *curves = &g_axis_curve_tables;
+    SceCtrlData2 out;
+
+    out.aX = merge_injected_axis(curves->lut[EMULATED_AXIS_AX][sample->lx], sample->sticks[0]);
+    out.aY = merge_injected_axis(curves->lut[EMULATED_AXIS_AY][sample->ly], sample->sticks[1]);
+    out.rX = merge_injected_axis(curves->lut[EMULATED_AXIS_RX][sample->lx], sample->sticks[2]);
+    out.rY = merge_injected_axis(curves->lut[EMULATED_AXIS_RY][sample->ly], sample->sticks[3]);
+    return load_stick_word(&out.aX);
+}
+
+static __attribute__((noinline))
+u32 translate_word(const StickSample *sample)
+{
+    const AxisCurveTables *curves = &g_axis_curve_tables;
+    SceCtrlData2 out;
+
+    u32 translated = curves->x_words[sample->lx] | curves->y_words[sample->ly];
+    store_stick_word(&out.aX, merge_injected_sticks(translated, load_stick_word(sample->sticks)));
+    return load_stick_word(&out.aX);
+}
+
+static
+void fill_rest(StickSample *samples, u32 count)
+{
+    u32 seed = 1;
+
+    for(u32 i = 0; i < count; i++) {
+        samples[i].lx = bench_rest_axis(&seed);
+        samples[i].ly = bench_rest_axis(&seed);
+        for(u32 axis = 0; axis < 4; axis++) {
+            samples[i].sticks[axis] = bench_rest_axis(&seed);
+        }
+    }
+}
+
+static
+void fill_noise(StickSample *samples, u32 count)
+{
+    u32 seed = 0x12345678;
+
+    for(u32 i = 0; i < count; i++) {
+        u32 random = bench_random(&seed);
+        samples[i].lx = (u8)random;
+        samples[i].ly = (u8)(random >> 8);
+        for(u32 axis = 0; axis < 4; axis++) {
+            samples[i].sticks[axis] = (u8)bench_random(&seed);
+        }
+    }
+}
+
+static
+void fill_mixed(StickSample *samples, u32 count)
+{
+    u32 seed = 0xABCDEF;
+
+    for(u32 i = 0; i < count; i++) {
+        u32 random = bench_random(&seed);
+        samples[i].lx = (u8)random;
+        samples[i].ly = (u8)(random >> 8);
+        for(u32 axis = 0; axis < 4; axis++) {
+            random = bench_random(&seed);
+            samples[i].sticks[axis] = (random & 1) ? bench_rest_axis(&seed) : (u8)(random >> 8);
+        }
+    }
+}
+
+// The best time per sample over a few runs, in ns.
+static
+double time_step(StepFunc step, const StickSample *samples, u32 count)
+{
+    u64 best = ~0ull;
+    volatile u32 sink = 0;
+
+    for(u32 repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+        u32 total = 0;
+        u64 start = bench_now_ns();
+        for(u32 i = 0; i < count; i++) {
+            total += step(&samples[i]);
+        }
+        u64 elapsed = bench_now_ns() - start;
+
+        sink += total;
+        best = elapsed < best ? elapsed : best;
+    }
+
+    return (double)best / count;
+}
+
+static
+void run_step(const char *step, const char *input, StepFunc scalar, StepFunc word, const StickSample *samples,
+    u32 count)
+{
+    double scalar_ns = time_step(scalar, samples, count);
+    double word_ns = time_step(word, samples, count);
+
+    printf("%-10s %-6s %12.2f %12.2f %9.2fx\n", step, input, scalar_ns, word_ns, scalar_ns / word_ns);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        const char *name;
+        FillFunc fill;
+    } inputs[] = {
+        { "rest", fill_rest },
+        { "noise", fill_noise },
+        { "mixed", fill_mixed },
+    };
+    u32 count = bench_quick(argc, argv) ? BENCH_QUICK_SAMPLES : BENCH_SAMPLES;
+    StickSample *samples = malloc(sizeof(StickSample) * count);
+
+    axis_curves_build(&g_axis_curve_tables, g_axis_curves);
+
+    printf("Stick bytes, ns per sample\n");
+    printf("%-10s %-6s %12s %12s %10s\n", "step", "input", "per axis", "word", "speedup");
+
+    for(u32 i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        inputs[i].fill(samples, count);
+
+        // The two have to agree before their times mean anything
+        for(u32 j = 0; j < count; j++) {
+            u32 margin = margin_word(&samples[j]);
+            u32 margin_axes = (margin & 1) | (margin >> 7 & 2) | (margin >> 14 & 4) | (margin >> 21 & 8);
+
+            if(margin_axes != margin_scalar(&samples[j]) || merge_word(&samples[j]) != merge_scalar(&samples[j])
+                    || translate_word(&samples[j]) != translate_scalar(&samples[j])) {
+                fprintf(stderr, "%s, sample %u: the word path and the per-axis path disagree\n", inputs[i].name, j);
+                return 1;
+            }
+        }
+
+        run_step("margin", inputs[i].name, margin_scalar, margin_word, samples, count);
+        run_step("merge", inputs[i].name, merge_scalar, merge_word, samples, count);
+        run_step("translate", inputs[i].name, translate_scalar, translate_word, samples, count);
+    }
+
+    free(samples);
+    return 0;
+}
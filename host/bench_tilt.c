@@ -0,0 +1,168 @@
+// PSP-EmulatedControllerTest host build
+// Benchmarks the tilt stage, synthesize_tilt() with TILT_SOURCE_STICK, against the same filter in floating point,
+// which the callback avoids, over the stick resting, stepping between positions every half second, and random
+// positions. Also prints the step response of the configured filter, the polls a full step takes to reach half,
+// 90% and within a count of its target.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#undef TILT_SOURCE
+#define TILT_SOURCE TILT_SOURCE_STICK
+
+#include "plugin.c"
+
+#include "bench.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_SAMPLES (1 << 20)
+#define BENCH_QUICK_SAMPLES (1 << 16)
+#define BENCH_REPEATS (5)
+
+#define STEP_POLLS (100)
+
+// The floating point filter, with the same stages and the same output rounding.
+typedef struct {
+    float stage[TILT_FILTER_ORDER][2];
+} FloatTiltState;
+
+static __attribute__((noinline))
+void tilt_fixed(void *state, const SceCtrlData *pad, SceCtrlData2 *out)
+{
+    synthesize_tilt(state, pad, out);
+}
+
+static __attribute__((noinline))
+void tilt_float(void *state, const SceCtrlData *pad, SceCtrlData2 *out)
+{
+    FloatTiltState *filter = state;
+    float target[2] = {
+        (float)((s32)pad->aX - SCE_CTRL_ANALOG_PAD_CENTER_VALUE) * TILT_FULL_SCALE / 128,
+        (float)((s32)pad->aY - SCE_CTRL_ANALOG_PAD_CENTER_VALUE) * TILT_FULL_SCALE / 128,
+    };
+    s32 tilt[2];
+
+    for(u32 axis = 0; axis < 2; axis++) {
+        float value = target[axis];
+        for(u32 i = 0; i < TILT_FILTER_ORDER; i++) {
+            filter->stage[i][axis] += (value - filter->stage[i][axis]) * (1.0f / (1 << TILT_FILTER_SHIFT));
+            value = filter->stage[i][axis];
+        }
+        tilt[axis] = (s32)lrintf(value);
+    }
+
+    if(out->TiltA == 0) {
+        out->TiltA = tilt[0];
+    }
+    if(out->TiltB == 0) {
+        out->TiltB = tilt[1];
+    }
+}
+
+static
+void fill_steps(BenchPadSample *samples, u32 count)
+{
+    u32 seed = 3;
+    u8 x = SCE_CTRL_ANALOG_PAD_CENTER_VALUE, y = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+
+    for(u32 i = 0; i < count; i++) {
+        if(i % 30 == 0) {
+            u32 random = bench_random(&seed);
+            x = (u8)random;
+            y = (u8)(random >> 8);
+        }
+        samples[i].buttons = 0;
+        samples[i].lx = x;
+        samples[i].ly = y;
+    }
+}
+
+// The best time per poll over a few runs, in ns.
+static
+double time_tilt(void (*tilt)(void *state, const SceCtrlData *pad, SceCtrlData2 *out), void *state,
+    const SceCtrlData *samples, u32 count)
+{
+    u64 best = ~0ull;
+    volatile s32 sink = 0;
+
+    for(u32 repeat = 0; repeat < BENCH_REPEATS; repeat++) {
+        s32 total = 0;
+        u64 start = bench_now_ns();
+        for(u32 i = 0; i < count; i++) {
+            SceCtrlData2 out = INPUT_CHANNEL_NEUTRAL_FRAME;
+            tilt(state, &samples[i], &out);
+            total += out.TiltA + out.TiltB;
+        }
+        u64 elapsed = bench_now_ns() - start;
+
+        sink += total;
+        best = elapsed < best ? elapsed : best;
+    }
+
+    return (double)best / count;
+}
+
+static
+void run_tilt(const char *name, const BenchPadSample *pads, u32 count, void *context)
+{
+    SceCtrlData *samples = calloc(count, sizeof(SceCtrlData));
+    TiltFilterState fixed = { 0 };
+    FloatTiltState floating = { 0 };
+
+    for(u32 i = 0; i < count; i++) {
+        samples[i].aX = pads[i].lx;
+        samples[i].aY = pads[i].ly;
+    }
+
+    double fixed_ns = time_tilt(tilt_fixed, &fixed, samples, count);
+    double float_ns = time_tilt(tilt_float, &floating, samples, count);
+    printf("%-8s %12.2f %12.2f\n", name, fixed_ns, float_ns);
+
+    free(samples);
+}
+
+// Prints how many polls a full step of the stick takes to reach half, 90% and within a count of its target.
+static
+void print_step_response(void)
+{
+    TiltFilterState state = { 0 };
+    SceCtrlData pad = { 0 };
+    s32 target = ((0xFF - SCE_CTRL_ANALOG_PAD_CENTER_VALUE) * TILT_FULL_SCALE) >> 7;
+    u32 half = 0, most = 0, settled = 0;
+
+    pad.aX = 0xFF;
+    pad.aY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    for(u32 poll = 1; poll <= STEP_POLLS && settled == 0; poll++) {
+        SceCtrlData2 out = INPUT_CHANNEL_NEUTRAL_FRAME;
+        synthesize_tilt(&state, &pad, &out);
+
+        half = half == 0 && 2 * out.TiltA >= target ? poll : half;
+        most = most == 0 && 10 * out.TiltA >= 9 * target ? poll : most;
+        settled = target - out.TiltA <= 1 ? poll : 0;
+    }
+
+    printf("Step response, order %d, shift %d: %u polls to 50%%, %u to 90%%, %u to within a count\n",
+        TILT_FILTER_ORDER, TILT_FILTER_SHIFT, half, most, settled);
+}
+
+int main(int argc, char **argv)
+{
+    static const BenchDistribution distributions[] = {
+        { "rest", bench_fill_rest },
+        { "steps", fill_steps },
+        { "noise", bench_fill_noise },
+    };
+    u32 count = bench_quick(argc, argv) ? BENCH_QUICK_SAMPLES : BENCH_SAMPLES;
+
+    print_step_response();
+
+    printf("Tilt stage, ns per poll\n");
+    printf("%-8s %12s %12s\n", "input", "fixed", "float");
+    bench_run_distributions(distributions, sizeof(distributions) / sizeof(distributions[0]), count, run_tilt, NULL);
+
+    return 0;
+}
@@ -0,0 +1,230 @@
+// PSP-EmulatedControllerTest host build
+// Benchmarks the input trace codec: the compression ratio, and the encode and decode throughput, over
+// * synthetic: polls a VBlank apart with a few microseconds of jitter, mostly idle, with a change of
+//   buttons, sticks or the other fields every 16 polls or so
+// * recorded: a trace the plugin recorded on the ctrl driver model, of the stick being swept around,
+//   flicked and left to rest, with the poll timestamps jittered the same way
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#undef INPUT_TRACE_MODE
+#define INPUT_TRACE_MODE INPUT_TRACE_MODE_RECORD
+
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_FRAMES (100000)
+#define BENCH_QUICK_FRAMES (10000)
+#define BENCH_JITTER (8)
+#define BENCH_REPEATS (5)
+
+static
+void jitter_timestamps(SceCtrlData2 *frames, u32 count)
+{
+    u32 seed = 7;
+
+    for(u32 i = 0; i < count; i++) {
+        frames[i].timeStamp += bench_random(&seed) % (2 * BENCH_JITTER + 1) - BENCH_JITTER;
+    }
+}
+
+static
+void make_synthetic(SceCtrlData2 *frames, u32 count)
+{
+    u32 seed = 0x2468ACE1;
+
+    memset(frames, 0, sizeof(SceCtrlData2) * count);
+
+    for(u32 i = 0; i < count; i++) {
+        SceCtrlData2 *frame = &frames[i];
+        u32 random = bench_random(&seed);
+
+        if(i > 0) {
+            *frame = frames[i - 1];
+        }
+        else {
+            frame->aX = frame->aY = frame->rX = frame->rY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+        }
+
+        frame->timeStamp = SIM_START_TIME + i * SIM_VBLANK_PERIOD;
+
+        switch((random >> 16) % 64) {
+        case 0:
+        case 1:
+            frame->buttons ^= 1u << ((random >> 24) % 16);
+            break;
+        case 2:
+            frame->aX = (u8)(random >> 8);
+            frame->aY = (u8)(random >> 24);
+            break;
+        case 3:
+            frame->DPadSenseA += (s32)((random >> 8) & 0xFF) - 128;
+            break;
+        }
+    }
+
+    jitter_timestamps(frames, count);
+}
+
+// Records count polls of the plugin's output on the ctrl driver model, and decodes them into frames.
+// Returns the number of frames recorded.
+static
+u32 make_recorded(SceCtrlData2 *frames, u32 count)
+{
+    u32 events = count / 8;
+    SimPadEvent *script = malloc(sizeof(SimPadEvent) * events);
+    u32 seed = 3;
+
+    // Every 8 polls the stick takes a step around a circle of changing radius, or rests, or flicks to an edge
+    for(u32 i = 0; i < events; i++) {
+        u32 random = bench_random(&seed);
+        double angle = i * (2.0 * 3.14159265358979 / 64.0);
+        double radius = (i / 64) % 3 == 0 ? 0 : 40.0 + (i % 512) / 8.0;
+
+        script[i].time = (u64)i * 8 * SIM_VBLANK_PERIOD;
+        script[i].buttons = 0;
+        script[i].lx = (u8)(SCE_CTRL_ANALOG_PAD_CENTER_VALUE + radius * cos(angle));
+        script[i].ly = (u8)(SCE_CTRL_ANALOG_PAD_CENTER_VALUE + radius * sin(angle));
+        if(random % 32 == 0) {
+            script[i].lx = random & 0x100 ? 0xFF : 0x00;
+        }
+    }
+
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    if(module_start(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_start failed\n");
+        exit(1);
+    }
+
+    sim_ctrl_play(script, events);
+    sim_run_for((u64)count * SIM_VBLANK_PERIOD);
+
+    if(module_stop(0, NULL) != MODULE_OK) {
+        fprintf(stderr, "module_stop failed\n");
+        exit(1);
+    }
+
+    u32 len;
+    const u8 *trace = sim_file_get(INPUT_TRACE_PATH, &len);
+    InputTraceDecoder decoder;
+    u32 pos = INPUT_TRACE_HEADER_SIZE;
+    u32 decoded = 0;
+
+    input_trace_decoder_init(&decoder);
+    while(trace != NULL && decoded < count) {
+        s32 result = input_trace_decode(&decoder, trace + pos, len - pos, &frames[decoded]);
+        if(result < 0) {
+            break;
+        }
+        pos += result;
+        decoded++;
+    }
+
+    free(script);
+    jitter_timestamps(frames, decoded);
+    return decoded;
+}
+
+static
+u32 encode_all(const SceCtrlData2 *frames, u32 count, u8 *out)
+{
+    InputTraceEncoder encoder;
+    u32 n = 0;
+
+    input_trace_encoder_init(&encoder);
+    for(u32 i = 0; i < count; i++) {
+        n += input_trace_encode(&encoder, &frames[i], out + n);
+    }
+
+    return n + input_trace_encode_flush(&encoder, out + n);
+}
+
+static
+u32 decode_all(const u8 *in, u32 len, SceCtrlData2 *frames, u32 count)
+{
+    InputTraceDecoder decoder;
+    u32 pos = 0;
+    u32 decoded = 0;
+
+    input_trace_decoder_init(&decoder);
+    while(decoded < count) {
+        s32 result = input_trace_decode(&decoder, in + pos, len - pos, &frames[decoded]);
+        if(result < 0) {
+            break;
+        }
+        pos += result;
+        decoded++;
+    }
+
+    return decoded;
+}
+
+static
+void run_dataset(const char *name, const SceCtrlData2 *frames, u32 count)
+{
+    u8 *encoded = malloc((size_t)count * INPUT_TRACE_MAX_ENCODE_SIZE);
+    SceCtrlData2 *decoded = malloc(sizeof(SceCtrlData2) * count);
+    u64 encode_ns = ~0ull;
+    u64 decode_ns = ~0ull;
+    u32 len = 0;
+
+    // The best of a few runs
+    for(u32 i = 0; i < BENCH_REPEATS; i++) {
+        u64 start = bench_now_ns();
+        len = encode_all(frames, count, encoded);
+        u64 elapsed = bench_now_ns() - start;
+        encode_ns = elapsed < encode_ns ? elapsed : encode_ns;
+
+        start = bench_now_ns();
+        u32 decoded_count = decode_all(encoded, len, decoded, count);
+        elapsed = bench_now_ns() - start;
+        decode_ns = elapsed < decode_ns ? elapsed : decode_ns;
+
+        if(decoded_count != count || memcmp(decoded, frames, sizeof(SceCtrlData2) * count) != 0) {
+            fprintf(stderr, "%s: the trace doesn't decode back to the frames\n", name);
+            exit(1);
+        }
+    }
+
+    double raw = (double)count * sizeof(SceCtrlData2);
+    printf("%-10s %8u %10.2f %8.1fx %10.1f %10.1f %10.0f %10.0f\n", name, count, (double)len / count,
+        raw / len, (double)encode_ns / count, (double)decode_ns / count,
+        raw / 1e6 / (encode_ns / 1e9), raw / 1e6 / (decode_ns / 1e9));
+
+    free(encoded);
+    free(decoded);
+}
+
+int main(int argc, char **argv)
+{
+    u32 count = bench_quick(argc, argv) ? BENCH_QUICK_FRAMES : BENCH_FRAMES;
+    SceCtrlData2 *frames = malloc(sizeof(SceCtrlData2) * count);
+
+    printf("Input trace codec, %u byte frames, +/-%uus of poll jitter\n", (u32)sizeof(SceCtrlData2), BENCH_JITTER);
+    printf("%-10s %8s %10s %9s %10s %10s %10s %10s\n", "data", "frames", "bytes/fr", "ratio",
+        "enc ns/fr", "dec ns/fr", "enc MB/s", "dec MB/s");
+
+    make_synthetic(frames, count);
+    run_dataset("synthetic", frames, count);
+
+    u32 recorded = make_recorded(frames, count);
+    if(recorded < count / 2) {
+        fprintf(stderr, "Only %u frames were recorded\n", recorded);
+        return 1;
+    }
+    run_dataset("recorded", frames, recorded);
+
+    free(frames);
+    return 0;
+}
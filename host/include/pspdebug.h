@@ -0,0 +1,10 @@
+// PSP-EmulatedControllerTest host build
+// Stand-in for the PSP SDK header of the same name, for building the plugin on the host.
+
+#ifndef PSPDEBUG_H
+#define PSPDEBUG_H
+
+void pspDebugScreenInit(void);
+void pspDebugScreenKprintf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+#endif /* PSPDEBUG_H */
@@ -0,0 +1,9 @@
+// PSP-EmulatedControllerTest host build
+// Stand-in for the PSP SDK header of the same name, for building the plugin on the host.
+
+#ifndef PSPDISPLAY_H
+#define PSPDISPLAY_H
+
+int sceDisplayWaitVblankStart(void);
+
+#endif /* PSPDISPLAY_H */
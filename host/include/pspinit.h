@@ -0,0 +1,15 @@
+// PSP-EmulatedControllerTest host build
+// Stand-in for the PSP SDK header of the same name, for building the plugin on the host.
+
+#ifndef PSPINIT_H
+#define PSPINIT_H
+
+enum PSPKeyConfig {
+    PSP_INIT_KEYCONFIG_VSH = 0x100,
+    PSP_INIT_KEYCONFIG_GAME = 0x200,
+    PSP_INIT_KEYCONFIG_POPS = 0x300,
+};
+
+int sceKernelInitKeyConfig(void);
+
+#endif /* PSPINIT_H */
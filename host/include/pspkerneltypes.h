@@ -0,0 +1,9 @@
+// PSP-EmulatedControllerTest host build
+// Stand-in for the PSP SDK header of the same name, for building the plugin on the host.
+
+#ifndef PSPKERNELTYPES_H
+#define PSPKERNELTYPES_H
+
+#include <psptypes.h>
+
+#endif /* PSPKERNELTYPES_H */
@@ -0,0 +1,19 @@
+// PSP-EmulatedControllerTest host build
+// Stand-in for the PSP SDK header of the same name, for building the plugin on the host.
+
+#ifndef PSPKERROR_H
+#define PSPKERROR_H
+
+#define SCE_KERNEL_ERROR_ILLEGAL_THID       0x80020198
+#define SCE_KERNEL_ERROR_WAIT_TIMEOUT       0x800201A8
+#define SCE_KERNEL_ERROR_UNKNOWN_THID       0x800201A9
+#define SCE_KERNEL_ERROR_UNKNOWN_SEMID      0x800201AB
+#define SCE_KERNEL_ERROR_NOT_DORMANT        0x800201A4
+#define SCE_KERNEL_ERROR_SEMA_OVF           0x800201AF
+#define SCE_KERNEL_ERROR_NO_MEMORY          0x80020190
+#define SCE_KERNEL_ERROR_ILLEGAL_CONTEXT    0x80020064
+#define SCE_KERNEL_ERROR_MFILE              0x80020320
+#define SCE_KERNEL_ERROR_NOFILE             0x80010002
+#define SCE_KERNEL_ERROR_BADF               0x80020323
+
+#endif /* PSPKERROR_H */
@@ -0,0 +1,23 @@
+// PSP-EmulatedControllerTest host build
+// Stand-in for the PSP SDK header of the same name, for building the plugin on the host.
+
+#ifndef PSPSDK_H
+#define PSPSDK_H
+
+#include <psptypes.h>
+
+#define PSP_MODULE_KERNEL 0x1000
+
+// The module info and newlib settings only matter to the PRX loader, so they expand to harmless declarations.
+#define PSP_MODULE_INFO(name, attributes, major_version, minor_version) \
+    const char host_module_name[] = name
+#define PSP_HEAP_SIZE_KB(size_kb) extern int host_heap_size_kb
+#define PSP_MAIN_THREAD_ATTR(attr) extern int host_main_thread_attr
+#define PSP_MAIN_THREAD_NAME(name) extern int host_main_thread_name
+#define PSP_NO_CREATE_MAIN_THREAD() extern int host_no_create_main_thread
+#define PSP_DISABLE_NEWLIB() extern int host_disable_newlib
+
+unsigned int pspSdkSetK1(unsigned int k1);
+unsigned int pspSdkGetK1(void);
+
+#endif /* PSPSDK_H */
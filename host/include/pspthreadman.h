@@ -0,0 +1,29 @@
+// PSP-EmulatedControllerTest host build
+// Stand-in for the PSP SDK header of the same name, for building the plugin on the host.
+
+#ifndef PSPTHREADMAN_H
+#define PSPTHREADMAN_H
+
+#include <psptypes.h>
+
+typedef int (*SceKernelThreadEntry)(SceSize args, void *argp);
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority, int stackSize, SceUInt attr, void *option);
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp);
+int sceKernelDeleteThread(SceUID thid);
+int sceKernelTerminateDeleteThread(SceUID thid);
+int sceKernelWaitThreadEnd(SceUID thid, SceUInt *timeout);
+int sceKernelSleepThread(void);
+int sceKernelSleepThreadCB(void);
+int sceKernelWakeupThread(SceUID thid);
+int sceKernelDelayThread(SceUInt delay);
+int sceKernelDelayThreadCB(SceUInt delay);
+
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int initVal, int maxVal, void *option);
+int sceKernelDeleteSema(SceUID semaid);
+int sceKernelSignalSema(SceUID semaid, int signal);
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout);
+
+u32 sceKernelGetSystemTimeLow(void);
+
+#endif /* PSPTHREADMAN_H */
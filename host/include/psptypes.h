@@ -0,0 +1,26 @@
+// PSP-EmulatedControllerTest host build
+// Stand-in for the PSP SDK header of the same name, for building the plugin on the host.
+
+#ifndef PSPTYPES_H
+#define PSPTYPES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef unsigned int SceUInt;
+typedef int SceInt;
+typedef unsigned int SceSize;
+typedef int SceUID;
+typedef int SceMode;
+typedef long long SceOff;
+
+#endif /* PSPTYPES_H */
@@ -0,0 +1,15 @@
+// PSP-EmulatedControllerTest host build
+// The whole plugin as a single translation unit, so a test or benchmark can reach its static state and
+// build it with its own configuration. Include config.h first, then override any of its defines, then
+// include this file.
+//
+// Ryan Crosby 2025
+
+#include "../emulated_controller_test.c"
+#include "../button_remap.c"
+#include "../turbo.c"
+#include "../pressure.c"
+#include "../poll_stats.c"
+#include "../input_trace.c"
+#include "../input_record.c"
+#include "../input_replay.c"
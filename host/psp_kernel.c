@@ -0,0 +1,897 @@
+// PSP-EmulatedControllerTest host build
+// Host stand-ins for the kernel, display, file and debug screen functions the plugin imports. See sim.h.
+//
+// Ryan Crosby 2025
+
+#include "sim.h"
+
+#include <pspsdk.h>
+#include <pspkerror.h>
+#include <pspthreadman.h>
+#include <pspiofilemgr.h>
+#include <pspinit.h>
+#include <pspdisplay.h>
+#include <pspdebug.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#define NEVER (~(u64)0)
+
+#define MAX_THREADS (16)
+#define MAX_SEMAS (16)
+#define MAX_TIMERS (8)
+#define MAX_FILES (16)
+#define MAX_FDS (8)
+
+#define THREAD_UID_BASE (0x1000)
+#define SEMA_UID_BASE (0x2000)
+#define FD_BASE (3)
+
+// The plugin asks for tiny kernel stacks, which host code would overflow.
+#define HOST_STACK_SIZE (256 * 1024)
+
+typedef enum {
+    THREAD_FREE,
+    THREAD_DORMANT,
+    THREAD_READY,
+    THREAD_WAITING,
+    THREAD_DONE,
+} ThreadState;
+
+typedef enum {
+    // Waits for the deadline only
+    WAIT_DELAY,
+    WAIT_SLEEP,
+    WAIT_SEMA,
+    WAIT_THREAD_END,
+} WaitKind;
+
+typedef struct {
+    ThreadState state;
+    char name[32];
+    SceKernelThreadEntry entry;
+    int priority;
+    SceSize args;
+    void *argp;
+    ucontext_t context;
+    void *stack;
+
+    u32 wakeups;
+    WaitKind wait;
+    // Waits time out at the deadline, NEVER if there is none.
+    u64 deadline;
+    SceUID wait_id;
+    int wait_count;
+    int wait_result;
+
+    // Breaks ties between threads of the same priority, least recently run first.
+    u64 last_run;
+} SimThread;
+
+typedef struct {
+    bool used;
+    int count;
+    int max;
+} SimSema;
+
+typedef struct {
+    bool active;
+    u64 next;
+    SimTimerFunc func;
+    void *context;
+} SimTimer;
+
+typedef struct {
+    char path[64];
+    u8 *data;
+    u32 size;
+    u32 capacity;
+} SimFile;
+
+typedef struct {
+    SimFile *file;
+    int flags;
+    u32 position;
+} SimFd;
+
+static u64 g_now = SIM_START_TIME;
+static u64 g_run_count = 0;
+
+static SimThread g_threads[MAX_THREADS];
+// Blocking calls made outside of any thread wait here.
+static SimThread g_host_thread;
+static SimThread *g_current = NULL;
+static ucontext_t g_scheduler_context;
+
+static SimSema g_semas[MAX_SEMAS];
+static SimTimer g_timers[MAX_TIMERS];
+static bool g_in_interrupt = false;
+static u32 g_context_violations = 0;
+
+static SimFile g_files[MAX_FILES];
+static SimFd g_fds[MAX_FDS];
+static u32 g_io_latency = 0;
+static u32 g_io_bytes_per_second = 0;
+static u32 g_io_calls = 0;
+
+static int g_key_config = PSP_INIT_KEYCONFIG_GAME;
+static bool g_verbose = false;
+static unsigned int g_k1 = 0;
+
+static
+void context_violation(const char *function)
+{
+    g_context_violations++;
+    fprintf(stderr, "sim: %s called in interrupt context at %llu us\n", function, (unsigned long long)g_now);
+}
+
+//
+// Scheduler
+//
+
+static
+SimThread *thread_from_uid(SceUID thid)
+{
+    u32 index = (u32)(thid - THREAD_UID_BASE);
+
+    if(thid < THREAD_UID_BASE || index >= MAX_THREADS || g_threads[index].state == THREAD_FREE) {
+        return NULL;
+    }
+
+    return &g_threads[index];
+}
+
+// Ends the wait of a waiting thread if its condition holds or its deadline has passed, taking whatever
+// resource it waited for. Returns true if the thread can run.
+static
+bool thread_try_wake(SimThread *thread)
+{
+    if(thread->state == THREAD_READY) {
+        return true;
+    }
+    if(thread->state != THREAD_WAITING) {
+        return false;
+    }
+
+    bool done = false;
+
+    switch(thread->wait) {
+        case WAIT_DELAY:
+            break;
+        case WAIT_SLEEP:
+            if(thread->wakeups > 0) {
+                thread->wakeups--;
+                done = true;
+            }
+            break;
+        case WAIT_SEMA: {
+            SimSema *sema = &g_semas[thread->wait_id - SEMA_UID_BASE];
+            if(!sema->used) {
+                thread->wait_result = SCE_KERNEL_ERROR_UNKNOWN_SEMID;
+                thread->state = THREAD_READY;
+                return true;
+            }
+            if(sema->count >= thread->wait_count) {
+                sema->count -= thread->wait_count;
+                done = true;
+            }
+            break;
+        }
+        case WAIT_THREAD_END: {
+            SimThread *target = thread_from_uid(thread->wait_id);
+            done = target == NULL || target->state == THREAD_DONE || target->state == THREAD_DORMANT;
+            break;
+        }
+    }
+
+    if(done) {
+        thread->wait_result = 0;
+    }
+    else if(g_now >= thread->deadline) {
+        thread->wait_result = thread->wait == WAIT_DELAY ? 0 : (int)SCE_KERNEL_ERROR_WAIT_TIMEOUT;
+        done = true;
+    }
+
+    if(done) {
+        thread->state = THREAD_READY;
+    }
+
+    return done;
+}
+
+static
+void thread_entry(int index)
+{
+    SimThread *thread = &g_threads[index];
+
+    thread->entry(thread->args, thread->argp);
+    thread->state = THREAD_DONE;
+    setcontext(&g_scheduler_context);
+}
+
+static
+void fire_due_timers(void)
+{
+    for(;;) {
+        SimTimer *due = NULL;
+
+        for(u32 i = 0; i < MAX_TIMERS; i++) {
+            SimTimer *timer = &g_timers[i];
+            if(timer->active && timer->next <= g_now && (due == NULL || timer->next < due->next)) {
+                due = timer;
+            }
+        }
+
+        if(due == NULL) {
+            return;
+        }
+
+        g_in_interrupt = true;
+        u64 next = due->func(due->context, g_now);
+        g_in_interrupt = false;
+
+        if(next == 0) {
+            due->active = false;
+        }
+        else {
+            due->next = next > g_now ? next : g_now + 1;
+        }
+    }
+}
+
+// Runs the highest priority thread that can run, until it blocks. Returns false if none can.
+static
+bool run_next_thread(void)
+{
+    SimThread *order[MAX_THREADS];
+    u32 count = 0;
+
+    // Sort the live threads by priority, least recently run first within a priority
+    for(u32 i = 0; i < MAX_THREADS; i++) {
+        SimThread *thread = &g_threads[i];
+        if(thread->state != THREAD_READY && thread->state != THREAD_WAITING) {
+            continue;
+        }
+
+        u32 j = count++;
+        while(j > 0 && (order[j - 1]->priority > thread->priority
+            || (order[j - 1]->priority == thread->priority && order[j - 1]->last_run > thread->last_run))) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = thread;
+    }
+
+    // The first one whose wait is over runs, so it's also the one that gets a contended semaphore
+    for(u32 i = 0; i < count; i++) {
+        SimThread *next = order[i];
+        if(!thread_try_wake(next)) {
+            continue;
+        }
+
+        next->last_run = ++g_run_count;
+        g_current = next;
+        swapcontext(&g_scheduler_context, &next->context);
+        g_current = NULL;
+
+        return true;
+    }
+
+    return false;
+}
+
+// The earliest time a waiting thread or a timer needs the clock to reach.
+static
+u64 next_event_time(void)
+{
+    u64 next = NEVER;
+
+    for(u32 i = 0; i < MAX_THREADS; i++) {
+        if(g_threads[i].state == THREAD_WAITING && g_threads[i].deadline < next) {
+            next = g_threads[i].deadline;
+        }
+    }
+    for(u32 i = 0; i < MAX_TIMERS; i++) {
+        if(g_timers[i].active && g_timers[i].next < next) {
+            next = g_timers[i].next;
+        }
+    }
+
+    return next;
+}
+
+// Fires the due timers and runs one thread, or moves the clock to the next event if no thread can run.
+// Returns false if nothing can happen before limit.
+static
+bool sim_step(u64 limit)
+{
+    fire_due_timers();
+
+    if(run_next_thread()) {
+        return true;
+    }
+
+    u64 next = next_event_time();
+    if(next == NEVER || next > limit) {
+        return false;
+    }
+
+    g_now = next;
+    return true;
+}
+
+// Blocks the calling thread, or the host context, until thread_try_wake() lets it go.
+static
+int block(WaitKind wait, u64 deadline, SceUID wait_id, int wait_count)
+{
+    SimThread *thread = g_current != NULL ? g_current : &g_host_thread;
+
+    thread->state = THREAD_WAITING;
+    thread->wait = wait;
+    thread->deadline = deadline;
+    thread->wait_id = wait_id;
+    thread->wait_count = wait_count;
+
+    if(g_current != NULL) {
+        swapcontext(&thread->context, &g_scheduler_context);
+    }
+    else {
+        while(!thread_try_wake(thread)) {
+            if(!sim_step(thread->deadline)) {
+                if(thread->deadline == NEVER) {
+                    fprintf(stderr, "sim: deadlock, the host context waits on something that never happens\n");
+                    abort();
+                }
+                g_now = thread->deadline;
+            }
+        }
+    }
+
+    thread->state = g_current != NULL ? THREAD_READY : THREAD_FREE;
+    return thread->wait_result;
+}
+
+static
+u64 deadline_after(const SceUInt *timeout)
+{
+    return timeout != NULL ? g_now + *timeout : NEVER;
+}
+
+void sim_kernel_init(void)
+{
+    for(u32 i = 0; i < MAX_THREADS; i++) {
+        free(g_threads[i].stack);
+    }
+    for(u32 i = 0; i < MAX_FILES; i++) {
+        free(g_files[i].data);
+    }
+
+    memset(g_threads, 0, sizeof(g_threads));
+    memset(&g_host_thread, 0, sizeof(g_host_thread));
+    memset(g_semas, 0, sizeof(g_semas));
+    memset(g_timers, 0, sizeof(g_timers));
+    memset(g_files, 0, sizeof(g_files));
+    memset(g_fds, 0, sizeof(g_fds));
+
+    g_now = SIM_START_TIME;
+    g_run_count = 0;
+    g_current = NULL;
+    g_in_interrupt = false;
+    g_context_violations = 0;
+    g_io_latency = 0;
+    g_io_bytes_per_second = 0;
+    g_io_calls = 0;
+    g_key_config = PSP_INIT_KEYCONFIG_GAME;
+}
+
+u64 sim_now(void)
+{
+    return g_now;
+}
+
+void sim_run_until(u64 time)
+{
+    while(sim_step(time)) {
+    }
+
+    if(g_now < time) {
+        g_now = time;
+    }
+    fire_due_timers();
+}
+
+void sim_run_for(u64 duration)
+{
+    sim_run_until(g_now + duration);
+}
+
+void sim_advance_clock(u64 duration)
+{
+    g_now += duration;
+}
+
+void sim_add_timer(u64 first, SimTimerFunc func, void *context)
+{
+    for(u32 i = 0; i < MAX_TIMERS; i++) {
+        if(!g_timers[i].active) {
+            g_timers[i] = (SimTimer){ .active = true, .next = first, .func = func, .context = context };
+            return;
+        }
+    }
+
+    fprintf(stderr, "sim: out of timers\n");
+    abort();
+}
+
+bool sim_in_interrupt(void)
+{
+    return g_in_interrupt;
+}
+
+u32 sim_context_violations(void)
+{
+    return g_context_violations;
+}
+
+void sim_set_key_config(int key_config)
+{
+    g_key_config = key_config;
+}
+
+void sim_set_verbose(bool verbose)
+{
+    g_verbose = verbose;
+}
+
+//
+// Threads
+//
+
+SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int initPriority, int stackSize, SceUInt attr, void *option)
+{
+    for(u32 i = 0; i < MAX_THREADS; i++) {
+        SimThread *thread = &g_threads[i];
+        if(thread->state != THREAD_FREE) {
+            continue;
+        }
+
+        free(thread->stack);
+        memset(thread, 0, sizeof(*thread));
+        snprintf(thread->name, sizeof(thread->name), "%s", name);
+        thread->entry = entry;
+        thread->priority = initPriority;
+        thread->stack = malloc(HOST_STACK_SIZE);
+        thread->state = THREAD_DORMANT;
+
+        return THREAD_UID_BASE + (SceUID)i;
+    }
+
+    return SCE_KERNEL_ERROR_NO_MEMORY;
+}
+
+int sceKernelStartThread(SceUID thid, SceSize arglen, void *argp)
+{
+    SimThread *thread = thread_from_uid(thid);
+
+    if(thread == NULL) {
+        return SCE_KERNEL_ERROR_UNKNOWN_THID;
+    }
+    if(thread->state != THREAD_DORMANT) {
+        return SCE_KERNEL_ERROR_NOT_DORMANT;
+    }
+
+    thread->args = arglen;
+    thread->argp = argp;
+
+    getcontext(&thread->context);
+    thread->context.uc_stack.ss_sp = thread->stack;
+    thread->context.uc_stack.ss_size = HOST_STACK_SIZE;
+    thread->context.uc_link = NULL;
+    makecontext(&thread->context, (void (*)(void))thread_entry, 1, (int)(thread - g_threads));
+
+    thread->state = THREAD_READY;
+    return 0;
+}
+
+int sceKernelDeleteThread(SceUID thid)
+{
+    SimThread *thread = thread_from_uid(thid);
+
+    if(thread == NULL) {
+        return SCE_KERNEL_ERROR_UNKNOWN_THID;
+    }
+    if(thread->state != THREAD_DORMANT && thread->state != THREAD_DONE) {
+        return SCE_KERNEL_ERROR_NOT_DORMANT;
+    }
+
+    thread->state = THREAD_FREE;
+    return 0;
+}
+
+int sceKernelTerminateDeleteThread(SceUID thid)
+{
+    SimThread *thread = thread_from_uid(thid);
+
+    if(thread == NULL) {
+        return SCE_KERNEL_ERROR_UNKNOWN_THID;
+    }
+    if(thread == g_current) {
+        return SCE_KERNEL_ERROR_ILLEGAL_THID;
+    }
+
+    // Threads only stop at blocking calls, so it can just be dropped.
+    thread->state = THREAD_FREE;
+    return 0;
+}
+
+int sceKernelWaitThreadEnd(SceUID thid, SceUInt *timeout)
+{
+    if(g_in_interrupt) {
+        context_violation(__func__);
+        return SCE_KERNEL_ERROR_ILLEGAL_CONTEXT;
+    }
+    if(thread_from_uid(thid) == NULL) {
+        return SCE_KERNEL_ERROR_UNKNOWN_THID;
+    }
+
+    return block(WAIT_THREAD_END, deadline_after(timeout), thid, 0);
+}
+
+int sceKernelSleepThread(void)
+{
+    if(g_in_interrupt) {
+        context_violation(__func__);
+        return SCE_KERNEL_ERROR_ILLEGAL_CONTEXT;
+    }
+
+    return block(WAIT_SLEEP, NEVER, 0, 0);
+}
+
+int sceKernelSleepThreadCB(void)
+{
+    return sceKernelSleepThread();
+}
+
+int sceKernelWakeupThread(SceUID thid)
+{
+    SimThread *thread = thread_from_uid(thid);
+
+    if(thread == NULL) {
+        return SCE_KERNEL_ERROR_UNKNOWN_THID;
+    }
+
+    thread->wakeups++;
+    return 0;
+}
+
+int sceKernelDelayThread(SceUInt delay)
+{
+    if(g_in_interrupt) {
+        context_violation(__func__);
+        return SCE_KERNEL_ERROR_ILLEGAL_CONTEXT;
+    }
+
+    return block(WAIT_DELAY, g_now + delay, 0, 0);
+}
+
+int sceKernelDelayThreadCB(SceUInt delay)
+{
+    return sceKernelDelayThread(delay);
+}
+
+u32 sceKernelGetSystemTimeLow(void)
+{
+    return (u32)g_now;
+}
+
+//
+// Semaphores
+//
+
+SceUID sceKernelCreateSema(const char *name, SceUInt attr, int initVal, int maxVal, void *option)
+{
+    for(u32 i = 0; i < MAX_SEMAS; i++) {
+        if(!g_semas[i].used) {
+            g_semas[i] = (SimSema){ .used = true, .count = initVal, .max = maxVal };
+            return SEMA_UID_BASE + (SceUID)i;
+        }
+    }
+
+    return SCE_KERNEL_ERROR_NO_MEMORY;
+}
+
+static
+SimSema *sema_from_uid(SceUID semaid)
+{
+    u32 index = (u32)(semaid - SEMA_UID_BASE);
+
+    if(semaid < SEMA_UID_BASE || index >= MAX_SEMAS || !g_semas[index].used) {
+        return NULL;
+    }
+
+    return &g_semas[index];
+}
+
+int sceKernelDeleteSema(SceUID semaid)
+{
+    SimSema *sema = sema_from_uid(semaid);
+
+    if(sema == NULL) {
+        return SCE_KERNEL_ERROR_UNKNOWN_SEMID;
+    }
+
+    sema->used = false;
+    return 0;
+}
+
+int sceKernelSignalSema(SceUID semaid, int signal)
+{
+    SimSema *sema = sema_from_uid(semaid);
+
+    if(sema == NULL) {
+        return SCE_KERNEL_ERROR_UNKNOWN_SEMID;
+    }
+    if(sema->count + signal > sema->max) {
+        return SCE_KERNEL_ERROR_SEMA_OVF;
+    }
+
+    sema->count += signal;
+    return 0;
+}
+
+int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout)
+{
+    if(g_in_interrupt) {
+        context_violation(__func__);
+        return SCE_KERNEL_ERROR_ILLEGAL_CONTEXT;
+    }
+    if(sema_from_uid(semaid) == NULL) {
+        return SCE_KERNEL_ERROR_UNKNOWN_SEMID;
+    }
+
+    return block(WAIT_SEMA, deadline_after(timeout), semaid, signal);
+}
+
+//
+// Init, display and debug screen
+//
+
+int sceKernelInitKeyConfig(void)
+{
+    return g_key_config;
+}
+
+int sceDisplayWaitVblankStart(void)
+{
+    if(g_in_interrupt) {
+        context_violation(__func__);
+        return SCE_KERNEL_ERROR_ILLEGAL_CONTEXT;
+    }
+
+    return block(WAIT_DELAY, (g_now / SIM_VBLANK_PERIOD + 1) * SIM_VBLANK_PERIOD, 0, 0);
+}
+
+unsigned int pspSdkSetK1(unsigned int k1)
+{
+    unsigned int previous = g_k1;
+    g_k1 = k1;
+    return previous;
+}
+
+unsigned int pspSdkGetK1(void)
+{
+    return g_k1;
+}
+
+void pspDebugScreenInit(void)
+{
+}
+
+void pspDebugScreenKprintf(const char *format, ...)
+{
+    if(!g_verbose) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+//
+// Files
+//
+
+void sim_io_set_throttle(u32 latency, u32 bytes_per_second)
+{
+    g_io_latency = latency;
+    g_io_bytes_per_second = bytes_per_second;
+}
+
+static
+SimFile *find_file(const char *path, bool create)
+{
+    SimFile *free_file = NULL;
+
+    for(u32 i = 0; i < MAX_FILES; i++) {
+        if(g_files[i].path[0] == '\0') {
+            if(free_file == NULL) {
+                free_file = &g_files[i];
+            }
+        }
+        else if(strcmp(g_files[i].path, path) == 0) {
+            return &g_files[i];
+        }
+    }
+
+    if(!create || free_file == NULL) {
+        return NULL;
+    }
+
+    snprintf(free_file->path, sizeof(free_file->path), "%s", path);
+    return free_file;
+}
+
+static
+void file_reserve(SimFile *file, u32 size)
+{
+    if(size <= file->capacity) {
+        return;
+    }
+
+    u32 capacity = file->capacity != 0 ? file->capacity : 4096;
+    while(capacity < size) {
+        capacity *= 2;
+    }
+
+    file->data = realloc(file->data, capacity);
+    file->capacity = capacity;
+}
+
+void sim_file_set(const char *path, const void *data, u32 size)
+{
+    SimFile *file = find_file(path, true);
+
+    file_reserve(file, size);
+    memcpy(file->data, data, size);
+    file->size = size;
+}
+
+const u8 *sim_file_get(const char *path, u32 *size)
+{
+    SimFile *file = find_file(path, false);
+
+    if(file == NULL) {
+        return NULL;
+    }
+
+    *size = file->size;
+    return file->data;
+}
+
+u32 sim_io_calls(void)
+{
+    return g_io_calls;
+}
+
+static
+SimFd *fd_from_id(SceUID fd)
+{
+    u32 index = (u32)(fd - FD_BASE);
+
+    if(fd < FD_BASE || index >= MAX_FDS || g_fds[index].file == NULL) {
+        return NULL;
+    }
+
+    return &g_fds[index];
+}
+
+// Blocks the caller for as long as moving size bytes takes.
+static
+void io_throttle(u32 size)
+{
+    u64 duration = g_io_latency;
+
+    if(g_io_bytes_per_second != 0) {
+        duration += (u64)size * 1000000 / g_io_bytes_per_second;
+    }
+
+    if(duration != 0) {
+        block(WAIT_DELAY, g_now + duration, 0, 0);
+    }
+}
+
+SceUID sceIoOpen(const char *file, int flags, SceMode mode)
+{
+    if(g_in_interrupt) {
+        context_violation(__func__);
+        return SCE_KERNEL_ERROR_ILLEGAL_CONTEXT;
+    }
+
+    SimFile *sim_file = find_file(file, (flags & PSP_O_CREAT) != 0);
+    if(sim_file == NULL) {
+        return SCE_KERNEL_ERROR_NOFILE;
+    }
+
+    for(u32 i = 0; i < MAX_FDS; i++) {
+        if(g_fds[i].file == NULL) {
+            if(flags & PSP_O_TRUNC) {
+                sim_file->size = 0;
+            }
+            g_fds[i] = (SimFd){ .file = sim_file, .flags = flags, .position = (flags & PSP_O_APPEND) ? sim_file->size : 0 };
+            return FD_BASE + (SceUID)i;
+        }
+    }
+
+    return SCE_KERNEL_ERROR_MFILE;
+}
+
+int sceIoClose(SceUID fd)
+{
+    if(g_in_interrupt) {
+        context_violation(__func__);
+        return SCE_KERNEL_ERROR_ILLEGAL_CONTEXT;
+    }
+
+    SimFd *sim_fd = fd_from_id(fd);
+    if(sim_fd == NULL) {
+        return SCE_KERNEL_ERROR_BADF;
+    }
+
+    sim_fd->file = NULL;
+    return 0;
+}
+
+int sceIoRead(SceUID fd, void *data, SceSize size)
+{
+    if(g_in_interrupt) {
+        context_violation(__func__);
+        return SCE_KERNEL_ERROR_ILLEGAL_CONTEXT;
+    }
+
+    SimFd *sim_fd = fd_from_id(fd);
+    if(sim_fd == NULL || !(sim_fd->flags & PSP_O_RDONLY)) {
+        return SCE_KERNEL_ERROR_BADF;
+    }
+
+    g_io_calls++;
+
+    u32 available = sim_fd->file->size - sim_fd->position;
+    u32 count = size < available ? size : available;
+    memcpy(data, sim_fd->file->data + sim_fd->position, count);
+    sim_fd->position += count;
+
+    io_throttle(count);
+    return (int)count;
+}
+
+int sceIoWrite(SceUID fd, const void *data, SceSize size)
+{
+    if(g_in_interrupt) {
+        context_violation(__func__);
+        return SCE_KERNEL_ERROR_ILLEGAL_CONTEXT;
+    }
+
+    SimFd *sim_fd = fd_from_id(fd);
+    if(sim_fd == NULL || !(sim_fd->flags & PSP_O_WRONLY)) {
+        return SCE_KERNEL_ERROR_BADF;
+    }
+
+    g_io_calls++;
+
+    SimFile *file = sim_fd->file;
+    file_reserve(file, sim_fd->position + size);
+    memcpy(file->data + sim_fd->position, data, size);
+    sim_fd->position += size;
+    if(sim_fd->position > file->size) {
+        file->size = sim_fd->position;
+    }
+
+    io_throttle(size);
+    return (int)size;
+}
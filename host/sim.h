@@ -0,0 +1,150 @@
+// PSP-EmulatedControllerTest host build
+// Control interface of the host stand-ins for the PSP kernel and ctrl driver.
+//
+// Ryan Crosby 2025
+//
+// The plugin is built on the host against the stub headers in host/include, and linked with psp_kernel.c and
+// sim_ctrl.c, which implement the functions it imports.
+//
+// Time is virtual. Kernel threads are cooperative green threads that run until they block, and the clock
+// only moves forward when every thread is blocked, to the next thread wake-up or timer. Timers run in
+// "interrupt context", like the ctrl driver's sampling, where blocking calls and file I/O are counted as
+// context violations instead of being carried out. The same inputs always produce the same run.
+//
+// The code calling into the plugin, such as module_start(), runs in the host context. A blocking call
+// made from there runs the threads and timers until it can return.
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "ctrl_imports.h"
+
+#include <stdbool.h>
+
+// The virtual clock starts here rather than at 0, so no timestamp is ever 0.
+#define SIM_START_TIME (1000000)
+
+// The time from one VBlank to the next, in microseconds.
+#define SIM_VBLANK_PERIOD (16683)
+
+//
+// Kernel
+//
+
+// Resets the clock, threads, semaphores and files. Threads left over from a previous run are discarded.
+void sim_kernel_init(void);
+
+// The current virtual time in microseconds.
+u64 sim_now(void);
+
+// Runs threads and timers until the clock reaches time.
+void sim_run_until(u64 time);
+
+// Runs threads and timers for duration microseconds.
+void sim_run_for(u64 duration);
+
+// Moves the clock forward without running any thread or timer. For benchmarks that call the controller
+// callback directly; anything that came due runs on the next sim_run_until().
+void sim_advance_clock(u64 duration);
+
+// Called in interrupt context when a timer fires at time now. Returns the time of its next firing,
+// which must be later than now, or 0 to stop the timer.
+typedef u64 (*SimTimerFunc)(void *context, u64 now);
+
+// Starts a timer that first fires at time first.
+void sim_add_timer(u64 first, SimTimerFunc func, void *context);
+
+// True while a timer is running.
+bool sim_in_interrupt(void);
+
+// The number of blocking calls and file operations attempted in interrupt context.
+u32 sim_context_violations(void);
+
+// Sets the value returned by sceKernelInitKeyConfig(). PSP_INIT_KEYCONFIG_GAME by default.
+void sim_set_key_config(int key_config);
+
+// Prints the plugin's debug output to stdout when set. Off by default.
+void sim_set_verbose(bool verbose);
+
+//
+// Files
+//
+
+// Sets how long file reads and writes block the calling thread: latency microseconds per call, plus the
+// time to move the data at bytes_per_second. Both 0 by default, which makes them complete immediately.
+void sim_io_set_throttle(u32 latency, u32 bytes_per_second);
+
+// Creates or replaces a file with the given contents.
+void sim_file_set(const char *path, const void *data, u32 size);
+
+// Returns the contents of a file and sets size, or returns NULL if there is no such file.
+const u8 *sim_file_get(const char *path, u32 *size);
+
+// The number of sceIoRead() and sceIoWrite() calls made so far.
+u32 sim_io_calls(void);
+
+//
+// Ctrl driver
+//
+
+// When the driver polls the external ports within a sampling cycle, relative to merging the emulation slots
+// into the sample that sceCtrlPeekBufferPositive() returns.
+typedef enum {
+    // Poll the ports first, so their passthrough output is merged into the same cycle's sample. The
+    // callback's own peek then returns the previous cycle's sample.
+    SIM_CTRL_HANDLERS_FIRST,
+    // Merge first, so the passthrough output shows one cycle later, but the callback peeks the current sample.
+    SIM_CTRL_MERGE_FIRST,
+} SimCtrlOrder;
+
+// A change of the PSP's own controls, time microseconds after sim_ctrl_play() was called.
+typedef struct {
+    u64 time;
+    u32 buttons;
+    u8 lx;
+    u8 ly;
+} SimPadEvent;
+
+// Called in interrupt context with every sample the driver publishes.
+typedef void (*SimCtrlSampleHook)(void *context, const SceCtrlData *sample);
+
+// Resets the ctrl driver and starts its sampling loop: the registered port handlers, the emulation slots and
+// the pad state are forgotten, the order is SIM_CTRL_HANDLERS_FIRST and the sampling cycle is VBlank-synced.
+// Call after sim_kernel_init().
+void sim_ctrl_init(void);
+
+void sim_ctrl_set_order(SimCtrlOrder order);
+
+// Sets the state of the PSP's own controls, as the next sample will read it.
+void sim_ctrl_set_pad(u32 buttons, u8 lx, u8 ly);
+
+// The time the PSP's own controls last changed.
+u64 sim_ctrl_pad_changed(void);
+
+// Samples the PSP's controls and merges the emulation slots without polling the ports. For benchmarks
+// that call the controller callback directly.
+void sim_ctrl_take_sample(void);
+
+// Plays a script of pad changes, sorted by time. The events must stay valid until the script is done.
+void sim_ctrl_play(const SimPadEvent *events, u32 count);
+
+// Sets the function called with each sample, or NULL.
+void sim_ctrl_set_sample_hook(SimCtrlSampleHook hook, void *context);
+
+// Returns the transfer handler registered for an external port, and sets source to its input source,
+// or returns NULL if the port has no handler.
+const SceCtrlInputDataTransferHandler *sim_ctrl_port_handler(u8 port, void **source);
+
+// The output of the external port's last poll, as sceCtrlPeekBufferPositive2() would return it.
+const SceCtrlData2 *sim_ctrl_port_data(u8 port);
+
+// The number of times the external port's handler has been called.
+u32 sim_ctrl_port_polls(u8 port);
+
+// The ports passed through into the emulation slots, as last set with sceCtrl_driver_6C86AF22().
+u32 sim_ctrl_passthrough_mask(void);
+
+// The number of samples published so far.
+u32 sim_ctrl_samples(void);
+
+#endif /* SIM_H */
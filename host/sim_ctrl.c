@@ -0,0 +1,366 @@
+// PSP-EmulatedControllerTest host build
+// A model of the ctrl driver's sampling loop, behind the sceCtrl functions the plugin imports. See sim.h.
+//
+// Ryan Crosby 2025
+//
+// Every sampling cycle the model reads the PSP's own controls, polls the registered external ports and
+// merges the emulation slots into the sample, like the driver's sampling interrupt. Which of the last two
+// happens first is set with sim_ctrl_set_order(), since it decides how late the passthrough output is.
+
+#include "sim.h"
+
+#include <pspthreadman.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_CTRL_PORTS (3)
+#define SIM_CTRL_EMULATION_SLOTS (4)
+
+#define SCE_ERROR_INVALID_VALUE (0x800001FE)
+
+// The passed through stick only overrides the PSP stick when it is deflected further than this from the
+// center, the same margin the plugin assumes with CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN.
+#define SIM_CTRL_STICK_MARGIN (37)
+
+typedef struct {
+    const SceCtrlInputDataTransferHandler *handler;
+    void *source;
+    // The output of the port's last poll.
+    SceCtrlData2 data;
+    u32 polls;
+} SimCtrlPort;
+
+typedef struct {
+    u32 user_buttons;
+    u32 kernel_buttons;
+    u32 button_samples;
+    u8 aX;
+    u8 aY;
+    u32 analog_samples;
+    // Written by a port passthrough rather than sceCtrlSetAnalogEmulation(), so a centered stick doesn't override.
+    bool passthrough;
+} SimEmulationSlot;
+
+typedef struct {
+    u64 time;
+    u32 buttons;
+    u8 lx;
+    u8 ly;
+} SimPadState;
+
+static SimCtrlPort g_ctrl_ports[SIM_CTRL_PORTS];
+static SimEmulationSlot g_slots[SIM_CTRL_EMULATION_SLOTS];
+static SimPadState g_pad;
+static SceCtrlData g_sample;
+static u32 g_samples;
+static u32 g_passthrough_mask;
+static u8 g_sampling_mode;
+static u32 g_sampling_cycle;
+static SimCtrlOrder g_order;
+static SimCtrlSampleHook g_sample_hook;
+static void *g_sample_hook_context;
+
+static const SimPadEvent *g_script;
+static u32 g_script_length;
+static u32 g_script_next;
+static u64 g_script_start;
+
+static
+bool stick_outside_margin(u8 value)
+{
+    int offset = (int)value - SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    return offset > SIM_CTRL_STICK_MARGIN || offset < -SIM_CTRL_STICK_MARGIN;
+}
+
+// Polls every registered port, and passes the output of the ports in the passthrough mask into the
+// emulation slot with the same index, for the next merge only.
+static
+void poll_ports(void)
+{
+    for(u32 port = 1; port < SIM_CTRL_PORTS; port++) {
+        SimCtrlPort *ctrl_port = &g_ctrl_ports[port];
+        if(ctrl_port->handler == NULL) {
+            continue;
+        }
+
+        SceCtrlData2 *data = &ctrl_port->data;
+        memset(data, 0, sizeof(*data));
+        data->timeStamp = (u32)sim_now();
+        data->aX = data->aY = data->rX = data->rY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+
+        ctrl_port->handler->copyInputData(ctrl_port->source, data);
+        ctrl_port->polls++;
+
+        if(g_passthrough_mask & (1u << (port - 1))) {
+            SimEmulationSlot *slot = &g_slots[port];
+            slot->user_buttons = data->buttons;
+            slot->kernel_buttons = data->buttons;
+            slot->button_samples = 1;
+            slot->aX = data->aX;
+            slot->aY = data->aY;
+            slot->analog_samples = 1;
+            slot->passthrough = true;
+        }
+    }
+}
+
+// Samples the PSP's controls, merges the emulation slots into the sample and publishes it.
+static
+void merge_sample(void)
+{
+    SceCtrlData sample;
+
+    memset(&sample, 0, sizeof(sample));
+    sample.timeStamp = (u32)sim_now();
+    sample.buttons = g_pad.buttons;
+    sample.aX = g_pad.lx;
+    sample.aY = g_pad.ly;
+
+    for(u32 i = 0; i < SIM_CTRL_EMULATION_SLOTS; i++) {
+        SimEmulationSlot *slot = &g_slots[i];
+
+        if(slot->button_samples > 0) {
+            sample.buttons |= slot->kernel_buttons;
+            slot->button_samples--;
+        }
+
+        if(slot->analog_samples > 0) {
+            if(!slot->passthrough || stick_outside_margin(slot->aX) || stick_outside_margin(slot->aY)) {
+                sample.aX = slot->aX;
+                sample.aY = slot->aY;
+            }
+            slot->analog_samples--;
+        }
+    }
+
+    g_sample = sample;
+    g_samples++;
+
+    if(g_sample_hook != NULL) {
+        g_sample_hook(g_sample_hook_context, &g_sample);
+    }
+}
+
+static
+void run_cycle(void)
+{
+    if(g_order == SIM_CTRL_HANDLERS_FIRST) {
+        poll_ports();
+        merge_sample();
+    }
+    else {
+        merge_sample();
+        poll_ports();
+    }
+}
+
+static
+u64 next_cycle_time(u64 now)
+{
+    if(g_sampling_cycle == 0) {
+        return (now / SIM_VBLANK_PERIOD + 1) * SIM_VBLANK_PERIOD;
+    }
+
+    return now + g_sampling_cycle;
+}
+
+static
+u64 sampling_timer(void *context, u64 now)
+{
+    run_cycle();
+    return next_cycle_time(now);
+}
+
+static
+u64 script_timer(void *context, u64 now)
+{
+    while(g_script_next < g_script_length && g_script_start + g_script[g_script_next].time <= now) {
+        const SimPadEvent *event = &g_script[g_script_next++];
+        sim_ctrl_set_pad(event->buttons, event->lx, event->ly);
+    }
+
+    if(g_script_next >= g_script_length) {
+        return 0;
+    }
+
+    return g_script_start + g_script[g_script_next].time;
+}
+
+void sim_ctrl_init(void)
+{
+    memset(g_ctrl_ports, 0, sizeof(g_ctrl_ports));
+    memset(g_slots, 0, sizeof(g_slots));
+    memset(&g_sample, 0, sizeof(g_sample));
+    g_pad = (SimPadState){ 0, 0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE };
+    g_sample.aX = g_sample.aY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    g_samples = 0;
+    g_passthrough_mask = 0;
+    g_sampling_mode = SCE_CTRL_INPUT_DIGITAL_ONLY;
+    g_sampling_cycle = 0;
+    g_order = SIM_CTRL_HANDLERS_FIRST;
+    g_sample_hook = NULL;
+    g_script = NULL;
+    g_script_length = 0;
+
+    sim_add_timer(next_cycle_time(sim_now()), sampling_timer, NULL);
+}
+
+void sim_ctrl_set_order(SimCtrlOrder order)
+{
+    g_order = order;
+}
+
+void sim_ctrl_set_pad(u32 buttons, u8 lx, u8 ly)
+{
+    if(buttons != g_pad.buttons || lx != g_pad.lx || ly != g_pad.ly) {
+        g_pad = (SimPadState){ sim_now(), buttons, lx, ly };
+    }
+}
+
+u64 sim_ctrl_pad_changed(void)
+{
+    return g_pad.time;
+}
+
+void sim_ctrl_take_sample(void)
+{
+    merge_sample();
+}
+
+void sim_ctrl_play(const SimPadEvent *events, u32 count)
+{
+    g_script = events;
+    g_script_length = count;
+    g_script_next = 0;
+    g_script_start = sim_now();
+
+    if(count > 0) {
+        sim_add_timer(g_script_start + events[0].time, script_timer, NULL);
+    }
+}
+
+void sim_ctrl_set_sample_hook(SimCtrlSampleHook hook, void *context)
+{
+    g_sample_hook = hook;
+    g_sample_hook_context = context;
+}
+
+const SceCtrlInputDataTransferHandler *sim_ctrl_port_handler(u8 port, void **source)
+{
+    if(port == 0 || port >= SIM_CTRL_PORTS) {
+        return NULL;
+    }
+
+    *source = g_ctrl_ports[port].source;
+    return g_ctrl_ports[port].handler;
+}
+
+const SceCtrlData2 *sim_ctrl_port_data(u8 port)
+{
+    if(port == 0 || port >= SIM_CTRL_PORTS) {
+        return NULL;
+    }
+
+    return &g_ctrl_ports[port].data;
+}
+
+u32 sim_ctrl_port_polls(u8 port)
+{
+    if(port == 0 || port >= SIM_CTRL_PORTS) {
+        return 0;
+    }
+
+    return g_ctrl_ports[port].polls;
+}
+
+u32 sim_ctrl_passthrough_mask(void)
+{
+    return g_passthrough_mask;
+}
+
+u32 sim_ctrl_samples(void)
+{
+    return g_samples;
+}
+
+//
+// Imports
+//
+
+s32 sceCtrl_driver_E467BEC8(u8 externalPort, SceCtrlInputDataTransferHandler *transferHandler, void *inputSource)
+{
+    if(externalPort == 0 || externalPort >= SIM_CTRL_PORTS) {
+        return SCE_ERROR_INVALID_VALUE;
+    }
+
+    g_ctrl_ports[externalPort].handler = transferHandler;
+    g_ctrl_ports[externalPort].source = inputSource;
+    return 0;
+}
+
+u32 sceCtrl_driver_6C86AF22(s32 arg1)
+{
+    u32 previous = g_passthrough_mask;
+    g_passthrough_mask = (u32)arg1;
+    return previous;
+}
+
+s32 sceCtrlPeekBufferPositive(SceCtrlData *pData, u8 nBufs)
+{
+    for(u8 i = 0; i < nBufs; i++) {
+        pData[i] = g_sample;
+    }
+
+    return nBufs;
+}
+
+s32 sceCtrlSetSamplingMode(u8 mode)
+{
+    u8 previous = g_sampling_mode;
+    g_sampling_mode = mode;
+    return previous;
+}
+
+s32 sceCtrlSetSamplingCycle(u32 cycle)
+{
+    if(cycle != 0 && (cycle < 5555 || cycle > 20000)) {
+        return SCE_ERROR_INVALID_VALUE;
+    }
+
+    u32 previous = g_sampling_cycle;
+    g_sampling_cycle = cycle;
+    return (s32)previous;
+}
+
+u32 sceCtrlGetSamplingCycle(u32 *pCycle)
+{
+    *pCycle = g_sampling_cycle;
+    return 0;
+}
+
+s32 sceCtrlSetButtonEmulation(u8 slot, u32 userButtons, u32 kernelButtons, u32 uiMake)
+{
+    if(slot >= SIM_CTRL_EMULATION_SLOTS) {
+        return SCE_ERROR_INVALID_VALUE;
+    }
+
+    g_slots[slot].user_buttons = userButtons;
+    g_slots[slot].kernel_buttons = kernelButtons;
+    g_slots[slot].button_samples = uiMake;
+    return 0;
+}
+
+s32 sceCtrlSetAnalogEmulation(u8 slot, u8 aX, u8 aY, u32 uiMake)
+{
+    if(slot >= SIM_CTRL_EMULATION_SLOTS) {
+        return SCE_ERROR_INVALID_VALUE;
+    }
+
+    g_slots[slot].aX = aX;
+    g_slots[slot].aY = aY;
+    g_slots[slot].analog_samples = uiMake;
+    g_slots[slot].passthrough = false;
+    return 0;
+}
@@ -0,0 +1,37 @@
+// PSP-EmulatedControllerTest host build
+// Checks shared by the host tests.
+//
+// Ryan Crosby 2025
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+static int g_test_failures = 0;
+
+// Reports a failed check, and carries on so every failure of a run is reported.
+#define CHECK(condition) \
+    do { \
+        if(!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            g_test_failures++; \
+        } \
+    } while(0)
+
+// Like CHECK(), for two unsigned values, printing both when they differ.
+#define CHECK_EQ(actual, expected) \
+    do { \
+        unsigned long long actual_value = (unsigned long long)(actual); \
+        unsigned long long expected_value = (unsigned long long)(expected); \
+        if(actual_value != expected_value) { \
+            fprintf(stderr, "%s:%d: check failed: %s == %s (0x%llx != 0x%llx)\n", __FILE__, __LINE__, \
+                #actual, #expected, actual_value, expected_value); \
+            g_test_failures++; \
+        } \
+    } while(0)
+
+// The exit code of a test.
+#define TEST_RESULT() (g_test_failures == 0 ? 0 : 1)
+
+#endif /* TEST_H */
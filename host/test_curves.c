@@ -0,0 +1,135 @@
+// PSP-EmulatedControllerTest host build
+// Checks the baked response curves against their definitions, for every raw stick value.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+#include "plugin.c"
+
+#include "sim.h"
+#include "test.h"
+
+#include <math.h>
+
+// The output a curve should give for a raw stick value, worked out in floating point.
+static
+double expected_output(const AxisCurve *curve, u32 value)
+{
+    if(curve->invert) {
+        value = 255 - value;
+    }
+
+    int deflection = (int)value - SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+    double magnitude = fabs((double)deflection);
+    double t;
+
+    if(magnitude <= curve->inner_deadzone) {
+        t = 0;
+    }
+    else if(magnitude >= 128 - curve->outer_deadzone) {
+        t = 1;
+    }
+    else {
+        t = (magnitude - curve->inner_deadzone) / (128 - curve->outer_deadzone - curve->inner_deadzone);
+    }
+
+    double shaped;
+    switch(curve->type) {
+    case AXIS_CURVE_LINEAR:
+        shaped = t;
+        break;
+    case AXIS_CURVE_EXPONENTIAL:
+        shaped = t * t;
+        break;
+    case AXIS_CURVE_S_CURVE:
+        shaped = 3 * t * t - 2 * t * t * t;
+        break;
+    case AXIS_CURVE_CUSTOM: {
+        // The curve is looked up at whole point coordinates
+        double x = floor(t * 255), x0 = 0, y0 = 0;
+        shaped = 1;
+        for(u32 i = 0; i <= curve->point_count; i++) {
+            double x1 = i < curve->point_count ? curve->points[i][0] : 255;
+            double y1 = i < curve->point_count ? curve->points[i][1] : 255;
+            if(x <= x1) {
+                shaped = (x1 == x0 ? y1 : y0 + (y1 - y0) * (x - x0) / (x1 - x0)) / 255;
+                break;
+            }
+            x0 = x1;
+            y0 = y1;
+        }
+        break;
+    }
+    default:
+        shaped = 0;
+        break;
+    }
+
+    double output = SCE_CTRL_ANALOG_PAD_CENTER_VALUE + (deflection < 0 ? -1 : 1) * shaped * 128;
+    return output < 0 ? 0 : output > 255 ? 255 : output;
+}
+
+// Checks every raw value of the curve's table is within tolerance of its definition.
+static
+void check_curve(const char *name, const AxisCurve *curve, double tolerance)
+{
+    for(u32 value = 0; value < 256; value++) {
+        double expected = expected_output(curve, value);
+        u8 actual = axis_curve_eval(curve, value);
+
+        if(fabs(actual - expected) > tolerance) {
+            fprintf(stderr, "%s: value %u gave %u, expected %.2f\n", name, value, actual, expected);
+            g_test_failures++;
+            return;
+        }
+    }
+}
+
+int main(void)
+{
+    static const AxisCurve center = { .type = AXIS_CURVE_CENTER };
+    static const AxisCurve linear = { .type = AXIS_CURVE_LINEAR };
+    static const AxisCurve inverted = { .type = AXIS_CURVE_LINEAR, .invert = true };
+    static const AxisCurve exponential = { .type = AXIS_CURVE_EXPONENTIAL };
+    static const AxisCurve s_curve = { .type = AXIS_CURVE_S_CURVE };
+    static const AxisCurve deadzones = { .type = AXIS_CURVE_LINEAR, .inner_deadzone = 20, .outer_deadzone = 10 };
+    // Rises steeply, then falls back, then rises to full again
+    static const AxisCurve custom_falling = {
+        .type = AXIS_CURVE_CUSTOM,
+        .point_count = 3,
+        .points = { { 64, 200 }, { 160, 40 }, { 192, 40 } },
+    };
+    // Falls all the way to center at the edge
+    static const AxisCurve custom_to_center = {
+        .type = AXIS_CURVE_CUSTOM,
+        .point_count = 2,
+        .points = { { 128, 255 }, { 254, 0 } },
+    };
+
+    check_curve("center", &center, 0);
+    check_curve("linear", &linear, 1);
+    check_curve("inverted", &inverted, 1);
+    check_curve("exponential", &exponential, 1);
+    check_curve("s-curve", &s_curve, 1);
+    check_curve("deadzones", &deadzones, 1);
+    check_curve("custom falling", &custom_falling, 1.5);
+    check_curve("custom to center", &custom_to_center, 1.5);
+
+    // A falling segment stays between its end points rather than wrapping around
+    for(u32 value = SCE_CTRL_ANALOG_PAD_CENTER_VALUE; value < 256; value++) {
+        CHECK(axis_curve_eval(&custom_to_center, value) >= SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+        CHECK(axis_curve_eval(&custom_to_center, 255 - value) <= SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    }
+
+    // The baked tables and stick words agree with the curves
+    const AxisCurve curves[EMULATED_AXIS_COUNT] = { linear, custom_falling, inverted, exponential };
+    static AxisCurveTables tables;
+    axis_curves_build(&tables, curves);
+    for(u32 value = 0; value < 256; value++) {
+        CHECK_EQ(tables.lut[EMULATED_AXIS_AY][value], axis_curve_eval(&custom_falling, value));
+        CHECK_EQ((tables.y_words[value] >> STICK_WORD_AY_SHIFT) & 0xFF, axis_curve_eval(&custom_falling, value));
+        CHECK_EQ((tables.x_words[value] >> STICK_WORD_RX_SHIFT) & 0xFF, axis_curve_eval(&inverted, value));
+    }
+
+    return TEST_RESULT();
+}
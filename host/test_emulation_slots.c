@@ -0,0 +1,123 @@
+// PSP-EmulatedControllerTest host build
+// Checks the emulation slot backend on the ctrl driver model: injected buttons and sticks reach the peeked
+// sample, the PSP stick shows through while the output stick is centered, and the stick driven D-pad
+// directions follow the physical stick rather than the slot's own output.
+//
+// Built a second time with TEST_LEFT_STICK_CURVE, to check module_start() refuses a curve on the left stick.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#undef INJECTION_BACKEND
+#define INJECTION_BACKEND INJECTION_BACKEND_EMULATION_SLOTS
+
+#ifdef TEST_LEFT_STICK_CURVE
+#undef AXIS_CURVE_AX
+#define AXIS_CURVE_AX { .type = AXIS_CURVE_LINEAR }
+#endif
+
+#include "plugin.c"
+
+#include "sim.h"
+#include "test.h"
+
+#define TEST_PORT (SCE_CTRL_PORT_DS3)
+
+// The slot thread writes on one VBlank and the driver merges on the next, so two cycles is always enough.
+#define SETTLE_TIME (2 * SIM_VBLANK_PERIOD)
+
+static
+SceCtrlData peek(void)
+{
+    SceCtrlData sample;
+
+    CHECK_EQ(sceCtrlPeekBufferPositive(&sample, 1), 1);
+    return sample;
+}
+
+static
+void inject(u32 buttons, u8 ax, u8 ay)
+{
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+
+    frame.buttons = buttons;
+    frame.aX = ax;
+    frame.aY = ay;
+    CHECK_EQ(emuCtrlSetInputFrame(TEST_PORT, &frame), SCE_ERROR_OK);
+    sim_run_for(SETTLE_TIME);
+}
+
+static
+void test_injected_input(void)
+{
+    inject(SCE_CTRL_CROSS | SCE_CTRL_START, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    SceCtrlData sample = peek();
+    CHECK_EQ(sample.buttons & (SCE_CTRL_CROSS | SCE_CTRL_START), SCE_CTRL_CROSS | SCE_CTRL_START);
+    CHECK_EQ(sample.aX, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+
+    // An injected stick overrides the PSP stick
+    inject(0, 0xFF, 0x10);
+    sample = peek();
+    CHECK_EQ(sample.buttons & SCE_CTRL_CROSS, 0);
+    CHECK_EQ(sample.aX, 0xFF);
+    CHECK_EQ(sample.aY, 0x10);
+
+    // And once it is centered again, the slot's stick expires and the PSP stick shows through
+    inject(0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    sim_run_for(EMULATION_SLOT_DURATION * SIM_VBLANK_PERIOD);
+    sim_ctrl_set_pad(0, 0x50, 0xB0);
+    sim_run_for(SETTLE_TIME);
+    sample = peek();
+    CHECK_EQ(sample.aX, 0x50);
+    CHECK_EQ(sample.aY, 0xB0);
+
+    sim_ctrl_set_pad(0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    sim_run_for(SETTLE_TIME);
+}
+
+// The stick driven directions come and go with the PSP stick, and never latch on the slot's output.
+static
+void test_stick_directions(void)
+{
+    for(u32 round = 0; round < 4; round++) {
+        sim_ctrl_set_pad(0, 0x00, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+        sim_run_for(SETTLE_TIME);
+        SceCtrlData sample = peek();
+        CHECK(sample.buttons & SCE_CTRL_LEFT);
+        CHECK_EQ(sample.aX, 0x00);
+
+        sim_ctrl_set_pad(0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+        sim_run_for(SETTLE_TIME);
+        sample = peek();
+        CHECK_EQ(sample.buttons & SCE_CTRL_LEFT, 0);
+        CHECK_EQ(sample.aX, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    }
+}
+
+int main(void)
+{
+    sim_kernel_init();
+    sim_ctrl_init();
+
+#ifdef TEST_LEFT_STICK_CURVE
+    // The curve would be applied to the slot's own stick on every update
+    CHECK_EQ(module_start(0, NULL), MODULE_ERROR);
+#else
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    // Nothing goes through the external ports
+    void *source;
+    CHECK(sim_ctrl_port_handler(TEST_PORT, &source) == NULL);
+
+    test_injected_input();
+    test_stick_directions();
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+#endif
+
+    CHECK_EQ(sim_context_violations(), 0);
+
+    return TEST_RESULT();
+}
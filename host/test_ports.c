@@ -0,0 +1,170 @@
+// PSP-EmulatedControllerTest host build
+// Checks both external ports emulated at once: each registers its own handler and is passed through, both are
+// polled in every sampling cycle, and while the PSP's controls drive both they report the same frame, built
+// from the same PSP sample taken once for the cycle. Input injected into one port stays out of the other,
+// and a port left out of CONTROLLER_PSP_INPUT_PORTS only reports its injected input.
+//
+// Built with both ports following the PSP's controls, and a second time with TEST_DS3_PSP_INPUT, where only
+// the DS3 port does.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#undef CONTROLLER_PORTS
+#define CONTROLLER_PORTS (CONTROLLER_PORT_BIT(SCE_CTRL_PORT_DS3) | CONTROLLER_PORT_BIT(SCE_CTRL_PORT_UNKNOWN_2))
+
+#undef CONTROLLER_PSP_INPUT_PORTS
+#ifdef TEST_DS3_PSP_INPUT
+#define CONTROLLER_PSP_INPUT_PORTS (CONTROLLER_PORT_BIT(SCE_CTRL_PORT_DS3))
+#else
+#define CONTROLLER_PSP_INPUT_PORTS CONTROLLER_PORTS
+#endif
+
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SCRIPT_POLLS (600)
+
+// The PSP's buttons and stick change every poll, often enough between the thresholds to exercise every stage.
+static
+SimPadEvent *make_script(u32 count)
+{
+    SimPadEvent *events = malloc(sizeof(SimPadEvent) * count);
+    u32 seed = 0xD5D5;
+
+    for(u32 i = 0; i < count; i++) {
+        u32 random = bench_random(&seed);
+        events[i].time = (u64)i * SIM_VBLANK_PERIOD;
+        events[i].buttons = (random & 0x10000) ? SCE_CTRL_CROSS << (random >> 30) : 0;
+        events[i].lx = (u8)random;
+        events[i].ly = (u8)(random >> 8);
+    }
+
+    return events;
+}
+
+static
+bool same_frame(const SceCtrlData2 *a, const SceCtrlData2 *b)
+{
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+// Checks the ports' output of each poll while the script plays, in the given order of port polls and merge.
+static
+void check_script(SimCtrlOrder order)
+{
+    SimPadEvent *script = make_script(SCRIPT_POLLS);
+    EmulatedPort *ds3 = emulated_port(SCE_CTRL_PORT_DS3);
+    EmulatedPort *second = emulated_port(SCE_CTRL_PORT_UNKNOWN_2);
+    u32 samples = g_pad_sample_stats.samples;
+    u32 shared = g_pad_sample_stats.shared;
+    u32 mismatches = 0;
+    SceCtrlData2 rest = *sim_ctrl_port_data(SCE_CTRL_PORT_UNKNOWN_2);
+
+    sim_ctrl_set_order(order);
+    sim_ctrl_play(script, SCRIPT_POLLS);
+
+    for(u32 i = 0; i < SCRIPT_POLLS; i++) {
+        u32 ds3_polls = sim_ctrl_port_polls(SCE_CTRL_PORT_DS3);
+        u32 second_polls = sim_ctrl_port_polls(SCE_CTRL_PORT_UNKNOWN_2);
+
+        sim_run_for(SIM_VBLANK_PERIOD);
+
+        // Both ports in every cycle
+        CHECK_EQ(sim_ctrl_port_polls(SCE_CTRL_PORT_DS3), ds3_polls + 1);
+        CHECK_EQ(sim_ctrl_port_polls(SCE_CTRL_PORT_UNKNOWN_2), second_polls + 1);
+
+        const SceCtrlData2 *ds3_data = sim_ctrl_port_data(SCE_CTRL_PORT_DS3);
+        const SceCtrlData2 *second_data = sim_ctrl_port_data(SCE_CTRL_PORT_UNKNOWN_2);
+
+        if(second->psp_input) {
+            // The same sample, and so the same frame apart from the driver's own timestamp
+            CHECK(ds3->pad_sampled && second->pad_sampled);
+            CHECK_EQ(ds3->pad_sample_time, second->pad_sample_time);
+
+            SceCtrlData2 frame = *second_data;
+            frame.timeStamp = ds3_data->timeStamp;
+            mismatches += !same_frame(ds3_data, &frame);
+        }
+        else {
+            // Whatever the PSP's controls do, the port stays at rest
+            SceCtrlData2 frame = *second_data;
+            frame.timeStamp = rest.timeStamp;
+            mismatches += !same_frame(&rest, &frame);
+        }
+    }
+
+    CHECK_EQ(mismatches, 0);
+
+    // One sample per cycle, whichever port was polled first, and the other port reused it
+    CHECK_EQ(g_pad_sample_stats.samples - samples, SCRIPT_POLLS);
+    CHECK_EQ(g_pad_sample_stats.shared - shared, second->psp_input ? SCRIPT_POLLS : 0);
+
+    sim_ctrl_set_pad(0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    sim_run_for(10 * SIM_VBLANK_PERIOD);
+    free(script);
+}
+
+// Input injected into one port doesn't reach the other.
+static
+void check_injection(u8 port, u8 other)
+{
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+
+    frame.buttons = SCE_CTRL_TRIANGLE;
+    frame.rX = 0x10;
+    CHECK_EQ(emuCtrlSetInputFrame(port, &frame), SCE_ERROR_OK);
+    sim_run_for(2 * SIM_VBLANK_PERIOD);
+
+    CHECK(sim_ctrl_port_data(port)->buttons & SCE_CTRL_TRIANGLE);
+    CHECK_EQ(sim_ctrl_port_data(port)->rX, 0x10);
+    CHECK((sim_ctrl_port_data(other)->buttons & SCE_CTRL_TRIANGLE) == 0);
+    CHECK(sim_ctrl_port_data(other)->rX != 0x10);
+
+    frame = (SceCtrlData2)INPUT_CHANNEL_NEUTRAL_FRAME;
+    CHECK_EQ(emuCtrlSetInputFrame(port, &frame), SCE_ERROR_OK);
+    sim_run_for(2 * SIM_VBLANK_PERIOD);
+    CHECK((sim_ctrl_port_data(port)->buttons & SCE_CTRL_TRIANGLE) == 0);
+}
+
+int main(void)
+{
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    // Each port has its own handler and source, and both are passed through
+    void *ds3_source = NULL, *second_source = NULL;
+    CHECK(sim_ctrl_port_handler(SCE_CTRL_PORT_DS3, &ds3_source) != NULL);
+    CHECK(sim_ctrl_port_handler(SCE_CTRL_PORT_UNKNOWN_2, &second_source) != NULL);
+    CHECK(ds3_source == emulated_port(SCE_CTRL_PORT_DS3));
+    CHECK(second_source == emulated_port(SCE_CTRL_PORT_UNKNOWN_2));
+#if INJECTION_BACKEND == INJECTION_BACKEND_PORT_HANDLER
+    CHECK_EQ(sim_ctrl_passthrough_mask(), CONTROLLER_PORTS);
+#endif
+
+    check_script(SIM_CTRL_HANDLERS_FIRST);
+    check_script(SIM_CTRL_MERGE_FIRST);
+
+    check_injection(SCE_CTRL_PORT_DS3, SCE_CTRL_PORT_UNKNOWN_2);
+    check_injection(SCE_CTRL_PORT_UNKNOWN_2, SCE_CTRL_PORT_DS3);
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+
+    // Both ports are gone again
+    CHECK(sim_ctrl_port_handler(SCE_CTRL_PORT_DS3, &ds3_source) == NULL);
+    CHECK(sim_ctrl_port_handler(SCE_CTRL_PORT_UNKNOWN_2, &second_source) == NULL);
+    CHECK_EQ(sim_ctrl_passthrough_mask(), 0);
+    CHECK_EQ(sim_context_violations(), 0);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,217 @@
+// PSP-EmulatedControllerTest host build
+// Checks the pressure fields of the port output against the byte layout documented in ctrl_imports.h, read
+// from 0 as pressure.h explains: each button in byte 1 or 3 of its field, nothing in the others.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+#include "plugin.c"
+
+#include "sim.h"
+#include "test.h"
+
+#define TEST_PORT (SCE_CTRL_PORT_DS3)
+
+#define SENSE_FIELD_COUNT (6)
+
+// Where ctrl_imports.h documents the pressure of each button.
+typedef struct {
+    u32 button;
+    const char *name;
+    u32 field;
+    u32 byte;
+} SenseLayout;
+
+static const SenseLayout g_layouts[] = {
+    { SCE_CTRL_RIGHT, "right", 0, 1 },
+    { SCE_CTRL_LEFT, "left", 0, 3 },
+    { SCE_CTRL_UP, "up", 1, 1 },
+    { SCE_CTRL_DOWN, "down", 1, 3 },
+    { SCE_CTRL_TRIANGLE, "triangle", 2, 1 },
+    { SCE_CTRL_CIRCLE, "circle", 2, 3 },
+    { SCE_CTRL_CROSS, "cross", 3, 1 },
+    { SCE_CTRL_SQUARE, "square", 3, 3 },
+    { SCE_CTRL_L1TRIGGER, "L1", 4, 1 },
+    { SCE_CTRL_R1TRIGGER, "R1", 4, 3 },
+    { SCE_CTRL_LTRIGGER, "L2", 5, 1 },
+    { SCE_CTRL_RTRIGGER, "R2", 5, 3 },
+};
+
+#define LAYOUT_COUNT (sizeof(g_layouts) / sizeof(g_layouts[0]))
+
+// The pressure fields in the order of the layouts above.
+static
+u32 sense_field(const SceCtrlData2 *data, u32 field)
+{
+    const s32 fields[SENSE_FIELD_COUNT] = {
+        data->DPadSenseA, data->DPadSenseB, data->GPadSenseA, data->GPadSenseB, data->AxisSenseA, data->AxisSenseB,
+    };
+
+    return (u32)fields[field];
+}
+
+static
+u8 sense_byte(const SceCtrlData2 *data, u32 field, u32 byte)
+{
+    return (u8)(sense_field(data, field) >> (8 * byte));
+}
+
+static
+void poll_with(u32 buttons)
+{
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+
+    frame.buttons = buttons;
+    emuCtrlSetInputFrame(TEST_PORT, &frame);
+    sim_run_for(SIM_VBLANK_PERIOD);
+}
+
+// Checks the port output reports pressure only in the bytes of the layouts in mask, each with its pressure.
+static
+void check_fields(const char *what, u32 mask, const u8 *pressures)
+{
+    const SceCtrlData2 *data = sim_ctrl_port_data(TEST_PORT);
+    u32 expected[SENSE_FIELD_COUNT] = { 0 };
+
+    for(u32 i = 0; i < LAYOUT_COUNT; i++) {
+        if(mask & (1u << i)) {
+            expected[g_layouts[i].field] |= (u32)pressures[i] << (8 * g_layouts[i].byte);
+        }
+    }
+
+    for(u32 field = 0; field < SENSE_FIELD_COUNT; field++) {
+        if(sense_field(data, field) != expected[field]) {
+            fprintf(stderr, "pressure: %s gave 0x%08x in field %u, expected 0x%08x\n", what,
+                sense_field(data, field), field, expected[field]);
+            g_test_failures++;
+        }
+    }
+}
+
+// Each button on its own, held long enough to ramp all the way up.
+static
+void test_button_layouts(void)
+{
+    for(u32 i = 0; i < LAYOUT_COUNT; i++) {
+        const SenseLayout *layout = &g_layouts[i];
+        u8 pressures[LAYOUT_COUNT] = { 0 };
+        bool dpad = i < 4;
+        u32 expected = dpad ? 255 : BUTTON_PRESSURE_RAMP_START;
+
+        for(u32 poll = 0; poll < 10; poll++) {
+            poll_with(layout->button);
+
+            // Injected D-pad directions have no stick deflection behind them, so they report full pressure
+            pressures[i] = (u8)expected;
+            check_fields(layout->name, 1u << i, pressures);
+            CHECK_EQ(sense_byte(sim_ctrl_port_data(TEST_PORT), layout->field, layout->byte), expected);
+
+            expected = expected + BUTTON_PRESSURE_RAMP_STEP > 255 ? 255 : expected + BUTTON_PRESSURE_RAMP_STEP;
+        }
+
+        poll_with(0);
+        check_fields("release", 0, pressures);
+    }
+}
+
+// Both buttons of every field at once, each lane ramping on its own.
+static
+void test_shared_fields(void)
+{
+    u8 pressures[LAYOUT_COUNT] = { 0 };
+    u32 all = 0;
+    u32 mask = 0;
+
+    for(u32 i = 0; i < LAYOUT_COUNT; i++) {
+        all |= g_layouts[i].button;
+        mask |= 1u << i;
+    }
+
+    // Cross first, then everything
+    poll_with(SCE_CTRL_CROSS);
+    poll_with(SCE_CTRL_CROSS);
+    poll_with(all);
+
+    for(u32 i = 0; i < LAYOUT_COUNT; i++) {
+        pressures[i] = i < 4 ? 255 : BUTTON_PRESSURE_RAMP_START;
+    }
+    pressures[6] = BUTTON_PRESSURE_RAMP_START + 2 * BUTTON_PRESSURE_RAMP_STEP;
+    check_fields("all buttons", mask, pressures);
+
+    poll_with(0);
+}
+
+// D-pad directions from the PSP stick follow its deflection.
+static
+void test_stick_directions(void)
+{
+    static const struct {
+        u8 lx;
+        u8 ly;
+        u32 layout;
+        u8 value;
+    } moves[] = {
+        { 0xFF, 0x80, 0, 0xFF },
+        { 0x80 + 90, 0x80, 0, 0x80 + 90 },
+        { 0x00, 0x80, 1, 0x00 },
+        { 0x80, 0x00, 2, 0x00 },
+        { 0x80, 0x80 - 100, 2, 0x80 - 100 },
+        { 0x80, 0xFF, 3, 0xFF },
+    };
+
+    for(u32 i = 0; i < sizeof(moves) / sizeof(moves[0]); i++) {
+        u8 pressures[LAYOUT_COUNT] = { 0 };
+
+        sim_ctrl_set_pad(0, moves[i].lx, moves[i].ly);
+        poll_with(0);
+        poll_with(0);
+
+        pressures[moves[i].layout] = g_dpad_pressure_lut[moves[i].value];
+        check_fields(g_layouts[moves[i].layout].name, 1u << moves[i].layout, pressures);
+    }
+
+    CHECK_EQ(g_dpad_pressure_lut[0xFF], 255);
+    CHECK_EQ(g_dpad_pressure_lut[0x00], 255);
+
+    sim_ctrl_set_pad(0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    poll_with(0);
+    poll_with(0);
+    check_fields("centered stick", 0, NULL);
+}
+
+// Pressure an injected frame already gives is passed on as it is.
+static
+void test_injected_pressure(void)
+{
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+
+    frame.buttons = SCE_CTRL_CROSS | SCE_CTRL_TRIANGLE;
+    frame.GPadSenseB = 0x00400000;
+    emuCtrlSetInputFrame(TEST_PORT, &frame);
+    sim_run_for(SIM_VBLANK_PERIOD);
+
+    const SceCtrlData2 *data = sim_ctrl_port_data(TEST_PORT);
+    CHECK_EQ((u32)data->GPadSenseB, 0x00400000);
+    CHECK_EQ(sense_byte(data, 2, 1), BUTTON_PRESSURE_RAMP_START);
+
+    poll_with(0);
+}
+
+int main(void)
+{
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    test_button_layouts();
+    test_shared_fields();
+    test_stick_directions();
+    test_injected_pressure();
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+    CHECK_EQ(sim_context_violations(), 0);
+
+    return TEST_RESULT();
+}
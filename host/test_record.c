@@ -0,0 +1,225 @@
+// PSP-EmulatedControllerTest host build
+// Checks input recording against a fake Memory Stick of different speeds: an instant one, a realistic one, and
+// one that stalls each write for longer than the recording ring lasts. The port is polled at the full rate
+// throughout, every poll's frame is either in the trace or counted as dropped, the trace is written in whole
+// chunks, and the controller callback never touches file I/O or blocks. Also times the callback before the
+// recording, and during it once the ring is full and overflowing, which only the stalled writes make it, to show
+// the hot path stays flat however slow the writes are.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#undef INPUT_TRACE_MODE
+#define INPUT_TRACE_MODE INPUT_TRACE_MODE_RECORD
+
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Long enough with a moving stick to fill a few chunks.
+#define RECORD_SECONDS (240)
+
+// Fewer than the ring holds, so timing the callback on an empty ring doesn't overflow it.
+#define TIMED_CALLS (200)
+
+typedef struct {
+    const char *name;
+    // Per write, see sim_io_set_throttle().
+    u32 latency;
+    u32 bytes_per_second;
+    // Whether the writes are slow enough that frames have to be dropped.
+    bool drops;
+} StorageCase;
+
+// A new stick position every poll, so every frame takes a few bytes of the trace.
+static
+SimPadEvent *make_script(u32 count)
+{
+    SimPadEvent *events = malloc(sizeof(SimPadEvent) * count);
+    u32 seed = 0xBADC0DE;
+
+    for(u32 i = 0; i < count; i++) {
+        u32 random = bench_random(&seed);
+        events[i].time = (u64)i * SIM_VBLANK_PERIOD;
+        events[i].buttons = 0;
+        events[i].lx = (u8)random;
+        events[i].ly = (u8)(random >> 8);
+    }
+
+    return events;
+}
+
+// The p50 and p99 of the callback's time, called directly the way the driver would, in ns.
+static
+void time_callback(u64 *p50, u64 *p99)
+{
+    static u64 timings[TIMED_CALLS];
+    const SceCtrlInputDataTransferHandler *handler;
+    void *source;
+    BenchResult result;
+    u32 io_calls = sim_io_calls();
+    u32 seed = 99;
+
+    handler = sim_ctrl_port_handler(INPUT_TRACE_PORT, &source);
+    CHECK(handler != NULL);
+    if(handler == NULL) {
+        return;
+    }
+
+    u64 overhead = bench_timer_overhead_ns();
+    for(u32 i = 0; i < TIMED_CALLS; i++) {
+        u32 random = bench_random(&seed);
+        sim_advance_clock(SIM_VBLANK_PERIOD);
+        sim_ctrl_set_pad(0, (u8)random, (u8)(random >> 8));
+        sim_ctrl_take_sample();
+
+        // As the driver hands it over
+        SceCtrlData2 out = INPUT_CHANNEL_NEUTRAL_FRAME;
+        out.timeStamp = (u32)sim_now();
+
+        u64 start = bench_now_ns();
+        handler->copyInputData(source, &out);
+        u64 elapsed = bench_now_ns() - start;
+        timings[i] = elapsed > overhead ? elapsed - overhead : 0;
+    }
+
+    // The frames recorded above are now waiting in the ring, and no call did any I/O
+    CHECK_EQ(sim_io_calls(), io_calls);
+
+    bench_summarize(timings, TIMED_CALLS, &result);
+    *p50 = result.p50_ns;
+    *p99 = result.p99_ns;
+}
+
+static
+void run_storage_case(const StorageCase *storage)
+{
+    u32 count = RECORD_SECONDS * 60;
+    SimPadEvent *script = make_script(count);
+    u64 empty_p50 = 0, empty_p99 = 0, full_p50 = 0, full_p99 = 0;
+
+    sim_kernel_init();
+    sim_ctrl_init();
+    sim_io_set_throttle(storage->latency, storage->bytes_per_second);
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    // With the ring drained
+    CHECK_EQ(g_record_ring.tail - g_record_ring.head, 0);
+    time_callback(&empty_p50, &empty_p99);
+
+    // Time the callback again as soon as the ring is full, or at the end if it never fills
+    u32 polls = sim_ctrl_port_polls(INPUT_TRACE_PORT);
+    u32 timed_drops = 0;
+    bool timed = false;
+    sim_ctrl_play(script, count);
+    for(u32 i = 0; i < count; i++) {
+        sim_run_for(SIM_VBLANK_PERIOD);
+
+        if(!timed && (g_record_ring.tail - g_record_ring.head == RECORD_RING_LENGTH || i == count - 1)) {
+            u32 overflows = g_record_ring.overflows;
+            time_callback(&full_p50, &full_p99);
+            timed_drops = g_record_ring.overflows - overflows;
+            timed = true;
+        }
+    }
+    u32 rate = (sim_ctrl_port_polls(INPUT_TRACE_PORT) - polls) / RECORD_SECONDS;
+    u32 dropped = g_record_ring.overflows - timed_drops;
+
+    // Only writes that stall fill the ring
+    if(storage->drops) {
+        CHECK(dropped > 0);
+        CHECK_EQ(timed_drops, TIMED_CALLS);
+    }
+    else {
+        CHECK_EQ(dropped, 0);
+    }
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+    sim_io_set_throttle(0, 0);
+
+    // Every poll's frame was recorded or counted as dropped, including the ones timed above
+    u32 len;
+    const u8 *trace = sim_file_get(INPUT_TRACE_PATH, &len);
+    InputTraceDecoder decoder;
+    SceCtrlData2 frame;
+    u32 pos = INPUT_TRACE_HEADER_SIZE;
+    u32 decoded = 0;
+    s32 result = INPUT_TRACE_NEED_MORE;
+
+    // The frames of an idle run after its first take no bytes, so decode until the decoder asks for more
+    CHECK(trace != NULL);
+    input_trace_decoder_init(&decoder);
+    while(trace != NULL) {
+        result = input_trace_decode(&decoder, trace + pos, len - pos, &frame);
+        if(result < 0) {
+            break;
+        }
+        pos += result;
+        decoded++;
+    }
+
+    CHECK_EQ(result, INPUT_TRACE_NEED_MORE);
+    CHECK_EQ(pos, len);
+    CHECK_EQ(decoded + g_record_ring.overflows, sim_ctrl_port_polls(INPUT_TRACE_PORT) + 2 * TIMED_CALLS);
+
+    // One write per whole chunk, and one for the rest
+    CHECK_EQ(sim_io_calls(), (len + INPUT_TRACE_CHUNK_SIZE - 1) / INPUT_TRACE_CHUNK_SIZE);
+
+    // The polls never waited for the writes
+    CHECK(rate + 1 >= 1000000 / SIM_VBLANK_PERIOD);
+    CHECK_EQ(sim_context_violations(), 0);
+
+    printf("%-13s %8u %9u %9u %8u %10llu %10llu %10llu %10llu\n", storage->name, rate, decoded, dropped, len,
+        (unsigned long long)empty_p50, (unsigned long long)empty_p99, (unsigned long long)full_p50,
+        (unsigned long long)full_p99);
+
+    free(script);
+}
+
+// Runs a case in a process of its own, since the plugin's state doesn't survive a module stop and start.
+static
+void run_isolated(const StorageCase *storage)
+{
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if(pid == 0) {
+        run_storage_case(storage);
+        fflush(stdout);
+        _exit(TEST_RESULT());
+    }
+
+    int status = 0;
+    if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        g_test_failures++;
+    }
+}
+
+int main(void)
+{
+    static const StorageCase storages[] = {
+        { "instant", 0, 0, false },
+        { "memory stick", 20 * ONE_MSEC, 2 * 1024 * 1024, false },
+        // Each write takes longer than the ring's 256 frames last
+        { "stalled", 6000 * ONE_MSEC, 0, true },
+    };
+
+    printf("Input recording over %us of polls, callback ns with the ring empty and full\n", RECORD_SECONDS);
+    printf("%-13s %8s %9s %9s %8s %10s %10s %10s %10s\n", "storage", "polls/s", "recorded", "dropped", "bytes",
+        "empty p50", "empty p99", "full p50", "full p99");
+
+    for(u32 i = 0; i < sizeof(storages) / sizeof(storages[0]); i++) {
+        run_isolated(&storages[i]);
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,264 @@
+// PSP-EmulatedControllerTest host build
+// Checks input replay against a trace recorded by the plugin itself. Built with TEST_REPLAY_RECORD, it records a
+// session of random PSP input with INPUT_TRACE_MODE_RECORD and saves the trace to the file given on the command
+// line. Built for replay, it replays that file with INPUT_TRACE_MODE_REPLAY and checks:
+// * every poll of the replay outputs the trace frame due at it, in order, one frame per poll
+// * with --stalled, where each read of the trace stalls for longer than the two replay buffers last, that the
+//   underrun counter goes up while the buffers run dry, the output holds a frame back meanwhile, and the replay
+//   never goes back or past the frame due
+// * once the last frame has been replayed, the replay finishes and the live input drives the port again
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#undef INPUT_TRACE_MODE
+#ifdef TEST_REPLAY_RECORD
+#define INPUT_TRACE_MODE INPUT_TRACE_MODE_RECORD
+#else
+#define INPUT_TRACE_MODE INPUT_TRACE_MODE_REPLAY
+#endif
+
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Long enough with a moving stick for the trace to take a few chunks, so the replay reads it in several goes.
+#define RECORD_POLLS (12000)
+
+// Each read of the trace takes longer than the 2 * REPLAY_BUFFER_LENGTH frames of the replay buffers last.
+#define STALLED_READ_LATENCY (6000 * ONE_MSEC)
+
+#ifdef TEST_REPLAY_RECORD
+
+// A new stick position and buttons every poll, with a stretch at rest every so often for the idle runs.
+static
+SimPadEvent *make_script(u32 count)
+{
+    SimPadEvent *events = malloc(sizeof(SimPadEvent) * count);
+    u32 seed = 0x7E91A7;
+
+    for(u32 i = 0; i < count; i++) {
+        u32 random = bench_random(&seed);
+        bool rest = i % 500 >= 400;
+
+        events[i].time = (u64)i * SIM_VBLANK_PERIOD;
+        events[i].buttons = rest ? 0 : random & (SCE_CTRL_CROSS | SCE_CTRL_CIRCLE | SCE_CTRL_LTRIGGER);
+        events[i].lx = rest ? SCE_CTRL_ANALOG_PAD_CENTER_VALUE : (u8)(random >> 8);
+        events[i].ly = rest ? SCE_CTRL_ANALOG_PAD_CENTER_VALUE : (u8)(random >> 16);
+    }
+
+    return events;
+}
+
+int main(int argc, char **argv)
+{
+    SimPadEvent *script = make_script(RECORD_POLLS);
+
+    if(argc != 2) {
+        fprintf(stderr, "Usage: %s <trace>\n", argv[0]);
+        return 1;
+    }
+
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_ctrl_play(script, RECORD_POLLS);
+    sim_run_for((u64)RECORD_POLLS * SIM_VBLANK_PERIOD);
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+
+    CHECK_EQ(g_record_ring.overflows, 0);
+    CHECK_EQ(sim_context_violations(), 0);
+
+    u32 len;
+    const u8 *trace = sim_file_get(INPUT_TRACE_PATH, &len);
+    FILE *file = fopen(argv[1], "wb");
+    CHECK(trace != NULL && len > 2 * INPUT_TRACE_CHUNK_SIZE);
+    CHECK(file != NULL);
+    if(trace != NULL && file != NULL) {
+        CHECK_EQ(fwrite(trace, 1, len, file), len);
+    }
+    if(file != NULL) {
+        fclose(file);
+    }
+
+    printf("Recorded %u polls in %u bytes\n", sim_ctrl_port_polls(INPUT_TRACE_PORT), len);
+
+    free(script);
+    return TEST_RESULT();
+}
+
+#else
+
+// Reads the whole file. Returns NULL if it can't be read.
+static
+u8 *read_file(const char *path, u32 *len)
+{
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    u8 *data = malloc(size > 0 ? size : 1);
+    if(size <= 0 || fread(data, 1, size, file) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+    *len = (u32)size;
+    return data;
+}
+
+// Decodes every frame of the trace. Returns the number of frames.
+static
+u32 decode_trace(const u8 *trace, u32 len, SceCtrlData2 *frames, u32 max_frames)
+{
+    InputTraceDecoder decoder;
+    u32 pos = INPUT_TRACE_HEADER_SIZE;
+    u32 count = 0;
+
+    input_trace_decoder_init(&decoder);
+    while(count < max_frames) {
+        s32 result = input_trace_decode(&decoder, trace + pos, len - pos, &frames[count]);
+        if(result < 0) {
+            CHECK_EQ(result, INPUT_TRACE_NEED_MORE);
+            break;
+        }
+        pos += result;
+        count++;
+    }
+
+    CHECK_EQ(pos, len);
+    return count;
+}
+
+// True if the port output is the trace frame, apart from the timestamp, which is the poll's.
+static
+bool same_frame(const SceCtrlData2 *output, const SceCtrlData2 *frame)
+{
+    SceCtrlData2 expected = *frame;
+
+    expected.timeStamp = output->timeStamp;
+    return memcmp(output, &expected, sizeof(expected)) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    bool stalled = argc == 3 && strcmp(argv[2], "--stalled") == 0;
+
+    if(argc < 2) {
+        fprintf(stderr, "Usage: %s <trace> [--stalled]\n", argv[0]);
+        return 1;
+    }
+
+    u32 len = 0;
+    u8 *trace = read_file(argv[1], &len);
+    CHECK(trace != NULL);
+    if(trace == NULL) {
+        return TEST_RESULT();
+    }
+
+    // The recording starts with the module, a little before the script
+    SceCtrlData2 *frames = malloc(sizeof(SceCtrlData2) * 2 * RECORD_POLLS);
+    u32 count = decode_trace(trace, len, frames, 2 * RECORD_POLLS);
+    CHECK(count >= RECORD_POLLS);
+
+    sim_kernel_init();
+    sim_ctrl_init();
+    sim_file_set(INPUT_TRACE_PATH, trace, len);
+    if(stalled) {
+        sim_io_set_throttle(STALLED_READ_LATENCY, 0);
+    }
+
+    // The live input the port goes back to once the replay finishes
+    sim_ctrl_set_pad(0, 0x00, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+
+    // Poll by poll, the index of the trace frame the port output is, against the index of the frame due
+    u32 polls = 0;
+    u32 replayed = 0;
+    u32 held = 0;
+    u32 misplaced = 0;
+    u32 index = 0;
+    u32 start = 0;
+    u32 limit = count + (stalled ? 20 * STALLED_READ_LATENCY / SIM_VBLANK_PERIOD : 1000);
+
+    while(!g_replay.finished && polls < limit) {
+        sim_run_for(SIM_VBLANK_PERIOD);
+        polls++;
+
+        if(!g_replay.started) {
+            continue;
+        }
+
+        if(replayed++ == 0) {
+            start = polls;
+        }
+
+        // The frame due at this poll, and the newest the output may be after an underrun held it back
+        u32 due = polls - start;
+        const SceCtrlData2 *output = sim_ctrl_port_data(INPUT_TRACE_PORT);
+        // Consecutive frames can be the same, so look from the due frame back
+        u32 found = due < count ? due : count - 1;
+        while(found > index && !same_frame(output, &frames[found])) {
+            found--;
+        }
+
+        if(!same_frame(output, &frames[found])) {
+            if(misplaced++ == 0) {
+                fprintf(stderr, "Poll %u of the replay: the output isn't a trace frame up to the one due\n", due);
+            }
+        }
+        else {
+            held += found != due;
+            index = found;
+        }
+    }
+
+    CHECK(g_replay.finished);
+    CHECK(g_replay.end_of_trace);
+    CHECK_EQ(misplaced, 0);
+
+    // The last poll of the replay replayed the last frame. Without underruns that is one poll per frame, with
+    // them the polls that ran dry after the last frame was due come on top
+    CHECK_EQ(index, count - 1);
+    if(stalled) {
+        CHECK(g_replay.underruns > 0);
+        CHECK(held > 0);
+        CHECK(replayed >= count);
+    }
+    else {
+        CHECK_EQ(g_replay.underruns, 0);
+        CHECK_EQ(held, 0);
+        CHECK_EQ(replayed, count);
+    }
+
+    // The live stick drives the D-pad again from the next poll on
+    sim_run_for(SIM_VBLANK_PERIOD);
+    CHECK(sim_ctrl_port_data(INPUT_TRACE_PORT)->buttons & SCE_CTRL_LEFT);
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+    sim_io_set_throttle(0, 0);
+    CHECK_EQ(sim_context_violations(), 0);
+
+    printf("Replayed %u frames in %u polls, %u underruns, %u polls held a frame back\n", count, replayed,
+        g_replay.underruns, held);
+
+    free(frames);
+    free(trace);
+    return TEST_RESULT();
+}
+
+#endif
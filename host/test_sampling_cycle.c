@@ -0,0 +1,266 @@
+// PSP-EmulatedControllerTest host build
+// Runs each sampling cycle policy on the ctrl driver model, checks the cycle it picks while there is input,
+// once input stops and after module stop, and reports the handler call rate and the latency from a PSP stick
+// move to the stick driven D-pad direction showing in the peeked sample.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+// A different policy for each kind of app, picked with sim_set_key_config()
+#undef SAMPLING_CYCLE_POLICY_VSH
+#undef SAMPLING_CYCLE_POLICY_GAME
+#undef SAMPLING_CYCLE_POLICY_POPS
+#undef SAMPLING_CYCLE_MANAGED
+#define SAMPLING_CYCLE_POLICY_VSH SAMPLING_CYCLE_POLICY_POWER_SAVING
+#define SAMPLING_CYCLE_POLICY_GAME SAMPLING_CYCLE_POLICY_LOW_LATENCY
+#define SAMPLING_CYCLE_POLICY_POPS SAMPLING_CYCLE_POLICY_APP
+#define SAMPLING_CYCLE_MANAGED (1)
+
+#include "plugin.c"
+
+#include "sim.h"
+#include "test.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define TEST_PORT (SCE_CTRL_PORT_DS3)
+
+// Stick moves timed at these offsets into a sampling cycle, so the latencies cover every phase.
+#define LATENCY_TRIALS (8)
+
+typedef struct {
+    u32 button;
+    // The time the stick moved, and when the direction first showed in a sample. 0 while waiting.
+    u64 moved;
+    u64 seen;
+} LatencyProbe;
+
+static
+void probe_sample(void *context, const SceCtrlData *sample)
+{
+    LatencyProbe *probe = context;
+
+    if(probe->moved != 0 && probe->seen == 0 && (sample->buttons & probe->button)) {
+        probe->seen = sim_now();
+    }
+}
+
+// Moves the PSP stick to lx, ly, and returns how long the direction took to reach the peeked sample.
+static
+u64 measure_move(u8 lx, u8 ly, u32 button)
+{
+    LatencyProbe probe = { button, 0, 0 };
+
+    sim_ctrl_set_sample_hook(probe_sample, &probe);
+    sim_ctrl_set_pad(0, lx, ly);
+    probe.moved = sim_ctrl_pad_changed();
+    sim_run_for(200 * ONE_MSEC);
+    sim_ctrl_set_sample_hook(NULL, NULL);
+
+    CHECK(probe.seen != 0);
+    return probe.seen - probe.moved;
+}
+
+// The polls per second over the next second.
+static
+u32 poll_rate(void)
+{
+    u32 polls = sim_ctrl_port_polls(TEST_PORT);
+    sim_run_for(1000 * ONE_MSEC);
+    return sim_ctrl_port_polls(TEST_PORT) - polls;
+}
+
+static
+void center_stick(void)
+{
+    sim_ctrl_set_pad(0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+}
+
+typedef struct {
+    const char *name;
+    int key_config;
+    // The cycles the policy should settle on, 0 being VBlank-synced.
+    u32 active_cycle;
+    u32 idle_cycle;
+} PolicyCase;
+
+static
+void run_policy(const PolicyCase *policy)
+{
+    u64 idle_total = 0, idle_max = 0, active_total = 0, active_max = 0;
+    u32 cycle;
+
+    sim_kernel_init();
+    sim_ctrl_init();
+    sim_set_key_config(policy->key_config);
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    // Idle long enough for the idle cycle
+    sim_run_for(SAMPLING_CYCLE_IDLE_TIMEOUT + SAMPLING_CYCLE_CHECK_PERIOD);
+    sceCtrlGetSamplingCycle(&cycle);
+    CHECK_EQ(cycle, policy->idle_cycle);
+    u32 idle_rate = poll_rate();
+
+    // From idle, the first move is seen at the idle cycle
+    for(u32 i = 0; i < LATENCY_TRIALS; i++) {
+        sim_run_for(SAMPLING_CYCLE_IDLE_TIMEOUT + SAMPLING_CYCLE_CHECK_PERIOD + i * 2087);
+        u64 latency = measure_move(0xFF, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_RIGHT);
+        idle_total += latency;
+        idle_max = latency > idle_max ? latency : idle_max;
+        center_stick();
+    }
+
+    // Keep the stick moving, so there is input on every check
+    sim_ctrl_set_pad(0, 0xFF, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    sim_run_for(2 * SAMPLING_CYCLE_CHECK_PERIOD);
+    sceCtrlGetSamplingCycle(&cycle);
+    CHECK_EQ(cycle, policy->active_cycle);
+    u32 active_rate = poll_rate();
+
+    for(u32 i = 0; i < LATENCY_TRIALS; i++) {
+        sim_run_for(i * 701);
+        u8 lx = i % 2 == 0 ? 0x00 : 0xFF;
+        u64 latency = measure_move(lx, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, i % 2 == 0 ? SCE_CTRL_LEFT : SCE_CTRL_RIGHT);
+        active_total += latency;
+        active_max = latency > active_max ? latency : active_max;
+    }
+
+    // The app's cycle comes back on stop, even mid way through an active stretch
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+    sceCtrlGetSamplingCycle(&cycle);
+    CHECK_EQ(cycle, 0);
+    CHECK_EQ(sim_context_violations(), 0);
+
+    printf("%-13s %9u %11u %14.1f %10.1f %16.1f %12.1f\n", policy->name, idle_rate, active_rate,
+        idle_total / 1000.0 / LATENCY_TRIALS, idle_max / 1000.0,
+        active_total / 1000.0 / LATENCY_TRIALS, active_max / 1000.0);
+
+    // The call rate follows the cycle
+    u32 expected_idle = 1000000 / (policy->idle_cycle != 0 ? policy->idle_cycle : SIM_VBLANK_PERIOD);
+    u32 expected_active = 1000000 / (policy->active_cycle != 0 ? policy->active_cycle : SIM_VBLANK_PERIOD);
+    CHECK(idle_rate + 1 >= expected_idle && idle_rate <= expected_idle + 1);
+    CHECK(active_rate + 1 >= expected_active && active_rate <= expected_active + 1);
+
+    // The callback reads the stick from the previous cycle's sample, so a move shows on the poll after next
+    u32 idle_period = policy->idle_cycle != 0 ? policy->idle_cycle : SIM_VBLANK_PERIOD;
+    u32 active_period = policy->active_cycle != 0 ? policy->active_cycle : SIM_VBLANK_PERIOD;
+    CHECK(idle_max <= 2 * idle_period);
+    CHECK(active_max <= 2 * active_period);
+}
+
+// The app setting a cycle of its own while the policy is managing it.
+static
+void test_app_cycle_change(void)
+{
+    u32 cycle;
+
+    sim_kernel_init();
+    sim_ctrl_init();
+    sim_set_key_config(PSP_INIT_KEYCONFIG_VSH);
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    sceCtrlSetSamplingCycle(10000);
+    sim_ctrl_set_pad(0, 0xFF, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    sim_run_for(2 * SAMPLING_CYCLE_CHECK_PERIOD);
+    sceCtrlGetSamplingCycle(&cycle);
+    CHECK_EQ(cycle, 10000);
+
+    // Idle drops to the slow cycle, and stop goes back to the app's new cycle
+    center_stick();
+    sim_run_for(SAMPLING_CYCLE_IDLE_TIMEOUT + 2 * SAMPLING_CYCLE_CHECK_PERIOD);
+    sceCtrlGetSamplingCycle(&cycle);
+    CHECK_EQ(cycle, SAMPLING_CYCLE_SLOW);
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+    sceCtrlGetSamplingCycle(&cycle);
+    CHECK_EQ(cycle, 10000);
+}
+
+// Injected input counts as input, even when it only lasts a single poll between two checks.
+static
+void test_injected_input(void)
+{
+    u32 cycle;
+
+    sim_kernel_init();
+    sim_ctrl_init();
+    sim_set_key_config(PSP_INIT_KEYCONFIG_GAME);
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(SAMPLING_CYCLE_IDLE_TIMEOUT + 2 * SAMPLING_CYCLE_CHECK_PERIOD);
+
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+    frame.buttons = SCE_CTRL_CROSS;
+    CHECK_EQ(emuCtrlSubmitFrames(TEST_PORT, &frame, 1), 1);
+    sim_run_for(SAMPLING_CYCLE_CHECK_PERIOD + SIM_VBLANK_PERIOD);
+
+    sceCtrlGetSamplingCycle(&cycle);
+    CHECK_EQ(cycle, SAMPLING_CYCLE_FAST);
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+}
+
+// Runs a test in a process of its own, since the plugin's state doesn't survive a module stop and start.
+static
+void run_isolated(void (*test)(const void *), const void *argument)
+{
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if(pid == 0) {
+        test(argument);
+        fflush(stdout);
+        _exit(TEST_RESULT());
+    }
+
+    int status = 0;
+    if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        g_test_failures++;
+    }
+}
+
+static
+void run_policy_test(const void *policy)
+{
+    run_policy(policy);
+}
+
+static
+void run_app_cycle_change_test(const void *unused)
+{
+    test_app_cycle_change();
+}
+
+static
+void run_injected_input_test(const void *unused)
+{
+    test_injected_input();
+}
+
+int main(void)
+{
+    static const PolicyCase policies[] = {
+        { "app", PSP_INIT_KEYCONFIG_POPS, 0, 0 },
+        { "low latency", PSP_INIT_KEYCONFIG_GAME, SAMPLING_CYCLE_FAST, 0 },
+        { "power saving", PSP_INIT_KEYCONFIG_VSH, 0, SAMPLING_CYCLE_SLOW },
+    };
+
+    printf("Sampling cycle policies, polls per second and PSP stick to peeked sample latency in ms\n");
+    printf("%-13s %9s %11s %14s %10s %16s %12s\n", "policy", "idle rate", "active rate",
+        "idle latency", "idle max", "active latency", "active max");
+
+    for(u32 i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        run_isolated(run_policy_test, &policies[i]);
+    }
+
+    run_isolated(run_app_cycle_change_test, NULL);
+    run_isolated(run_injected_input_test, NULL);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,161 @@
+// PSP-EmulatedControllerTest host build
+// Runs the plugin on the ctrl driver model: module start and port registration, injected and scripted
+// input reaching the peeked samples, a long run at a fixed sampling cycle, and module stop.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+#include "plugin.c"
+
+#include "sim.h"
+#include "test.h"
+
+#include <time.h>
+
+#define TEST_PORT (SCE_CTRL_PORT_DS3)
+
+typedef struct {
+    u32 samples;
+    u32 with_triangle;
+    u32 with_cross;
+    // The first sample to show each button
+    u64 first_triangle;
+    u64 first_cross;
+} SampleLog;
+
+static
+void log_sample(void *context, const SceCtrlData *sample)
+{
+    SampleLog *log = context;
+
+    log->samples++;
+    if(sample->buttons & SCE_CTRL_TRIANGLE) {
+        if(log->with_triangle++ == 0) {
+            log->first_triangle = sim_now();
+        }
+    }
+    if(sample->buttons & SCE_CTRL_CROSS) {
+        if(log->with_cross++ == 0) {
+            log->first_cross = sim_now();
+        }
+    }
+}
+
+static
+void test_registration(void)
+{
+    void *source = NULL;
+
+    CHECK(sim_ctrl_port_handler(TEST_PORT, &source) != NULL);
+    CHECK(source == &g_ports[TEST_PORT - 1]);
+    CHECK(sim_ctrl_passthrough_mask() & CONTROLLER_PORT_BIT(TEST_PORT));
+}
+
+static
+void test_polling_rate(void)
+{
+    u32 polls = sim_ctrl_port_polls(TEST_PORT);
+
+    // VBlank-synced by default, about 60 polls a second
+    sim_run_for(1000 * ONE_MSEC);
+
+    u32 delta = sim_ctrl_port_polls(TEST_PORT) - polls;
+    CHECK(delta >= 59 && delta <= 61);
+}
+
+static
+void test_injected_input(void)
+{
+    SampleLog log = { 0 };
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+
+    sim_ctrl_set_sample_hook(log_sample, &log);
+
+    frame.buttons = SCE_CTRL_TRIANGLE;
+    u64 injected = sim_now();
+    CHECK_EQ(emuCtrlSetInputFrame(TEST_PORT, &frame), SCE_ERROR_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    // Passed through on the next cycle's sample
+    CHECK(log.with_triangle > 0);
+    CHECK(log.first_triangle - injected <= SIM_VBLANK_PERIOD);
+    CHECK_EQ(sim_ctrl_port_data(TEST_PORT)->buttons & SCE_CTRL_TRIANGLE, SCE_CTRL_TRIANGLE);
+
+    frame.buttons = 0;
+    CHECK_EQ(emuCtrlSetInputFrame(TEST_PORT, &frame), SCE_ERROR_OK);
+    sim_run_for(2 * SIM_VBLANK_PERIOD);
+    log.with_triangle = 0;
+    sim_run_for(100 * ONE_MSEC);
+    CHECK_EQ(log.with_triangle, 0);
+
+    sim_ctrl_set_sample_hook(NULL, NULL);
+}
+
+static
+void test_scripted_input(void)
+{
+    static const SimPadEvent script[] = {
+        { 100 * ONE_MSEC, SCE_CTRL_CROSS, 0x80, 0x80 },
+        { 200 * ONE_MSEC, 0, 0x80, 0x80 },
+    };
+    SampleLog log = { 0 };
+
+    sim_ctrl_set_sample_hook(log_sample, &log);
+    u64 start = sim_now();
+    sim_ctrl_play(script, 2);
+    sim_run_for(300 * ONE_MSEC);
+
+    CHECK(log.first_cross >= start + 100 * ONE_MSEC);
+    CHECK(log.first_cross < start + 100 * ONE_MSEC + SIM_VBLANK_PERIOD);
+    // 100ms held is 5 or 6 VBlanks
+    CHECK(log.with_cross >= 5 && log.with_cross <= 7);
+    CHECK_EQ(sim_ctrl_port_data(TEST_PORT)->buttons & SCE_CTRL_CROSS, 0);
+
+    sim_ctrl_set_sample_hook(NULL, NULL);
+}
+
+static
+void test_long_run(void)
+{
+    const u64 duration = 3600ull * 1000 * ONE_MSEC;
+    u32 polls = sim_ctrl_port_polls(TEST_PORT);
+    struct timespec start, end;
+
+    CHECK(sceCtrlSetSamplingCycle(5555) >= 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sim_run_for(duration);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    u32 delta = sim_ctrl_port_polls(TEST_PORT) - polls;
+    CHECK(delta >= duration / 5555 - 1 && delta <= duration / 5555 + 1);
+
+    double wall_ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    printf("Simulated an hour at a 5555us cycle, %u polls, in %.1f ms\n", delta, wall_ms);
+
+    CHECK(sceCtrlSetSamplingCycle(0) >= 0);
+}
+
+int main(void)
+{
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    test_registration();
+    test_polling_rate();
+    test_injected_input();
+    test_scripted_input();
+    test_long_run();
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+
+    void *source;
+    CHECK(sim_ctrl_port_handler(TEST_PORT, &source) == NULL);
+    CHECK_EQ(sim_ctrl_passthrough_mask(), 0);
+    CHECK_EQ(sim_context_violations(), 0);
+
+    return TEST_RESULT();
+}
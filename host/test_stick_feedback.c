@@ -0,0 +1,159 @@
+// PSP-EmulatedControllerTest host build
+// Checks the port output stays steady while a stick is held, in both orders of the port polls and the slot
+// merge. The driver merges the output left stick back over the PSP stick the callback reads, which mustn't
+// feed back into the port output: a held PSP stick gives the same curved sticks and D-pad every poll, and a
+// held injected left stick never drives the D-pad, with the PSP stick centered or not.
+//
+// Built a second time with TEST_LEFT_STICK_CURVE, to check module_start() refuses a curve on the left stick.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#ifdef TEST_LEFT_STICK_CURVE
+#undef AXIS_CURVE_AX
+#define AXIS_CURVE_AX { .type = AXIS_CURVE_EXPONENTIAL }
+#endif
+
+#include "plugin.c"
+
+#include "sim.h"
+#include "test.h"
+
+#define TEST_PORT (SCE_CTRL_PORT_DS3)
+
+// Polls to let a change reach the port output and the peeked sample, whichever the order.
+#define SETTLE_POLLS (3)
+// Polls the output is held for.
+#define HOLD_POLLS (20)
+
+#define DIRECTION_BUTTONS (SCE_CTRL_UP | SCE_CTRL_RIGHT | SCE_CTRL_DOWN | SCE_CTRL_LEFT)
+
+static
+SceCtrlData peek(void)
+{
+    SceCtrlData sample;
+
+    CHECK_EQ(sceCtrlPeekBufferPositive(&sample, 1), 1);
+    return sample;
+}
+
+static
+void inject_left_stick(u8 ax, u8 ay)
+{
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+
+    frame.aX = ax;
+    frame.aY = ay;
+    CHECK_EQ(emuCtrlSetInputFrame(TEST_PORT, &frame), SCE_ERROR_OK);
+}
+
+// Runs HOLD_POLLS polls after the input settled, and checks every one gives the same port output and sample.
+// Returns the port output.
+static
+SceCtrlData2 hold(const char *name)
+{
+    sim_run_for(SETTLE_POLLS * SIM_VBLANK_PERIOD);
+
+    SceCtrlData2 first = *sim_ctrl_port_data(TEST_PORT);
+    SceCtrlData first_sample = peek();
+    u32 changes = 0;
+
+    for(u32 i = 0; i < HOLD_POLLS; i++) {
+        sim_run_for(SIM_VBLANK_PERIOD);
+
+        const SceCtrlData2 *data = sim_ctrl_port_data(TEST_PORT);
+        SceCtrlData sample = peek();
+
+        if((data->buttons != first.buttons || load_stick_word(&data->aX) != load_stick_word(&first.aX)
+                || sample.buttons != first_sample.buttons || sample.aX != first_sample.aX
+                || sample.aY != first_sample.aY) && changes++ == 0) {
+            fprintf(stderr, "%s: poll %u: buttons 0x%08x, sticks 0x%08x, sample aX 0x%02x, expected 0x%08x, "
+                "0x%08x, 0x%02x\n", name, i, data->buttons, load_stick_word(&data->aX), sample.aX, first.buttons,
+                load_stick_word(&first.aX), first_sample.aX);
+        }
+    }
+
+    CHECK_EQ(changes, 0);
+    return first;
+}
+
+// A PSP stick held off center drives the right stick through its curve and the D-pad, the same every poll.
+static
+void test_held_pad_stick(void)
+{
+    sim_ctrl_set_pad(0, 0xC8, 0x30);
+    SceCtrlData2 output = hold("held PSP stick");
+
+    CHECK_EQ(output.buttons & DIRECTION_BUTTONS, SCE_CTRL_RIGHT | SCE_CTRL_UP);
+    CHECK_EQ(output.aX, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    CHECK_EQ(output.aY, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    CHECK_EQ(output.rX, g_axis_curve_tables.lut[EMULATED_AXIS_RX][0xC8]);
+    CHECK_EQ(output.rY, g_axis_curve_tables.lut[EMULATED_AXIS_RY][0x30]);
+    CHECK_EQ(peek().aX, 0xC8);
+
+    sim_ctrl_set_pad(0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    output = hold("released PSP stick");
+    CHECK_EQ(output.buttons, 0);
+}
+
+// An injected left stick shows in the sample, but never comes back as a D-pad direction.
+static
+void test_held_injected_stick(void)
+{
+    inject_left_stick(0xFF, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    SceCtrlData2 output = hold("injected stick");
+
+    CHECK_EQ(output.buttons, 0);
+    CHECK_EQ(output.aX, 0xFF);
+    CHECK_EQ(peek().aX, 0xFF);
+
+    // With the PSP stick off center too, it is hidden behind the injected stick and taken as centered
+    sim_ctrl_set_pad(0, 0x00, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    output = hold("injected stick over PSP stick");
+
+    CHECK_EQ(output.buttons, 0);
+    CHECK_EQ(output.aX, 0xFF);
+    CHECK_EQ(output.rX, g_axis_curve_tables.lut[EMULATED_AXIS_RX][SCE_CTRL_ANALOG_PAD_CENTER_VALUE]);
+
+    // Once the injected stick is centered, the PSP stick drives the port again
+    inject_left_stick(SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    output = hold("PSP stick after injected stick");
+
+    CHECK_EQ(output.buttons & DIRECTION_BUTTONS, SCE_CTRL_LEFT);
+    CHECK_EQ(output.aX, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    CHECK_EQ(output.rX, g_axis_curve_tables.lut[EMULATED_AXIS_RX][0x00]);
+    CHECK_EQ(peek().aX, 0x00);
+
+    sim_ctrl_set_pad(0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE, SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+    hold("released PSP stick");
+}
+
+int main(void)
+{
+    sim_kernel_init();
+    sim_ctrl_init();
+
+#ifdef TEST_LEFT_STICK_CURVE
+    // The curve would be applied to the port's own stick, merged back into the sample
+    CHECK_EQ(module_start(0, NULL), MODULE_ERROR);
+#else
+    static const SimCtrlOrder orders[] = { SIM_CTRL_HANDLERS_FIRST, SIM_CTRL_MERGE_FIRST };
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    for(u32 i = 0; i < sizeof(orders) / sizeof(orders[0]); i++) {
+        sim_ctrl_set_order(orders[i]);
+
+        test_held_pad_stick();
+        test_held_injected_stick();
+    }
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+#endif
+
+    CHECK_EQ(sim_context_violations(), 0);
+
+    return TEST_RESULT();
+}
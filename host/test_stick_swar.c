@@ -0,0 +1,235 @@
+// PSP-EmulatedControllerTest host build
+// Differential test of the stick word path against the scalar code it replaces, one axis at a time:
+// * the center error margin mask against axis_is_centered(), for every value of every byte of the word
+// * the injected stick merge against merge_injected_axis()
+// * the stick words of the curve tables against the per-axis tables, for every PSP stick position, with a
+//   different curve on every axis
+// * the sticks of the port output, poll by poll over random PSP stick positions and injected sticks, against
+//   the curves and the merge worked out per axis. The left stick curves are centered here, as module_start()
+//   requires, and the right stick ones differ
+//
+// Built with STICK_SWAR, and a second time with TEST_STICK_SCALAR, so both paths are held to the same reference.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#undef AXIS_CURVE_RX
+#undef AXIS_CURVE_RY
+#define AXIS_CURVE_RX { .type = AXIS_CURVE_LINEAR, .invert = true, .inner_deadzone = 20 }
+#define AXIS_CURVE_RY { .type = AXIS_CURVE_CUSTOM, .point_count = 2, .points = { { 64, 32 }, { 192, 224 } } }
+
+#ifdef TEST_STICK_SCALAR
+#undef STICK_SWAR
+#define STICK_SWAR (0)
+#endif
+
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+#include "test.h"
+
+#define TEST_PORT (SCE_CTRL_PORT_DS3)
+
+#define RANDOM_WORDS (1000000)
+#define TEST_POLLS (20000)
+
+// The margin mask of the word, worked out a byte at a time.
+static
+u32 scalar_outside_margin(u32 sticks)
+{
+    u32 mask = 0;
+
+    for(u32 byte = 0; byte < 4; byte++) {
+        if(!axis_is_centered((u8)(sticks >> (8 * byte)))) {
+            mask |= 0xFFu << (8 * byte);
+        }
+    }
+
+    return mask;
+}
+
+static
+u32 scalar_merge(u32 translated, u32 injected)
+{
+    u32 merged = 0;
+
+    for(u32 byte = 0; byte < 4; byte++) {
+        merged |= (u32)merge_injected_axis((u8)(translated >> (8 * byte)), (u8)(injected >> (8 * byte))) << (8 * byte);
+    }
+
+    return merged;
+}
+
+static
+void test_margin_mask(void)
+{
+    u32 seed = 0x600D;
+    u32 failures = 0;
+
+    // Every value of each byte, with random bytes around it
+    for(u32 byte = 0; byte < 4; byte++) {
+        for(u32 value = 0; value < 256; value++) {
+            u32 sticks = (bench_random(&seed) & ~(0xFFu << (8 * byte))) | value << (8 * byte);
+            failures += stick_word_outside_margin(sticks) != scalar_outside_margin(sticks);
+        }
+    }
+
+    for(u32 i = 0; i < RANDOM_WORDS; i++) {
+        u32 sticks = bench_random(&seed);
+        failures += stick_word_outside_margin(sticks) != scalar_outside_margin(sticks);
+    }
+
+    // Both ends of the margin, on every byte at once
+    u32 inside = (SCE_CTRL_ANALOG_PAD_CENTER_VALUE - CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN) * 0x01010101u;
+    CHECK_EQ(stick_word_outside_margin(inside), 0);
+    CHECK_EQ(stick_word_outside_margin(inside - 0x01010101u), 0xFFFFFFFF);
+    inside = (SCE_CTRL_ANALOG_PAD_CENTER_VALUE + CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN) * 0x01010101u;
+    CHECK_EQ(stick_word_outside_margin(inside), 0);
+    CHECK_EQ(stick_word_outside_margin(inside + 0x01010101u), 0xFFFFFFFF);
+
+    CHECK_EQ(failures, 0);
+}
+
+static
+void test_merge(void)
+{
+    u32 seed = 0xFACE;
+    u32 failures = 0;
+
+    for(u32 i = 0; i < RANDOM_WORDS; i++) {
+        u32 translated = bench_random(&seed);
+        u32 injected = bench_random(&seed);
+
+        // Half the injected bytes near the center, where the merge has to pick the translated byte
+        injected = (injected & 0x80808080u) ? injected : (injected & 0x1F1F1F1Fu) + 0x70707070u;
+        failures += merge_injected_sticks(translated, injected) != scalar_merge(translated, injected);
+    }
+
+    CHECK_EQ(failures, 0);
+}
+
+// Left stick curves the plugin refuses to run with, but which the tables still have to build right.
+static const AxisCurve g_test_curves[EMULATED_AXIS_COUNT] = {
+    [EMULATED_AXIS_AX] = { .type = AXIS_CURVE_EXPONENTIAL, .inner_deadzone = 10, .outer_deadzone = 8 },
+    [EMULATED_AXIS_AY] = { .type = AXIS_CURVE_S_CURVE, .invert = true },
+    [EMULATED_AXIS_RX] = AXIS_CURVE_RX,
+    [EMULATED_AXIS_RY] = AXIS_CURVE_RY,
+};
+
+static AxisCurveTables g_test_curve_tables;
+
+static
+void test_curve_words(void)
+{
+    const AxisCurveTables *tables = &g_test_curve_tables;
+    u32 failures = 0;
+
+    axis_curves_build(&g_test_curve_tables, g_test_curves);
+
+    for(u32 x = 0; x < 256; x++) {
+        for(u32 y = 0; y < 256; y++) {
+            u32 sticks = tables->x_words[x] | tables->y_words[y];
+
+            failures += (u8)(sticks >> STICK_WORD_AX_SHIFT) != tables->lut[EMULATED_AXIS_AX][x];
+            failures += (u8)(sticks >> STICK_WORD_AY_SHIFT) != tables->lut[EMULATED_AXIS_AY][y];
+            failures += (u8)(sticks >> STICK_WORD_RX_SHIFT) != tables->lut[EMULATED_AXIS_RX][x];
+            failures += (u8)(sticks >> STICK_WORD_RY_SHIFT) != tables->lut[EMULATED_AXIS_RY][y];
+        }
+    }
+
+    CHECK_EQ(failures, 0);
+}
+
+// A random axis, within the center error margin half the time.
+static
+u8 random_axis(u32 *seed)
+{
+    u32 random = bench_random(seed);
+
+    if(random & 1) {
+        return (u8)(SCE_CTRL_ANALOG_PAD_CENTER_VALUE - CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN
+            + (random >> 1) % (2 * CTRL_ANALOG_PAD_CENTER_POS_ERROR_MARGIN + 1));
+    }
+    return (u8)(random >> 8);
+}
+
+// Keeps the last sample the driver published, which is the one the callback reads in SIM_CTRL_MERGE_FIRST order.
+// It isn't always the PSP stick as set: the left stick of the port output is passed through and merged back in,
+// and the callback then takes the PSP stick as centered.
+static
+void keep_sample(void *context, const SceCtrlData *sample)
+{
+    *(SceCtrlData *)context = *sample;
+}
+
+static
+void test_port_output(void)
+{
+    u32 seed = 0x5717;
+    u32 failures = 0;
+    SceCtrlData sample;
+    bool output_stick_merged = false;
+
+    sim_ctrl_set_sample_hook(keep_sample, &sample);
+
+    for(u32 i = 0; i < TEST_POLLS; i++) {
+        u8 lx = random_axis(&seed);
+        u8 ly = random_axis(&seed);
+        SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+
+        // Every few polls nothing is injected, so the idle polls are covered too
+        if(i % 4 != 0) {
+            frame.aX = random_axis(&seed);
+            frame.aY = random_axis(&seed);
+            frame.rX = random_axis(&seed);
+            frame.rY = random_axis(&seed);
+        }
+
+        sim_ctrl_set_pad(0, lx, ly);
+        emuCtrlSetInputFrame(TEST_PORT, &frame);
+        sim_run_for(SIM_VBLANK_PERIOD);
+
+        const SceCtrlData2 *data = sim_ctrl_port_data(TEST_PORT);
+        const u8 output[EMULATED_AXIS_COUNT] = { data->aX, data->aY, data->rX, data->rY };
+        const u8 injected[EMULATED_AXIS_COUNT] = { frame.aX, frame.aY, frame.rX, frame.rY };
+        u8 pad_x = output_stick_merged ? SCE_CTRL_ANALOG_PAD_CENTER_VALUE : sample.aX;
+        u8 pad_y = output_stick_merged ? SCE_CTRL_ANALOG_PAD_CENTER_VALUE : sample.aY;
+        const u8 pad[EMULATED_AXIS_COUNT] = { pad_x, pad_y, pad_x, pad_y };
+
+        for(u32 axis = 0; axis < EMULATED_AXIS_COUNT; axis++) {
+            u8 expected = merge_injected_axis(g_axis_curve_tables.lut[axis][pad[axis]], injected[axis]);
+
+            if(output[axis] != expected && failures++ == 0) {
+                fprintf(stderr, "stick: poll %u, axis %u: 0x%02x, expected 0x%02x\n", i, axis, output[axis], expected);
+            }
+        }
+
+        output_stick_merged = !axis_is_centered(data->aX) || !axis_is_centered(data->aY);
+    }
+
+    sim_ctrl_set_sample_hook(NULL, NULL);
+    CHECK_EQ(failures, 0);
+}
+
+int main(void)
+{
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    // So each poll sees the PSP sample of its own cycle
+    sim_ctrl_set_order(SIM_CTRL_MERGE_FIRST);
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    test_margin_mask();
+    test_merge();
+    test_curve_words();
+    test_port_output();
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+
+    return TEST_RESULT();
+}
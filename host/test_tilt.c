@@ -0,0 +1,203 @@
+// PSP-EmulatedControllerTest host build
+// Checks the step response of the tilt filter on the port output, poll by poll, against the same cascade of
+// low-pass stages computed in floating point: the tilt follows it to within one count, rises without
+// overshooting, settles when the reference does, and comes back to exactly 0 on release. Also checks that
+// injected tilt takes precedence over the synthesized tilt.
+//
+// Built with TILT_SOURCE_BUTTONS, and a second time with TEST_TILT_STICK for TILT_SOURCE_STICK with a single
+// filter stage.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#undef TILT_SOURCE
+#undef TILT_FILTER_ORDER
+#ifdef TEST_TILT_STICK
+#define TILT_SOURCE TILT_SOURCE_STICK
+#define TILT_FILTER_ORDER (1)
+#else
+#define TILT_SOURCE TILT_SOURCE_BUTTONS
+#define TILT_FILTER_ORDER (2)
+#endif
+
+#include "plugin.c"
+
+#include "sim.h"
+#include "test.h"
+
+#include <math.h>
+
+#define TEST_PORT (SCE_CTRL_PORT_DS3)
+
+// Long enough for any step to settle with the default shift.
+#define STEP_POLLS (64)
+
+// The floating point filter the fixed point one approximates.
+typedef struct {
+    double stage[TILT_FILTER_ORDER];
+} ReferenceFilter;
+
+static
+double reference_step(ReferenceFilter *filter, double input)
+{
+    for(u32 i = 0; i < TILT_FILTER_ORDER; i++) {
+        filter->stage[i] += (input - filter->stage[i]) / (1 << TILT_FILTER_SHIFT);
+        input = filter->stage[i];
+    }
+
+    return input;
+}
+
+// Tilts the PSP fully right and up from the configured source, or lets it go.
+static
+void set_tilt(bool tilted)
+{
+#if TILT_SOURCE == TILT_SOURCE_STICK
+    sim_ctrl_set_pad(0, tilted ? 0xFF : SCE_CTRL_ANALOG_PAD_CENTER_VALUE,
+        tilted ? 0x00 : SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+#else
+    sim_ctrl_set_pad(tilted ? TILT_BUTTON_RIGHT | TILT_BUTTON_UP : 0, SCE_CTRL_ANALOG_PAD_CENTER_VALUE,
+        SCE_CTRL_ANALOG_PAD_CENTER_VALUE);
+#endif
+}
+
+// The tilt set_tilt(true) aims for on each axis.
+static
+void full_tilt(double target[2])
+{
+#if TILT_SOURCE == TILT_SOURCE_STICK
+    target[0] = (double)(0xFF - SCE_CTRL_ANALOG_PAD_CENTER_VALUE) * TILT_FULL_SCALE / 128;
+    target[1] = (double)(0x00 - SCE_CTRL_ANALOG_PAD_CENTER_VALUE) * TILT_FULL_SCALE / 128;
+#else
+    target[0] = TILT_FULL_SCALE;
+    target[1] = -TILT_FULL_SCALE;
+#endif
+}
+
+// Polls the port until the tilt has stepped from 0 to the targets or back, checking every poll.
+static
+void check_step(const char *name, const double from[2], const double to[2])
+{
+    ReferenceFilter reference[2];
+    s32 last[2] = { (s32)lround(from[0]), (s32)lround(from[1]) };
+    u32 settled_poll[2] = { 0, 0 };
+
+    for(u32 axis = 0; axis < 2; axis++) {
+        for(u32 i = 0; i < TILT_FILTER_ORDER; i++) {
+            reference[axis].stage[i] = from[axis];
+        }
+    }
+
+    for(u32 poll = 1; poll <= STEP_POLLS; poll++) {
+        sim_run_for(SIM_VBLANK_PERIOD);
+
+        const SceCtrlData2 *data = sim_ctrl_port_data(TEST_PORT);
+        s32 tilt[2] = { data->TiltA, data->TiltB };
+
+        for(u32 axis = 0; axis < 2; axis++) {
+            double expected = reference_step(&reference[axis], to[axis]);
+            bool rising = to[axis] > from[axis];
+
+            if(fabs(tilt[axis] - expected) > 1.0) {
+                fprintf(stderr, "tilt: %s, poll %u, axis %u: %d, the reference %.2f\n", name, poll, axis,
+                    tilt[axis], expected);
+                g_test_failures++;
+            }
+
+            // Only ever towards the target, and never past it
+            CHECK(rising ? tilt[axis] >= last[axis] : tilt[axis] <= last[axis]);
+            CHECK(rising ? tilt[axis] <= lround(to[axis]) : tilt[axis] >= lround(to[axis]));
+            last[axis] = tilt[axis];
+
+            if(settled_poll[axis] == 0 && fabs(expected - to[axis]) < 0.5) {
+                settled_poll[axis] = poll;
+            }
+            if(settled_poll[axis] != 0 && poll > settled_poll[axis]) {
+                CHECK_EQ(tilt[axis], lround(to[axis]));
+            }
+        }
+    }
+
+    CHECK(settled_poll[0] != 0 && settled_poll[1] != 0);
+    printf("%-8s settles in %u polls (x), %u polls (y)\n", name, settled_poll[0], settled_poll[1]);
+}
+
+static
+void test_step_response(void)
+{
+    const double rest[2] = { 0, 0 };
+    double target[2];
+
+    full_tilt(target);
+
+    set_tilt(true);
+    check_step("tilt", rest, target);
+
+    set_tilt(false);
+    check_step("release", target, rest);
+
+    // The fractions of the stages take a few more polls than the output to come all the way back to rest
+    EmulatedPort *port = emulated_port(TEST_PORT);
+    for(u32 poll = 0; poll < STEP_POLLS && !tilt_filter_settled(&port->tilt_state); poll++) {
+        sim_run_for(SIM_VBLANK_PERIOD);
+        CHECK_EQ(sim_ctrl_port_data(TEST_PORT)->TiltA, 0);
+        CHECK_EQ(sim_ctrl_port_data(TEST_PORT)->TiltB, 0);
+    }
+    CHECK(tilt_filter_settled(&port->tilt_state));
+
+    // Which lets the idle fast path take over
+    sim_run_for(SIM_VBLANK_PERIOD);
+#if IDLE_FAST_PATH
+    CHECK(port->idle_settled);
+#endif
+}
+
+// Injected tilt is reported as it is, on its own axis only.
+static
+void test_injected_tilt(void)
+{
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+    double target[2];
+
+    full_tilt(target);
+    frame.TiltA = -100;
+    emuCtrlSetInputFrame(TEST_PORT, &frame);
+
+    set_tilt(true);
+    for(u32 poll = 0; poll < STEP_POLLS; poll++) {
+        sim_run_for(SIM_VBLANK_PERIOD);
+        CHECK_EQ(sim_ctrl_port_data(TEST_PORT)->TiltA, -100);
+    }
+    CHECK_EQ(sim_ctrl_port_data(TEST_PORT)->TiltB, lround(target[1]));
+
+    frame.TiltA = 0;
+    emuCtrlSetInputFrame(TEST_PORT, &frame);
+    set_tilt(false);
+    sim_run_for(STEP_POLLS * SIM_VBLANK_PERIOD);
+    CHECK_EQ(sim_ctrl_port_data(TEST_PORT)->TiltA, 0);
+    CHECK_EQ(sim_ctrl_port_data(TEST_PORT)->TiltB, 0);
+}
+
+int main(void)
+{
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    // So each poll sees the sample of its own cycle, and a step shows on the first poll after it
+    sim_ctrl_set_order(SIM_CTRL_MERGE_FIRST);
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    CHECK_EQ(sim_ctrl_port_data(TEST_PORT)->TiltA, 0);
+    CHECK_EQ(sim_ctrl_port_data(TEST_PORT)->TiltB, 0);
+
+    test_step_response();
+    test_injected_tilt();
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+    CHECK_EQ(sim_context_violations(), 0);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,325 @@
+// PSP-EmulatedControllerTest host build
+// Checks the input trace codec: round trips of frames with jittered poll timestamps, decoding a stream that
+// arrives a byte at a time, the errors for truncated and corrupt records, and a recording made by the plugin.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+
+#undef INPUT_TRACE_MODE
+#define INPUT_TRACE_MODE INPUT_TRACE_MODE_RECORD
+
+#include "plugin.c"
+
+#include "bench.h"
+#include "sim.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_FRAMES (4000)
+#define TEST_BUFFER_SIZE (TEST_FRAMES * INPUT_TRACE_MAX_ENCODE_SIZE)
+
+// Fills frames with polls a VBlank apart, give or take up to jitter microseconds, that go through idle
+// stretches, button presses, stick moves and changes of the other fields.
+static
+void make_frames(SceCtrlData2 *frames, u32 count, u32 jitter)
+{
+    u32 seed = 0x2468ACE1;
+    u32 time = 1000000;
+
+    memset(frames, 0, sizeof(SceCtrlData2) * count);
+
+    for(u32 i = 0; i < count; i++) {
+        SceCtrlData2 *frame = &frames[i];
+        u32 random = bench_random(&seed);
+
+        if(i > 0) {
+            *frame = frames[i - 1];
+        }
+        else {
+            frame->aX = frame->aY = frame->rX = frame->rY = SCE_CTRL_ANALOG_PAD_CENTER_VALUE;
+        }
+
+        time += SIM_VBLANK_PERIOD;
+        frame->timeStamp = time + bench_random(&seed) % (2 * jitter + 1) - jitter;
+
+        // Mostly idle, with a change every 16 polls or so
+        switch((random >> 16) % 64) {
+        case 0:
+        case 1:
+            frame->buttons ^= 1u << ((random >> 24) % 24);
+            break;
+        case 2:
+            frame->aX = (u8)(random >> 8);
+            frame->aY = (u8)(random >> 24);
+            break;
+        case 3:
+            frame->DPadSenseA += (s32)((random >> 8) & 0xFF) - 128;
+            frame->TiltB -= (s32)(random >> 20);
+            break;
+        case 4:
+            frame->rsrv[(random >> 8) & 3] ^= 0x5A;
+            break;
+        case 5:
+            // A late poll, too far off the previous delta to be part of an idle run
+            frame->timeStamp += 2 * INPUT_TRACE_MAX_JITTER + 1;
+            time = frame->timeStamp;
+            break;
+        }
+    }
+}
+
+// Encodes frames into out, header and all. Returns the size of the trace.
+static
+u32 encode_frames(const SceCtrlData2 *frames, u32 count, u8 *out)
+{
+    InputTraceEncoder encoder;
+    u32 n = INPUT_TRACE_HEADER_SIZE;
+
+    input_trace_write_header(out);
+    input_trace_encoder_init(&encoder);
+
+    for(u32 i = 0; i < count; i++) {
+        u32 written = input_trace_encode(&encoder, &frames[i], out + n);
+        CHECK(written <= INPUT_TRACE_MAX_ENCODE_SIZE);
+        n += written;
+    }
+
+    return n + input_trace_encode_flush(&encoder, out + n);
+}
+
+// Decodes the trace in in, checking it gives back frames. With trickle set the decoder only sees one more
+// byte of the trace each time it asks for more, so every record is cut short at every point on the way.
+static
+void check_decode(const u8 *in, u32 len, const SceCtrlData2 *frames, u32 count, bool trickle)
+{
+    InputTraceDecoder decoder;
+    SceCtrlData2 frame;
+    u32 pos = INPUT_TRACE_HEADER_SIZE;
+    u32 available = trickle ? pos : len;
+    u32 decoded = 0;
+
+    CHECK(input_trace_check_header(in));
+    input_trace_decoder_init(&decoder);
+
+    for(;;) {
+        s32 result = input_trace_decode(&decoder, in + pos, available - pos, &frame);
+
+        if(result == INPUT_TRACE_NEED_MORE) {
+            if(available == len) {
+                break;
+            }
+            available++;
+            continue;
+        }
+
+        if(result < 0 || decoded >= count) {
+            fprintf(stderr, "trace: decode gave %d after %u frames\n", result, decoded);
+            g_test_failures++;
+            return;
+        }
+
+        if(memcmp(&frame, &frames[decoded], sizeof(frame)) != 0) {
+            fprintf(stderr, "trace: frame %u decoded with timestamp %u, expected %u\n", decoded,
+                frame.timeStamp, frames[decoded].timeStamp);
+            g_test_failures++;
+            return;
+        }
+
+        pos += result;
+        decoded++;
+    }
+
+    CHECK_EQ(decoded, count);
+    CHECK_EQ(pos, len);
+}
+
+static
+void test_round_trip(void)
+{
+    SceCtrlData2 *frames = malloc(sizeof(SceCtrlData2) * TEST_FRAMES);
+    u8 *trace = malloc(TEST_BUFFER_SIZE);
+
+    static const u32 jitters[] = { 0, 1, 20, INPUT_TRACE_MAX_JITTER };
+    for(u32 i = 0; i < sizeof(jitters) / sizeof(jitters[0]); i++) {
+        make_frames(frames, TEST_FRAMES, jitters[i]);
+        u32 len = encode_frames(frames, TEST_FRAMES, trace);
+
+        check_decode(trace, len, frames, TEST_FRAMES, false);
+        check_decode(trace, len, frames, TEST_FRAMES, true);
+
+        // Jitter doesn't break up the idle runs: about a byte per idle frame at most
+        printf("Jitter %2u us: %u frames in %u bytes\n", jitters[i], TEST_FRAMES, len);
+        CHECK(len < TEST_FRAMES * 4);
+    }
+
+    free(frames);
+    free(trace);
+}
+
+// The idle stretches of real polls, a few microseconds either side of the VBlank period.
+static
+void test_jittered_idle(void)
+{
+    SceCtrlData2 frames[200];
+    u8 trace[INPUT_TRACE_HEADER_SIZE + 200 * INPUT_TRACE_MAX_ENCODE_SIZE];
+    u32 seed = 99;
+
+    memset(frames, 0, sizeof(frames));
+    for(u32 i = 0; i < 200; i++) {
+        frames[i].timeStamp = 1000000 + i * SIM_VBLANK_PERIOD + bench_random(&seed) % 9;
+    }
+
+    u32 len = encode_frames(frames, 200, trace);
+    check_decode(trace, len, frames, 200, true);
+
+    // The first frame and delta are whole records, the other 198 frames are a byte each, plus a header
+    // and count per run of INPUT_TRACE_MAX_JITTERED_RUN
+    u32 runs = (198 + INPUT_TRACE_MAX_JITTERED_RUN - 1) / INPUT_TRACE_MAX_JITTERED_RUN;
+    CHECK(len <= INPUT_TRACE_HEADER_SIZE + 2 * 5 + 198 + 2 * runs);
+
+    // Evenly spaced polls still make a single exact run
+    for(u32 i = 0; i < 200; i++) {
+        frames[i].timeStamp = 1000000 + i * SIM_VBLANK_PERIOD;
+    }
+    len = encode_frames(frames, 200, trace);
+    check_decode(trace, len, frames, 200, false);
+    CHECK(len <= INPUT_TRACE_HEADER_SIZE + 2 * 5 + 3);
+}
+
+// Decodes a single record after a frame with all zero fields and a VBlank long delta.
+static
+s32 decode_record(const u8 *record, u32 len)
+{
+    static const u8 first[] = { INPUT_TRACE_FIELD_FRAME, 0xAB, 0x82, 0x01 };
+    InputTraceDecoder decoder;
+    SceCtrlData2 frame;
+
+    input_trace_decoder_init(&decoder);
+    CHECK_EQ(input_trace_decode(&decoder, first, sizeof(first), &frame), sizeof(first));
+    CHECK_EQ(frame.timeStamp, SIM_VBLANK_PERIOD);
+
+    return input_trace_decode(&decoder, record, len, &frame);
+}
+
+static
+void test_errors(void)
+{
+    InputTraceDecoder decoder;
+    SceCtrlData2 frame;
+
+    // An overlong varint is corrupt wherever it is, once five bytes of it are there
+    static const u8 long_delta[] = { INPUT_TRACE_FIELD_FRAME, 0x80, 0x80, 0x80, 0x80, 0x80 };
+    CHECK_EQ(decode_record(long_delta, sizeof(long_delta)), INPUT_TRACE_CORRUPT);
+    CHECK_EQ(decode_record(long_delta, sizeof(long_delta) - 1), INPUT_TRACE_NEED_MORE);
+
+    static const u8 long_buttons[] = { INPUT_TRACE_FIELD_FRAME | INPUT_TRACE_FIELD_BUTTONS, 0x01,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+    CHECK_EQ(decode_record(long_buttons, sizeof(long_buttons)), INPUT_TRACE_CORRUPT);
+    CHECK_EQ(decode_record(long_buttons, 6), INPUT_TRACE_NEED_MORE);
+
+    static const u8 long_sense_a[] = { INPUT_TRACE_FIELD_FRAME | INPUT_TRACE_FIELD_DPAD_SENSE, 0x01,
+        0x80, 0x80, 0x80, 0x80, 0x80, 0x00 };
+    CHECK_EQ(decode_record(long_sense_a, sizeof(long_sense_a)), INPUT_TRACE_CORRUPT);
+
+    static const u8 long_sense_b[] = { INPUT_TRACE_FIELD_FRAME | INPUT_TRACE_FIELD_TILT, 0x01, 0x02,
+        0x80, 0x80, 0x80, 0x80, 0x80 };
+    CHECK_EQ(decode_record(long_sense_b, sizeof(long_sense_b)), INPUT_TRACE_CORRUPT);
+    CHECK_EQ(decode_record(long_sense_b, sizeof(long_sense_b) - 1), INPUT_TRACE_NEED_MORE);
+
+    static const u8 long_count[] = { INPUT_TRACE_IDLE_RUN, 0x80, 0x80, 0x80, 0x80, 0x80 };
+    CHECK_EQ(decode_record(long_count, sizeof(long_count)), INPUT_TRACE_CORRUPT);
+
+    static const u8 long_residual[] = { INPUT_TRACE_JITTERED_RUN, 0x01, 0x80, 0x80, 0x80, 0x80, 0x80 };
+    CHECK_EQ(decode_record(long_residual, sizeof(long_residual)), INPUT_TRACE_CORRUPT);
+    CHECK_EQ(decode_record(long_residual, sizeof(long_residual) - 1), INPUT_TRACE_NEED_MORE);
+
+    // Cut short within the fixed size fields
+    static const u8 short_sticks[] = { INPUT_TRACE_FIELD_FRAME | INPUT_TRACE_FIELD_STICKS, 0x01, 0x80, 0x80, 0x80 };
+    CHECK_EQ(decode_record(short_sticks, sizeof(short_sticks)), INPUT_TRACE_NEED_MORE);
+
+    // Runs of no frames, header values that are neither a frame nor a run
+    static const u8 empty_run[] = { INPUT_TRACE_JITTERED_RUN, 0x00 };
+    CHECK_EQ(decode_record(empty_run, sizeof(empty_run)), INPUT_TRACE_CORRUPT);
+    static const u8 unknown[] = { 0x04, 0x01 };
+    CHECK_EQ(decode_record(unknown, sizeof(unknown)), INPUT_TRACE_CORRUPT);
+
+    // A run with no frame before it to repeat
+    static const u8 run[] = { INPUT_TRACE_IDLE_RUN, 0x01 };
+    input_trace_decoder_init(&decoder);
+    CHECK_EQ(input_trace_decode(&decoder, run, sizeof(run), &frame), INPUT_TRACE_CORRUPT);
+}
+
+typedef struct {
+    SceCtrlData2 *frames;
+    u32 count;
+    u32 polls;
+} FrameLog;
+
+// Keeps the port's output from each poll, which is what the plugin records.
+static
+void log_frame(void *context, const SceCtrlData *sample)
+{
+    FrameLog *log = context;
+    u32 polls = sim_ctrl_port_polls(INPUT_TRACE_PORT);
+
+    if(polls != log->polls && log->count < TEST_FRAMES) {
+        log->frames[log->count++] = *sim_ctrl_port_data(INPUT_TRACE_PORT);
+    }
+    log->polls = polls;
+}
+
+static
+void test_recording(void)
+{
+    static const SimPadEvent script[] = {
+        { 200 * ONE_MSEC, 0, 0xFF, 0x80 },
+        { 400 * ONE_MSEC, 0, 0x80, 0x00 },
+        { 600 * ONE_MSEC, 0, 0x80, 0x80 },
+        { 900 * ONE_MSEC, 0, 0x10, 0xF0 },
+        { 1000 * ONE_MSEC, 0, 0x80, 0x80 },
+    };
+    FrameLog log = { malloc(sizeof(SceCtrlData2) * TEST_FRAMES), 0, 0 };
+
+    sim_kernel_init();
+    sim_ctrl_init();
+    sim_ctrl_set_sample_hook(log_frame, &log);
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_ctrl_play(script, sizeof(script) / sizeof(script[0]));
+
+    SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+    sim_run_for(1500 * ONE_MSEC);
+    frame.buttons = SCE_CTRL_CROSS;
+    CHECK_EQ(emuCtrlSetInputFrame(INPUT_TRACE_PORT, &frame), SCE_ERROR_OK);
+    sim_run_for(500 * ONE_MSEC);
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+    sim_ctrl_set_sample_hook(NULL, NULL);
+
+    u32 len;
+    const u8 *trace = sim_file_get(INPUT_TRACE_PATH, &len);
+    CHECK(trace != NULL);
+    CHECK(log.count > 100);
+    if(trace != NULL) {
+        check_decode(trace, len, log.frames, log.count, false);
+        printf("Recorded %u frames in %u bytes\n", log.count, len);
+    }
+
+    CHECK_EQ(g_record_ring.overflows, 0);
+    CHECK_EQ(sim_context_violations(), 0);
+
+    free(log.frames);
+}
+
+int main(void)
+{
+    test_round_trip();
+    test_jittered_idle();
+    test_errors();
+    test_recording();
+
+    return TEST_RESULT();
+}
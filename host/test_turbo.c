@@ -0,0 +1,95 @@
+// PSP-EmulatedControllerTest host build
+// Checks the turbo on/off timing, poll by poll, on the port output the ctrl driver model sees.
+//
+// Ryan Crosby 2025
+
+#include "config.h"
+#include "plugin.c"
+
+#include "sim.h"
+#include "test.h"
+
+#include <string.h>
+
+#define TEST_PORT (SCE_CTRL_PORT_DS3)
+
+// Holds the injected buttons as given by pattern, one character per poll, '1' for held, and returns whether
+// button was reported on each poll, in the same form. Characters other than '0' and '1' are copied.
+static
+void run_pattern(u32 button, const char *pattern, char *result)
+{
+    for(u32 i = 0; pattern[i] != '\0'; i++) {
+        if(pattern[i] != '0' && pattern[i] != '1') {
+            result[i] = pattern[i];
+            continue;
+        }
+
+        SceCtrlData2 frame = INPUT_CHANNEL_NEUTRAL_FRAME;
+        frame.buttons = pattern[i] == '1' ? button : 0;
+        emuCtrlSetInputFrame(TEST_PORT, &frame);
+
+        // One poll
+        sim_run_for(SIM_VBLANK_PERIOD);
+
+        result[i] = (sim_ctrl_port_data(TEST_PORT)->buttons & button) ? '1' : '0';
+    }
+
+    result[strlen(pattern)] = '\0';
+}
+
+static
+void check_pattern(u32 button, const char *pattern, const char *expected)
+{
+    char result[128];
+
+    // Start from a released button
+    run_pattern(button, "000", result);
+
+    run_pattern(button, pattern, result);
+    if(strcmp(result, expected) != 0) {
+        fprintf(stderr, "turbo: held %s, reported %s, expected %s\n", pattern, result, expected);
+        g_test_failures++;
+    }
+}
+
+int main(void)
+{
+    sim_kernel_init();
+    sim_ctrl_init();
+
+    CHECK_EQ(module_start(0, NULL), MODULE_OK);
+    sim_run_for(100 * ONE_MSEC);
+
+    CHECK_EQ(emuCtrlSetTurbo(SCE_CTRL_CROSS, 3, 2), SCE_ERROR_OK);
+    CHECK_EQ(emuCtrlSetTurbo(SCE_CTRL_SQUARE, 1, 1), SCE_ERROR_OK);
+
+    // Held: on for 3 polls, off for 2
+    check_pattern(SCE_CTRL_CROSS, "111111111111111", "111001110011100");
+
+    // Released during the on phase, then held again: starts over with a full on phase
+    check_pattern(SCE_CTRL_CROSS, "110111111111", "110111001110");
+
+    // Released during the off phase
+    check_pattern(SCE_CTRL_CROSS, "11110111111", "11100111001");
+
+    // The shortest periods
+    check_pattern(SCE_CTRL_SQUARE, "11111111", "10101010");
+
+    // Buttons without turbo are left alone
+    check_pattern(SCE_CTRL_CIRCLE, "11111011", "11111011");
+
+    // Turbo off again
+    CHECK_EQ(emuCtrlSetTurbo(SCE_CTRL_CROSS, 0, 0), SCE_ERROR_OK);
+    check_pattern(SCE_CTRL_CROSS, "1111111", "1111111");
+
+    // The longest periods
+    CHECK_EQ(emuCtrlSetTurbo(SCE_CTRL_CROSS, TURBO_MAX_PERIOD, 1), SCE_ERROR_OK);
+    check_pattern(SCE_CTRL_CROSS, "11111111111111111", "11111111111111101");
+
+    CHECK(emuCtrlSetTurbo(SCE_CTRL_CROSS, TURBO_MAX_PERIOD + 1, 1) < 0);
+
+    CHECK_EQ(module_stop(0, NULL), MODULE_OK);
+    CHECK_EQ(sim_context_violations(), 0);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,103 @@
+// PSP-EmulatedControllerTest
+// Input recording. See input_record.h.
+//
+// Ryan Crosby 2025
+
+#include "input_record.h"
+
+#include <pspiofilemgr.h>
+
+#if INPUT_TRACE_MODE == INPUT_TRACE_MODE_RECORD
+
+static
+void recorder_write_chunk(InputRecorder *recorder, u32 size)
+{
+    if(recorder->fd < 0 || size == 0) {
+        return;
+    }
+
+    int result = sceIoWrite(recorder->fd, recorder->chunk, size);
+    if(result != (int)size) {
+        DEBUG_PRINT("Failed to write input trace: ret 0x%08x\n", result);
+        recorder->write_errors++;
+        sceIoClose(recorder->fd);
+        recorder->fd = -1;
+    }
+}
+
+// Appends bytes to the chunk buffer, writing the chunk out each time it fills up.
+// This keeps every write but the last one exactly INPUT_TRACE_CHUNK_SIZE bytes.
+static
+void recorder_append(InputRecorder *recorder, const u8 *data, u32 size)
+{
+    for(u32 i = 0; i < size; i++) {
+        recorder->chunk[recorder->chunk_fill++] = data[i];
+
+        if(recorder->chunk_fill == INPUT_TRACE_CHUNK_SIZE) {
+            recorder_write_chunk(recorder, INPUT_TRACE_CHUNK_SIZE);
+            recorder->chunk_fill = 0;
+        }
+    }
+}
+
+s32 recorder_open(InputRecorder *recorder)
+{
+    u8 header[INPUT_TRACE_HEADER_SIZE];
+
+    recorder->fd = sceIoOpen(INPUT_TRACE_PATH, PSP_O_WRONLY | PSP_O_CREAT | PSP_O_TRUNC, 0777);
+    if(recorder->fd < 0) {
+        DEBUG_PRINT("Failed to open input trace " INPUT_TRACE_PATH ": ret 0x%08x\n", recorder->fd);
+        return recorder->fd;
+    }
+
+    input_trace_encoder_init(&recorder->encoder);
+    recorder->chunk_fill = 0;
+
+    input_trace_write_header(header);
+    recorder_append(recorder, header, sizeof(header));
+
+    return SCE_ERROR_OK;
+}
+
+void recorder_drain(InputRecorder *recorder, RecordRing *ring)
+{
+    u8 encoded[INPUT_TRACE_MAX_ENCODE_SIZE];
+    SceCtrlData2 frame;
+    u32 head = ring->head;
+    u32 tail = ring->tail;
+
+    MEMORY_BARRIER();
+
+    while(head != tail) {
+        copy_words(&frame, &ring->frames[head & (RECORD_RING_LENGTH - 1)], sizeof(SceCtrlData2));
+        head++;
+
+        // Hand the slot back as soon as it has been copied
+        MEMORY_BARRIER();
+        ring->head = head;
+
+        if(recorder->fd >= 0) {
+            recorder_append(recorder, encoded, input_trace_encode(&recorder->encoder, &frame, encoded));
+        }
+    }
+}
+
+void recorder_close(InputRecorder *recorder)
+{
+    u8 encoded[INPUT_TRACE_MAX_ENCODE_SIZE];
+
+    if(recorder->fd < 0) {
+        return;
+    }
+
+    recorder_append(recorder, encoded, input_trace_encode_flush(&recorder->encoder, encoded));
+    recorder_write_chunk(recorder, recorder->chunk_fill);
+    recorder->chunk_fill = 0;
+
+    if(recorder->fd >= 0) {
+        sceIoClose(recorder->fd);
+        recorder->fd = -1;
+    }
+}
+
+#endif
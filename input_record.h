@@ -0,0 +1,74 @@
+// PSP-EmulatedControllerTest
+// Input recording: the last stage of the input pipeline, with INPUT_TRACE_MODE_RECORD.
+//
+// Ryan Crosby 2025
+//
+// The controller callback only copies the frames it emits into a ring. The main thread drains the ring,
+// encodes the frames into the input_trace.h format, and writes them to INPUT_TRACE_PATH in chunks.
+
+#ifndef INPUT_RECORD_H
+#define INPUT_RECORD_H
+
+#include "ctrl_imports.h"
+#include "config.h"
+#include "common.h"
+#include "input_trace.h"
+
+#include <pspkerneltypes.h>
+
+#if INPUT_TRACE_MODE == INPUT_TRACE_MODE_RECORD
+
+// The number of frames the recording ring can hold. Must be a power of 2.
+// The main thread drains it every TIMER_PERIOD, so this covers about 2.5 seconds of polls at 100Hz
+// before frames are dropped.
+#define RECORD_RING_LENGTH (256)
+
+// A single-producer/single-consumer ring carrying the emitted frames from the controller callback
+// to the main thread. The callback never waits for space, it counts the frame as dropped instead.
+typedef struct {
+    volatile u32 head;
+    volatile u32 tail;
+    // The number of frames dropped because the ring was full.
+    volatile u32 overflows;
+    SceCtrlData2 frames[RECORD_RING_LENGTH];
+} RecordRing;
+
+// Main thread state for writing the trace file.
+typedef struct {
+    SceUID fd;
+    InputTraceEncoder encoder;
+    // The number of bytes used in chunk. Encoded frames are collected until a whole chunk is full.
+    u32 chunk_fill;
+    // The number of failed writes. Recording stops at the first one.
+    u32 write_errors;
+    u8 chunk[INPUT_TRACE_CHUNK_SIZE] __attribute__((aligned(64)));
+} InputRecorder;
+
+// Called from the controller callback. Never blocks or touches file I/O.
+static inline
+void record_frame(RecordRing *ring, const SceCtrlData2 *frame)
+{
+    u32 tail = ring->tail;
+
+    if(tail - ring->head >= RECORD_RING_LENGTH) {
+        ring->overflows++;
+        return;
+    }
+
+    copy_words(&ring->frames[tail & (RECORD_RING_LENGTH - 1)], frame, sizeof(SceCtrlData2));
+    MEMORY_BARRIER();
+    ring->tail = tail + 1;
+}
+
+// Creates INPUT_TRACE_PATH and writes the trace header. Called from the main thread.
+s32 recorder_open(InputRecorder *recorder);
+
+// Encodes every frame waiting in the ring. Called from the main thread.
+void recorder_drain(InputRecorder *recorder, RecordRing *ring);
+
+// Writes out everything still buffered and closes the trace. Called from the main thread.
+void recorder_close(InputRecorder *recorder);
+
+#endif
+
+#endif /* INPUT_RECORD_H */
@@ -0,0 +1,103 @@
+// PSP-EmulatedControllerTest
+// Input replay. See input_replay.h.
+//
+// Ryan Crosby 2025
+
+#include "input_replay.h"
+
+#include <pspiofilemgr.h>
+
+#if INPUT_TRACE_MODE == INPUT_TRACE_MODE_REPLAY
+
+// Decodes the next frame from the trace file. Returns false at the end of the trace.
+static
+bool replayer_next(InputReplayer *replayer, SceCtrlData2 *frame)
+{
+    for(;;) {
+        s32 result = input_trace_decode(&replayer->decoder, replayer->chunk + replayer->chunk_pos,
+            replayer->chunk_len - replayer->chunk_pos, frame);
+
+        if(result >= 0) {
+            replayer->chunk_pos += result;
+            return true;
+        }
+
+        if(result != INPUT_TRACE_NEED_MORE || replayer->file_eof) {
+            return false;
+        }
+
+        // Move the partial record to the front and top the chunk up
+        u32 remaining = replayer->chunk_len - replayer->chunk_pos;
+        for(u32 i = 0; i < remaining; i++) {
+            replayer->chunk[i] = replayer->chunk[replayer->chunk_pos + i];
+        }
+
+        int read = sceIoRead(replayer->fd, replayer->chunk + remaining, INPUT_TRACE_CHUNK_SIZE - remaining);
+        if(read <= 0) {
+            replayer->file_eof = true;
+            read = 0;
+        }
+
+        replayer->chunk_pos = 0;
+        replayer->chunk_len = remaining + read;
+    }
+}
+
+s32 replayer_open(InputReplayer *replayer)
+{
+    replayer->fd = sceIoOpen(INPUT_TRACE_PATH, PSP_O_RDONLY, 0);
+    if(replayer->fd < 0) {
+        DEBUG_PRINT("Failed to open input trace " INPUT_TRACE_PATH ": ret 0x%08x\n", replayer->fd);
+        return replayer->fd;
+    }
+
+    input_trace_decoder_init(&replayer->decoder);
+    replayer->fill_buffer = 0;
+    replayer->file_eof = false;
+
+    int read = sceIoRead(replayer->fd, replayer->chunk, INPUT_TRACE_CHUNK_SIZE);
+    if(read < INPUT_TRACE_HEADER_SIZE || !input_trace_check_header(replayer->chunk)) {
+        DEBUG_PRINT("Invalid input trace " INPUT_TRACE_PATH "\n");
+        sceIoClose(replayer->fd);
+        replayer->fd = -1;
+        return SCE_ERROR_INVALID_SIZE;
+    }
+
+    replayer->chunk_pos = INPUT_TRACE_HEADER_SIZE;
+    replayer->chunk_len = read;
+
+    return SCE_ERROR_OK;
+}
+
+void replayer_fill(InputReplayer *replayer, ReplayState *replay)
+{
+    u32 buffer = replayer->fill_buffer;
+    u32 count = 0;
+
+    if(replayer->fd < 0 || replay->end_of_trace || replay->counts[buffer] != 0) {
+        return;
+    }
+
+    while(count < REPLAY_BUFFER_LENGTH && replayer_next(replayer, &replay->frames[buffer][count])) {
+        count++;
+    }
+
+    // Publish the frames only once they are fully written
+    MEMORY_BARRIER();
+    replay->counts[buffer] = count;
+    replayer->fill_buffer = buffer ^ 1;
+
+    if(count < REPLAY_BUFFER_LENGTH) {
+        replay->end_of_trace = true;
+    }
+}
+
+void replayer_close(InputReplayer *replayer)
+{
+    if(replayer->fd >= 0) {
+        sceIoClose(replayer->fd);
+        replayer->fd = -1;
+    }
+}
+
+#endif
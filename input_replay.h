@@ -0,0 +1,145 @@
+// PSP-EmulatedControllerTest
+// Input replay, with INPUT_TRACE_MODE_REPLAY. Replaces the live input of the emulated port with a recorded trace.
+//
+// Ryan Crosby 2025
+//
+// The main thread decodes INPUT_TRACE_PATH ahead of time into two buffers. The controller callback only pops
+// the frame due at each poll from them.
+
+#ifndef INPUT_REPLAY_H
+#define INPUT_REPLAY_H
+
+#include "ctrl_imports.h"
+#include "config.h"
+#include "common.h"
+#include "input_trace.h"
+
+#include <pspkerneltypes.h>
+
+#if INPUT_TRACE_MODE == INPUT_TRACE_MODE_REPLAY
+
+// The number of frames in each of the two replay buffers.
+// The main thread refills a buffer every TIMER_PERIOD, so each buffer must cover more than that.
+#define REPLAY_BUFFER_LENGTH (128)
+
+// Double buffered frames shared between the main thread, which decodes the trace ahead of time, and the
+// controller callback, which only pops frames.
+//
+// A buffer belongs to the main thread while its count is 0, and to the callback once the main thread
+// publishes a non-zero count. The callback hands it back by resetting the count to 0. Buffers are filled
+// and consumed in the same alternating order.
+typedef struct {
+    SceCtrlData2 frames[2][REPLAY_BUFFER_LENGTH];
+    volatile u32 counts[2];
+    // Set by the main thread once the last frame of the trace has been published.
+    volatile bool end_of_trace;
+
+    // Callback owned
+    u32 read_buffer;
+    u32 read_pos;
+    bool started;
+    bool finished;
+    // Maps poll timestamps onto trace timestamps. Set on the first replayed poll.
+    u32 time_offset;
+    // The frame currently being replayed. It is held until the next frame is due.
+    SceCtrlData2 current;
+    // The number of polls on which the next frame had not been decoded in time.
+    volatile u32 underruns;
+} ReplayState;
+
+// Main thread state for reading the trace file.
+typedef struct {
+    SceUID fd;
+    InputTraceDecoder decoder;
+    bool file_eof;
+    u32 fill_buffer;
+    // The undecoded bytes are chunk[chunk_pos, chunk_len).
+    u32 chunk_pos;
+    u32 chunk_len;
+    u8 chunk[INPUT_TRACE_CHUNK_SIZE] __attribute__((aligned(64)));
+} InputReplayer;
+
+// Returns the next frame of the replay, or NULL if it is not available yet.
+static inline
+const SceCtrlData2 *replay_peek(ReplayState *replay)
+{
+    u32 buffer = replay->read_buffer;
+
+    if(replay->counts[buffer] == 0) {
+        return NULL;
+    }
+
+    MEMORY_BARRIER();
+    return &replay->frames[buffer][replay->read_pos];
+}
+
+static inline
+void replay_advance(ReplayState *replay)
+{
+    u32 buffer = replay->read_buffer;
+
+    if(++replay->read_pos == replay->counts[buffer]) {
+        // Hand the buffer back to the main thread and move on to the other one
+        MEMORY_BARRIER();
+        replay->counts[buffer] = 0;
+        replay->read_buffer = buffer ^ 1;
+        replay->read_pos = 0;
+    }
+}
+
+// Called from the controller callback with the poll timestamp.
+// Writes the frame to replay for this poll into frame, and returns false once the replay is not running.
+static inline
+bool replay_frame(ReplayState *replay, u32 now, SceCtrlData2 *frame)
+{
+    if(replay->finished) {
+        return false;
+    }
+
+    const SceCtrlData2 *next = replay_peek(replay);
+
+    if(!replay->started) {
+        if(next == NULL) {
+            // Nothing decoded yet
+            return false;
+        }
+
+        // Align the first trace frame with this poll
+        replay->time_offset = now - next->timeStamp;
+        replay->started = true;
+    }
+
+    // Move up to the last frame that is due at this poll. With matching sampling cycles on
+    // recording and replay this is exactly one frame per poll.
+    u32 trace_time = now - replay->time_offset;
+    while(next != NULL && (s32)(trace_time - next->timeStamp) >= 0) {
+        copy_words(&replay->current, next, sizeof(SceCtrlData2));
+        replay_advance(replay);
+        next = replay_peek(replay);
+    }
+
+    if(next == NULL) {
+        if(replay->end_of_trace) {
+            // This poll replays the last frame, the live input takes over from the next one
+            replay->finished = true;
+        }
+        else {
+            replay->underruns++;
+        }
+    }
+
+    copy_words(frame, &replay->current, sizeof(SceCtrlData2));
+    return true;
+}
+
+// Opens INPUT_TRACE_PATH and checks its header. Called from the main thread.
+s32 replayer_open(InputReplayer *replayer);
+
+// Decodes the next replay buffer, if the callback has handed it back. Called from the main thread.
+void replayer_fill(InputReplayer *replayer, ReplayState *replay);
+
+void replayer_close(InputReplayer *replayer);
+
+#endif
+
+#endif /* INPUT_REPLAY_H */
@@ -0,0 +1,432 @@
+// PSP-EmulatedControllerTest
+// Compact binary trace format for SceCtrlData2 input frames. See input_trace.h for the format.
+//
+// Ryan Crosby 2025
+
+#include "input_trace.h"
+#include "common.h"
+
+//
+// Primitives
+//
+
+static
+u32 put_varint(u8 *out, u32 value)
+{
+    u32 n = 0;
+
+    while(value >= 0x80) {
+        out[n++] = (u8)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (u8)value;
+
+    return n;
+}
+
+// Returns the number of bytes read, or 0 if in ends part way through the varint or it is too long.
+static
+u32 get_varint(const u8 *in, u32 len, u32 *value)
+{
+    u32 result = 0;
+
+    for(u32 n = 0; n < len && n < 5; n++) {
+        result |= (u32)(in[n] & 0x7F) << (7 * n);
+        if((in[n] & 0x80) == 0) {
+            *value = result;
+            return n + 1;
+        }
+    }
+
+    return 0;
+}
+
+// The result for a varint get_varint() couldn't read from the len bytes at in: more input can only finish
+// it if it is shorter than the longest varint.
+static inline
+s32 varint_error(u32 len)
+{
+    return len >= 5 ? INPUT_TRACE_CORRUPT : INPUT_TRACE_NEED_MORE;
+}
+
+static inline
+u32 zigzag_encode(s32 value)
+{
+    return ((u32)value << 1) ^ (u32)(value >> 31);
+}
+
+static inline
+s32 zigzag_decode(u32 value)
+{
+    return (s32)(value >> 1) ^ -(s32)(value & 1);
+}
+
+static inline
+u32 load_u32_le(const u8 *in)
+{
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((u32)in[3] << 24);
+}
+
+static inline
+void store_u32_le(u8 *out, u32 value)
+{
+    out[0] = (u8)value;
+    out[1] = (u8)(value >> 8);
+    out[2] = (u8)(value >> 16);
+    out[3] = (u8)(value >> 24);
+}
+
+// The stick and reserved bytes, each as a single word so they compare and copy in one go.
+static inline
+u32 sticks_word(const SceCtrlData2 *frame)
+{
+    return frame->aX | (frame->aY << 8) | (frame->rX << 16) | ((u32)frame->rY << 24);
+}
+
+static inline
+u32 reserved_word(const SceCtrlData2 *frame)
+{
+    return frame->rsrv[0] | (frame->rsrv[1] << 8) | (frame->rsrv[2] << 16) | ((u32)frame->rsrv[3] << 24);
+}
+
+static
+void zero_frame(SceCtrlData2 *frame)
+{
+    u32 *d = (u32 *)frame;
+
+    for(u32 i = 0; i < sizeof(SceCtrlData2) / sizeof(u32); i++) {
+        d[i] = 0;
+    }
+}
+
+// Returns the record header bits for the fields of frame that differ from prev.
+static
+u32 changed_fields(const SceCtrlData2 *prev, const SceCtrlData2 *frame)
+{
+    u32 fields = INPUT_TRACE_FIELD_FRAME;
+
+    if(frame->buttons != prev->buttons) {
+        fields |= INPUT_TRACE_FIELD_BUTTONS;
+    }
+    if(sticks_word(frame) != sticks_word(prev)) {
+        fields |= INPUT_TRACE_FIELD_STICKS;
+    }
+    if(reserved_word(frame) != reserved_word(prev)) {
+        fields |= INPUT_TRACE_FIELD_RESERVED;
+    }
+    if(frame->DPadSenseA != prev->DPadSenseA || frame->DPadSenseB != prev->DPadSenseB) {
+        fields |= INPUT_TRACE_FIELD_DPAD_SENSE;
+    }
+    if(frame->GPadSenseA != prev->GPadSenseA || frame->GPadSenseB != prev->GPadSenseB) {
+        fields |= INPUT_TRACE_FIELD_GPAD_SENSE;
+    }
+    if(frame->AxisSenseA != prev->AxisSenseA || frame->AxisSenseB != prev->AxisSenseB) {
+        fields |= INPUT_TRACE_FIELD_AXIS_SENSE;
+    }
+    if(frame->TiltA != prev->TiltA || frame->TiltB != prev->TiltB) {
+        fields |= INPUT_TRACE_FIELD_TILT;
+    }
+
+    return fields;
+}
+
+//
+// Header
+//
+
+void input_trace_write_header(u8 *out)
+{
+    store_u32_le(out, INPUT_TRACE_MAGIC);
+    store_u32_le(out + 4, INPUT_TRACE_VERSION);
+}
+
+bool input_trace_check_header(const u8 *in)
+{
+    return load_u32_le(in) == INPUT_TRACE_MAGIC && load_u32_le(in + 4) == INPUT_TRACE_VERSION;
+}
+
+//
+// Encoder
+//
+
+void input_trace_encoder_init(InputTraceEncoder *enc)
+{
+    zero_frame(&enc->prev);
+    enc->prev_delta = 0;
+    enc->run_length = 0;
+    enc->run_jittered = false;
+    enc->has_prev = false;
+}
+
+u32 input_trace_encode_flush(InputTraceEncoder *enc, u8 *out)
+{
+    u32 n = 0;
+
+    if(enc->run_length != 0) {
+        out[n++] = enc->run_jittered ? INPUT_TRACE_JITTERED_RUN : INPUT_TRACE_IDLE_RUN;
+        n += put_varint(out + n, enc->run_length);
+
+        if(enc->run_jittered) {
+            for(u32 i = 0; i < enc->run_length; i++) {
+                n += put_varint(out + n, zigzag_encode(enc->run_residuals[i]));
+            }
+        }
+
+        enc->run_length = 0;
+        enc->run_jittered = false;
+    }
+
+    return n;
+}
+
+static
+u32 encode_sense_pair(u8 *out, s32 a, s32 b, s32 prev_a, s32 prev_b)
+{
+    u32 n = put_varint(out, zigzag_encode(a - prev_a));
+    n += put_varint(out + n, zigzag_encode(b - prev_b));
+    return n;
+}
+
+u32 input_trace_encode(InputTraceEncoder *enc, const SceCtrlData2 *frame, u8 *out)
+{
+    const SceCtrlData2 *prev = &enc->prev;
+    u32 delta = frame->timeStamp - prev->timeStamp;
+    u32 fields = changed_fields(prev, frame);
+    s32 residual = (s32)(delta - enc->prev_delta);
+    u32 n = 0;
+
+    // Idle frame: extend the current run, which is only written out once it ends
+    if(enc->has_prev && fields == INPUT_TRACE_FIELD_FRAME
+        && residual >= -INPUT_TRACE_MAX_JITTER && residual <= INPUT_TRACE_MAX_JITTER) {
+        // An exact run ends at the first frame off the previous delta, and a jittered run takes over
+        if(residual != 0 && !enc->run_jittered) {
+            n = input_trace_encode_flush(enc, out);
+            enc->run_jittered = true;
+        }
+
+        if(enc->run_jittered) {
+            enc->run_residuals[enc->run_length] = (s8)residual;
+        }
+        enc->run_length++;
+        enc->prev.timeStamp = frame->timeStamp;
+
+        if(enc->run_jittered && enc->run_length == INPUT_TRACE_MAX_JITTERED_RUN) {
+            n = input_trace_encode_flush(enc, out);
+        }
+
+        return n;
+    }
+
+    n = input_trace_encode_flush(enc, out);
+
+    out[n++] = (u8)fields;
+    n += put_varint(out + n, delta);
+
+    if(fields & INPUT_TRACE_FIELD_BUTTONS) {
+        n += put_varint(out + n, frame->buttons ^ prev->buttons);
+    }
+    if(fields & INPUT_TRACE_FIELD_STICKS) {
+        store_u32_le(out + n, sticks_word(frame));
+        n += 4;
+    }
+    if(fields & INPUT_TRACE_FIELD_RESERVED) {
+        store_u32_le(out + n, reserved_word(frame));
+        n += 4;
+    }
+    if(fields & INPUT_TRACE_FIELD_DPAD_SENSE) {
+        n += encode_sense_pair(out + n, frame->DPadSenseA, frame->DPadSenseB, prev->DPadSenseA, prev->DPadSenseB);
+    }
+    if(fields & INPUT_TRACE_FIELD_GPAD_SENSE) {
+        n += encode_sense_pair(out + n, frame->GPadSenseA, frame->GPadSenseB, prev->GPadSenseA, prev->GPadSenseB);
+    }
+    if(fields & INPUT_TRACE_FIELD_AXIS_SENSE) {
+        n += encode_sense_pair(out + n, frame->AxisSenseA, frame->AxisSenseB, prev->AxisSenseA, prev->AxisSenseB);
+    }
+    if(fields & INPUT_TRACE_FIELD_TILT) {
+        n += encode_sense_pair(out + n, frame->TiltA, frame->TiltB, prev->TiltA, prev->TiltB);
+    }
+
+    copy_words(&enc->prev, frame, sizeof(SceCtrlData2));
+    enc->prev_delta = delta;
+    enc->has_prev = true;
+
+    return n;
+}
+
+//
+// Decoder
+//
+
+void input_trace_decoder_init(InputTraceDecoder *dec)
+{
+    zero_frame(&dec->prev);
+    dec->prev_delta = 0;
+    dec->run_remaining = 0;
+    dec->run_jittered = false;
+    dec->has_prev = false;
+}
+
+// Decodes a zigzag varint pair as differences against prev_a/prev_b.
+// Returns the number of bytes read, or an input_trace_decode() error.
+static
+s32 decode_sense_pair(const u8 *in, u32 len, s32 *a, s32 *b, s32 prev_a, s32 prev_b)
+{
+    u32 value;
+    u32 n = get_varint(in, len, &value);
+    if(n == 0) {
+        return varint_error(len);
+    }
+    *a = prev_a + zigzag_decode(value);
+
+    u32 m = get_varint(in + n, len - n, &value);
+    if(m == 0) {
+        return varint_error(len - n);
+    }
+    *b = prev_b + zigzag_decode(value);
+
+    return n + m;
+}
+
+// Returns the next frame of the current idle run, reading its residual from in if the run is jittered.
+static
+s32 decode_run_frame(InputTraceDecoder *dec, const u8 *in, u32 len, SceCtrlData2 *frame)
+{
+    u32 n = 0;
+    u32 value = 0;
+
+    if(dec->run_jittered) {
+        n = get_varint(in, len, &value);
+        if(n == 0) {
+            return varint_error(len);
+        }
+    }
+
+    dec->run_remaining--;
+    dec->prev.timeStamp += dec->prev_delta + zigzag_decode(value);
+    copy_words(frame, &dec->prev, sizeof(SceCtrlData2));
+    return n;
+}
+
+s32 input_trace_decode(InputTraceDecoder *dec, const u8 *in, u32 len, SceCtrlData2 *frame)
+{
+    u32 n = 0;
+    u32 m;
+    s32 result;
+    u32 value;
+
+    // Idle run frames come from the decoder state, and the residuals of a jittered run
+    if(dec->run_remaining != 0) {
+        return decode_run_frame(dec, in, len, frame);
+    }
+
+    if(len == 0) {
+        return INPUT_TRACE_NEED_MORE;
+    }
+
+    u32 fields = in[n++];
+
+    if(fields == INPUT_TRACE_IDLE_RUN || fields == INPUT_TRACE_JITTERED_RUN) {
+        if(!dec->has_prev) {
+            return INPUT_TRACE_CORRUPT;
+        }
+
+        m = get_varint(in + n, len - n, &value);
+        if(m == 0) {
+            return varint_error(len - n);
+        }
+        if(value == 0) {
+            return INPUT_TRACE_CORRUPT;
+        }
+        n += m;
+
+        // Return the first frame of the run now, and the rest on the following calls
+        dec->run_remaining = value;
+        dec->run_jittered = fields == INPUT_TRACE_JITTERED_RUN;
+
+        result = decode_run_frame(dec, in + n, len - n, frame);
+        if(result < 0) {
+            dec->run_remaining = 0;
+            return result;
+        }
+
+        return n + result;
+    }
+
+    if((fields & INPUT_TRACE_FIELD_FRAME) == 0) {
+        return INPUT_TRACE_CORRUPT;
+    }
+
+    // Build the frame separately so a truncated record leaves the decoder untouched
+    copy_words(frame, &dec->prev, sizeof(SceCtrlData2));
+
+    u32 delta;
+    m = get_varint(in + n, len - n, &delta);
+    if(m == 0) {
+        return varint_error(len - n);
+    }
+    n += m;
+    frame->timeStamp = dec->prev.timeStamp + delta;
+
+    if(fields & INPUT_TRACE_FIELD_BUTTONS) {
+        m = get_varint(in + n, len - n, &value);
+        if(m == 0) {
+            return varint_error(len - n);
+        }
+        n += m;
+        frame->buttons ^= value;
+    }
+    if(fields & INPUT_TRACE_FIELD_STICKS) {
+        if(len - n < 4) {
+            return INPUT_TRACE_NEED_MORE;
+        }
+        frame->aX = in[n];
+        frame->aY = in[n + 1];
+        frame->rX = in[n + 2];
+        frame->rY = in[n + 3];
+        n += 4;
+    }
+    if(fields & INPUT_TRACE_FIELD_RESERVED) {
+        if(len - n < 4) {
+            return INPUT_TRACE_NEED_MORE;
+        }
+        frame->rsrv[0] = in[n];
+        frame->rsrv[1] = in[n + 1];
+        frame->rsrv[2] = in[n + 2];
+        frame->rsrv[3] = in[n + 3];
+        n += 4;
+    }
+    if(fields & INPUT_TRACE_FIELD_DPAD_SENSE) {
+        result = decode_sense_pair(in + n, len - n, &frame->DPadSenseA, &frame->DPadSenseB, dec->prev.DPadSenseA, dec->prev.DPadSenseB);
+        if(result < 0) {
+            return result;
+        }
+        n += result;
+    }
+    if(fields & INPUT_TRACE_FIELD_GPAD_SENSE) {
+        result = decode_sense_pair(in + n, len - n, &frame->GPadSenseA, &frame->GPadSenseB, dec->prev.GPadSenseA, dec->prev.GPadSenseB);
+        if(result < 0) {
+            return result;
+        }
+        n += result;
+    }
+    if(fields & INPUT_TRACE_FIELD_AXIS_SENSE) {
+        result = decode_sense_pair(in + n, len - n, &frame->AxisSenseA, &frame->AxisSenseB, dec->prev.AxisSenseA, dec->prev.AxisSenseB);
+        if(result < 0) {
+            return result;
+        }
+        n += result;
+    }
+    if(fields & INPUT_TRACE_FIELD_TILT) {
+        result = decode_sense_pair(in + n, len - n, &frame->TiltA, &frame->TiltB, dec->prev.TiltA, dec->prev.TiltB);
+        if(result < 0) {
+            return result;
+        }
+        n += result;
+    }
+
+    copy_words(&dec->prev, frame, sizeof(SceCtrlData2));
+    dec->prev_delta = delta;
+    dec->has_prev = true;
+
+    return n;
+}
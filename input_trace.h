@@ -0,0 +1,123 @@
+// PSP-EmulatedControllerTest
+// Compact binary trace format for SceCtrlData2 input frames.
+//
+// Ryan Crosby 2025
+//
+// Raw frames are 48 bytes each, which adds up quickly when recording at the polling rate.
+// Most fields rarely change between polls, so each frame is stored as a delta against the previous one.
+//
+// A trace is an INPUT_TRACE_HEADER_SIZE byte header followed by a stream of records.
+// Each record starts with a header byte:
+//
+// * 0x00: Idle run. Followed by a varint N. The previous frame repeats N more times, with the
+//   timestamp advancing by the previous timestamp delta each time.
+// * 0x02: Jittered idle run. Followed by a varint N, then N zigzag varints. The previous frame repeats
+//   N more times, with the timestamp advancing by the previous timestamp delta plus the next varint each
+//   time. The poll timestamps wobble by a few microseconds, so most idle stretches only ever come out
+//   as this kind. The encoder keeps the residuals within INPUT_TRACE_MAX_JITTER, a byte each.
+// * Any odd value: A frame. INPUT_TRACE_FIELD_FRAME is always set, and the other bits flag
+//   which fields changed. The record body is the varint timestamp delta, followed by the changed
+//   fields in bit order:
+//   * INPUT_TRACE_FIELD_BUTTONS: varint of buttons XOR previous buttons.
+//   * INPUT_TRACE_FIELD_STICKS: 4 raw bytes, aX, aY, rX, rY.
+//   * INPUT_TRACE_FIELD_RESERVED: 4 raw bytes, rsrv[0 - 3].
+//   * INPUT_TRACE_FIELD_DPAD_SENSE, _GPAD_SENSE, _AXIS_SENSE, _TILT: Two zigzag varints, the
+//     differences of the A and B fields against their previous values.
+//
+// Varints are little endian base 128, 7 bits per byte with the top bit set on all but the last byte.
+//
+// The previous timestamp delta is always that of the last frame record, idle runs leave it as it is.
+// Decoding starts from an all zero previous frame. This only depends on ctrl_imports.h types and has no
+// libc dependencies, so it builds into the plugin and into host tools alike.
+
+#ifndef INPUT_TRACE_H
+#define INPUT_TRACE_H
+
+#include "ctrl_imports.h"
+
+#include <stdbool.h>
+
+#define INPUT_TRACE_MAGIC           (0x52544345) // "ECTR"
+#define INPUT_TRACE_VERSION         (2)
+#define INPUT_TRACE_HEADER_SIZE     (8)
+
+// Idle run record headers
+#define INPUT_TRACE_IDLE_RUN            (0x00)
+#define INPUT_TRACE_JITTERED_RUN        (0x02)
+
+// Record header bits
+#define INPUT_TRACE_FIELD_FRAME         (1 << 0)
+#define INPUT_TRACE_FIELD_BUTTONS       (1 << 1)
+#define INPUT_TRACE_FIELD_STICKS        (1 << 2)
+#define INPUT_TRACE_FIELD_RESERVED      (1 << 3)
+#define INPUT_TRACE_FIELD_DPAD_SENSE    (1 << 4)
+#define INPUT_TRACE_FIELD_GPAD_SENSE    (1 << 5)
+#define INPUT_TRACE_FIELD_AXIS_SENSE    (1 << 6)
+#define INPUT_TRACE_FIELD_TILT          (1 << 7)
+
+// The longest possible single record: header, timestamp, buttons, sticks, reserved and four varint pairs.
+#define INPUT_TRACE_MAX_RECORD_SIZE     (1 + 5 + 5 + 4 + 4 + (4 * 2 * 5))
+
+// The furthest an idle frame's timestamp delta can be from the previous delta, in microseconds.
+#define INPUT_TRACE_MAX_JITTER          (63)
+
+// The most frames the encoder holds back for a jittered idle run before writing it out.
+#define INPUT_TRACE_MAX_JITTERED_RUN    (32)
+
+// The longest possible idle run record: header, count and a byte per residual of a jittered run.
+#define INPUT_TRACE_MAX_RUN_SIZE        (1 + 5 + INPUT_TRACE_MAX_JITTERED_RUN)
+
+// The most bytes input_trace_encode() or input_trace_encode_flush() can write in one call:
+// a pending idle run record followed by a frame record.
+#define INPUT_TRACE_MAX_ENCODE_SIZE     (INPUT_TRACE_MAX_RUN_SIZE + INPUT_TRACE_MAX_RECORD_SIZE)
+
+// input_trace_decode() results
+#define INPUT_TRACE_NEED_MORE           (-1)
+#define INPUT_TRACE_CORRUPT             (-2)
+
+typedef struct {
+    SceCtrlData2 prev;
+    u32 prev_delta;
+    // Frames matching prev that have not been written out yet.
+    u32 run_length;
+    // Set once the pending run has a frame off prev_delta, and its residuals are kept in run_residuals.
+    bool run_jittered;
+    s8 run_residuals[INPUT_TRACE_MAX_JITTERED_RUN];
+    bool has_prev;
+} InputTraceEncoder;
+
+typedef struct {
+    SceCtrlData2 prev;
+    u32 prev_delta;
+    // Frames of the current idle run that have not been returned yet.
+    u32 run_remaining;
+    // Set if each of those frames still has its residual to be read.
+    bool run_jittered;
+    bool has_prev;
+} InputTraceDecoder;
+
+// Writes the trace header into out, which must hold INPUT_TRACE_HEADER_SIZE bytes.
+void input_trace_write_header(u8 *out);
+
+// Returns true if in starts with a valid trace header.
+bool input_trace_check_header(const u8 *in);
+
+void input_trace_encoder_init(InputTraceEncoder *enc);
+
+// Encodes a frame into out, which must hold INPUT_TRACE_MAX_ENCODE_SIZE bytes.
+// Returns the number of bytes written. This is 0 when the frame only extends an idle run.
+u32 input_trace_encode(InputTraceEncoder *enc, const SceCtrlData2 *frame, u8 *out);
+
+// Writes out any pending idle run, which must be done before the trace is closed.
+// out must hold INPUT_TRACE_MAX_ENCODE_SIZE bytes. Returns the number of bytes written.
+u32 input_trace_encode_flush(InputTraceEncoder *enc, u8 *out);
+
+void input_trace_decoder_init(InputTraceDecoder *dec);
+
+// Decodes the next frame from the len bytes at in.
+// Returns the number of bytes consumed, which is 0 for frames that come from an exact idle run,
+// INPUT_TRACE_NEED_MORE if in ends part way through a record, or INPUT_TRACE_CORRUPT.
+// The decoder state is left untouched unless a frame is returned.
+s32 input_trace_decode(InputTraceDecoder *dec, const u8 *in, u32 len, SceCtrlData2 *frame);
+
+#endif /* INPUT_TRACE_H */
@@ -0,0 +1,30 @@
+// PSP-EmulatedControllerTest
+// Poll timing statistics. See poll_stats.h.
+//
+// Ryan Crosby 2025
+
+#include "poll_stats.h"
+
+#if POLL_STATS
+
+bool poll_stats_read(const PollStats *poll_stats, EmuCtrlPollStats *stats)
+{
+    // A poll takes microseconds and comes every few milliseconds, so the first or second attempt succeeds.
+    for(u32 attempt = 0; attempt < 4; attempt++) {
+        u32 sequence = poll_stats->sequence;
+        MEMORY_BARRIER();
+
+        if((sequence & 1) == 0) {
+            copy_words(stats, &poll_stats->stats, sizeof(EmuCtrlPollStats));
+
+            MEMORY_BARRIER();
+            if(poll_stats->sequence == sequence) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+#endif
@@ -0,0 +1,121 @@
+// PSP-EmulatedControllerTest
+// Poll timing statistics, with POLL_STATS. See EmuCtrlPollStats in emu_ctrl.h for what is measured.
+//
+// Ryan Crosby 2025
+
+#ifndef POLL_STATS_H
+#define POLL_STATS_H
+
+#include "ctrl_imports.h"
+#include "emu_ctrl.h"
+#include "config.h"
+#include "common.h"
+
+#if POLL_STATS
+
+// Reads the COP0 Count register, which the Allegrex increments every CPU cycle. Kernel mode only.
+static inline
+u32 read_cycle_counter(void)
+{
+#if defined(__mips__)
+    u32 count;
+    __asm__ __volatile__("mfc0 %0, $9" : "=r"(count));
+    return count;
+#else
+    // The host build has no cycle counter to read, see host/
+    return 0;
+#endif
+}
+
+// The jitter is kept with this many fractional bits, so the 1/16 smoothing doesn't round it away.
+#define POLL_JITTER_FRACTION_BITS (4)
+
+// The poll statistics of a port, written by the controller callback only.
+//
+// The callback makes the sequence number odd while it updates the statistics, and even again once it is
+// done, so a reader can tell whether its copy was torn by a poll, and retry.
+typedef struct {
+    volatile u32 sequence;
+    EmuCtrlPollStats stats;
+    // The poll timestamp of the previous poll.
+    u32 last_timestamp;
+    // stats.jitter with POLL_JITTER_FRACTION_BITS fractional bits.
+    u32 jitter_fixed;
+} PollStats;
+
+// Accounts one poll. timestamp is the driver's poll timestamp, entry_time the system time the callback
+// started at, and cycles the callback execution time. sample_time is the timestamp of the PSP sample
+// the poll used, if sampled.
+static inline
+void poll_stats_update(PollStats *poll_stats, u32 timestamp, u32 entry_time, u32 cycles, bool sampled, u32 sample_time)
+{
+    EmuCtrlPollStats *stats = &poll_stats->stats;
+
+    poll_stats->sequence++;
+    MEMORY_BARRIER();
+
+    if(stats->polls != 0) {
+        u32 interval = timestamp - poll_stats->last_timestamp;
+        u32 bucket = interval >> EMU_CTRL_POLL_HISTOGRAM_SHIFT;
+        stats->interval_histogram[bucket < EMU_CTRL_POLL_HISTOGRAM_BUCKETS ? bucket : EMU_CTRL_POLL_HISTOGRAM_BUCKETS - 1]++;
+
+        if(stats->polls != 1) {
+            s32 change = (s32)(interval - stats->interval_last);
+            u32 deviation = change < 0 ? -change : change;
+
+            // J += (|D| - J) / 16
+            poll_stats->jitter_fixed += deviation - (poll_stats->jitter_fixed >> POLL_JITTER_FRACTION_BITS);
+            stats->jitter = poll_stats->jitter_fixed >> POLL_JITTER_FRACTION_BITS;
+            if(deviation > stats->jitter_max) {
+                stats->jitter_max = deviation;
+            }
+        }
+
+        stats->interval_last = interval;
+        if(stats->polls == 1 || interval < stats->interval_min) {
+            stats->interval_min = interval;
+        }
+        if(interval > stats->interval_max) {
+            stats->interval_max = interval;
+        }
+    }
+
+    u32 entry_delay = entry_time - timestamp;
+    stats->entry_delay_last = entry_delay;
+    if(entry_delay > stats->entry_delay_max) {
+        stats->entry_delay_max = entry_delay;
+    }
+
+    if(sampled) {
+        u32 sample_age = timestamp - sample_time;
+        stats->sample_polls++;
+        stats->sample_age_last = sample_age;
+        if(sample_age > stats->sample_age_max) {
+            stats->sample_age_max = sample_age;
+        }
+        if(stats->polls != 0 && (s32)(sample_time - poll_stats->last_timestamp) <= 0) {
+            stats->stale_samples++;
+        }
+    }
+
+    stats->handler_cycles_last = cycles;
+    stats->handler_cycles_total += cycles;
+    if(cycles > stats->handler_cycles_max) {
+        stats->handler_cycles_max = cycles;
+        stats->handler_cycles_max_timestamp = timestamp;
+    }
+
+    poll_stats->last_timestamp = timestamp;
+    stats->polls++;
+
+    MEMORY_BARRIER();
+    poll_stats->sequence++;
+}
+
+// Copies the statistics into stats, which must be accessible to the current k1.
+// Returns false if every attempt was torn by a poll.
+bool poll_stats_read(const PollStats *poll_stats, EmuCtrlPollStats *stats);
+
+#endif
+
+#endif /* POLL_STATS_H */
@@ -0,0 +1,19 @@
+// PSP-EmulatedControllerTest
+// Pressure synthesis stage of the input pipeline. See pressure.h.
+//
+// Ryan Crosby 2025
+
+#include "pressure.h"
+#include "common.h"
+
+// The pressure of a stick-driven D-pad direction for a raw axis value, towards whichever side the value is on.
+// Generated by the preprocessor like the direction tables.
+#define DPAD_PRESSURE_MAGNITUDE(value) \
+    ((int)(value) >= SCE_CTRL_ANALOG_PAD_CENTER_VALUE ? (int)(value) - SCE_CTRL_ANALOG_PAD_CENTER_VALUE : SCE_CTRL_ANALOG_PAD_CENTER_VALUE - (int)(value))
+#define DPAD_PRESSURE_SCALE(magnitude) \
+    (DPAD_PRESSURE_MIN + ((magnitude) - ANALOG_PAD_DIRECTION_RELEASE_THRESHOLD) * (255 - DPAD_PRESSURE_MIN) / (127 - ANALOG_PAD_DIRECTION_RELEASE_THRESHOLD))
+#define DPAD_PRESSURE(value) \
+    (DPAD_PRESSURE_MAGNITUDE(value) <= ANALOG_PAD_DIRECTION_RELEASE_THRESHOLD ? DPAD_PRESSURE_MIN : \
+     DPAD_PRESSURE_MAGNITUDE(value) >= 127 ? 255 : DPAD_PRESSURE_SCALE(DPAD_PRESSURE_MAGNITUDE(value)))
+
+const u8 g_dpad_pressure_lut[256] = { LUT256(DPAD_PRESSURE) };
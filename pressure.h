@@ -0,0 +1,111 @@
+// PSP-EmulatedControllerTest
+// Pressure synthesis stage of the input pipeline.
+//
+// Ryan Crosby 2025
+//
+// The pressure fields of SceCtrlData2 each hold two buttons, in bytes 1 and 3 of the word according to
+// ctrl_imports.h. Nothing we have says whether those count from 0 or 1, so they are read the way byte offsets
+// are everywhere else, from 0: the high bytes of the word's two 16-bit halves, packed as
+// (first << 8) | (second << 24). SENSE_FIELD_SHIFT is the one place to change should that turn out wrong.
+//
+// Each half is worked on as a 16-bit lane holding a 0 - 255 pressure in its low byte. The spare high byte
+// of every lane absorbs the carry of a single add, so both buttons of a field are updated at once with
+// word-wide operations, and the field is shifted into place and written with a single store.
+
+#ifndef PRESSURE_H
+#define PRESSURE_H
+
+#include "ctrl_imports.h"
+#include "config.h"
+
+#define SENSE_LANE_ONES (0x00010001)
+#define SENSE_LANE_BYTES (0x00FF00FF)
+
+// How far the lanes are shifted up into the bytes of the pressure fields.
+#define SENSE_FIELD_SHIFT (8)
+
+// The pressure of a stick-driven D-pad direction, indexed by the raw axis value.
+extern const u8 g_dpad_pressure_lut[256];
+
+// Pressure state carried between handler invocations.
+typedef struct {
+    // The ramped pressure of the face and shoulder buttons on the previous poll, packed like the
+    // GPadSenseA, GPadSenseB, AxisSenseA and AxisSenseB lanes. Released buttons are 0.
+    u32 button_ramp[4];
+} PressureState;
+
+// Returns a mask covering the lane of each of the two buttons that is set in buttons.
+static inline
+u32 sense_lanes(u32 buttons, u32 first, u32 second)
+{
+    return ((buttons & first) ? 0x0000FFFF : 0) | ((buttons & second) ? 0xFFFF0000 : 0);
+}
+
+// The pressure lanes of a pair of D-pad directions.
+// stick_buttons are the directions currently produced by the stick, which report stick_pressure.
+static inline
+u32 dpad_pressure(u32 buttons, u32 stick_buttons, u32 stick_pressure, u32 first, u32 second)
+{
+    u32 held = sense_lanes(buttons, first, second);
+    u32 from_stick = sense_lanes(buttons & stick_buttons, first, second);
+
+    return (stick_pressure * SENSE_LANE_ONES & from_stick) | (SENSE_LANE_BYTES & held & ~from_stick);
+}
+
+// Advances the pressure ramp lanes of a pair of digital buttons by one poll, and returns them.
+static inline
+u32 ramp_button_pressure(u32 *ramp, u32 buttons, u32 first, u32 second)
+{
+    u32 held = sense_lanes(buttons, first, second);
+    u32 lanes = *ramp;
+
+    // Step every lane, saturating at 255. A lane is at most 0x1FE after the add, so bit 8 flags the overflow.
+    u32 stepped = lanes + BUTTON_PRESSURE_RAMP_STEP * SENSE_LANE_ONES;
+    u32 overflow = (stepped >> 8) & SENSE_LANE_ONES;
+    stepped = (stepped | overflow * 0xFF) & SENSE_LANE_BYTES;
+
+    // Lanes that were released on the previous poll start over from the ramp start instead
+    u32 ramping = (((lanes + SENSE_LANE_BYTES) >> 8) & SENSE_LANE_ONES) * 0xFFFF;
+    u32 next = (stepped & ramping) | (BUTTON_PRESSURE_RAMP_START * SENSE_LANE_ONES & ~ramping);
+
+    *ramp = next & held;
+    return *ramp;
+}
+
+// Fills in the pressure fields for the final buttons of the frame. padX and padY are the raw PSP stick
+// position, and stick_buttons the D-pad directions it produced on this poll.
+//
+// Pressure fields the injected frame already set are left alone, the ramps still advance underneath them.
+static inline
+void synthesize_pressure(PressureState *state, u32 stick_buttons, u8 padX, u8 padY, SceCtrlData2 *pDst)
+{
+    u32 buttons = pDst->buttons;
+
+    u32 dpad_a = dpad_pressure(buttons, stick_buttons, g_dpad_pressure_lut[padX], SCE_CTRL_RIGHT, SCE_CTRL_LEFT);
+    u32 dpad_b = dpad_pressure(buttons, stick_buttons, g_dpad_pressure_lut[padY], SCE_CTRL_UP, SCE_CTRL_DOWN);
+    u32 gpad_a = ramp_button_pressure(&state->button_ramp[0], buttons, SCE_CTRL_TRIANGLE, SCE_CTRL_CIRCLE);
+    u32 gpad_b = ramp_button_pressure(&state->button_ramp[1], buttons, SCE_CTRL_CROSS, SCE_CTRL_SQUARE);
+    u32 axis_a = ramp_button_pressure(&state->button_ramp[2], buttons, SCE_CTRL_L1TRIGGER, SCE_CTRL_R1TRIGGER);
+    u32 axis_b = ramp_button_pressure(&state->button_ramp[3], buttons, SCE_CTRL_LTRIGGER, SCE_CTRL_RTRIGGER);
+
+    if(pDst->DPadSenseA == 0) {
+        pDst->DPadSenseA = dpad_a << SENSE_FIELD_SHIFT;
+    }
+    if(pDst->DPadSenseB == 0) {
+        pDst->DPadSenseB = dpad_b << SENSE_FIELD_SHIFT;
+    }
+    if(pDst->GPadSenseA == 0) {
+        pDst->GPadSenseA = gpad_a << SENSE_FIELD_SHIFT;
+    }
+    if(pDst->GPadSenseB == 0) {
+        pDst->GPadSenseB = gpad_b << SENSE_FIELD_SHIFT;
+    }
+    if(pDst->AxisSenseA == 0) {
+        pDst->AxisSenseA = axis_a << SENSE_FIELD_SHIFT;
+    }
+    if(pDst->AxisSenseB == 0) {
+        pDst->AxisSenseB = axis_b << SENSE_FIELD_SHIFT;
+    }
+}
+
+#endif /* PRESSURE_H */
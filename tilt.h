@@ -0,0 +1,95 @@
+// PSP-EmulatedControllerTest
+// Tilt synthesis stage of the input pipeline.
+//
+// Ryan Crosby 2025
+//
+// The DS3 tilt values are produced from TILT_SOURCE and smoothed by an integer low-pass filter.
+// The whole stage runs on every poll, so it only consists of inline functions.
+
+#ifndef TILT_H
+#define TILT_H
+
+#include "ctrl_imports.h"
+#include "config.h"
+
+#include <stdbool.h>
+
+#if TILT_SOURCE != TILT_SOURCE_NONE
+
+// The filter state is Q16 fixed point, so the slow tail of the filter response doesn't get lost to rounding.
+#define TILT_FILTER_FRACTION_BITS (16)
+
+// Filter state carried between handler invocations.
+typedef struct {
+    // The output of each filter stage, for the x and y axes.
+    s32 stage[TILT_FILTER_ORDER][2];
+} TiltFilterState;
+
+// Advances one first-order low-pass stage by one poll: y += (x - y) / 2^TILT_FILTER_SHIFT
+static inline
+s32 tilt_filter_step(s32 *stage, s32 input)
+{
+    *stage += (input - *stage) >> TILT_FILTER_SHIFT;
+    return *stage;
+}
+
+// True if the filter is at rest: another poll at zero tilt wouldn't move any stage. The stages can come to
+// rest slightly off zero, below the resolution of the output.
+static inline
+bool tilt_filter_settled(const TiltFilterState *state)
+{
+    for(u32 axis = 0; axis < 2; axis++) {
+        s32 input = 0;
+        for(u32 i = 0; i < TILT_FILTER_ORDER; i++) {
+            if(((input - state->stage[i][axis]) >> TILT_FILTER_SHIFT) != 0) {
+                return false;
+            }
+            input = state->stage[i][axis];
+        }
+    }
+
+    return true;
+}
+
+// Fills in the tilt fields from the configured source, smoothed by the tilt filter.
+// pad_state may be NULL if no PSP sample was available for this cycle, the tilt then returns to rest.
+//
+// Tilt fields the injected frame already set are left alone, the filter still advances underneath them.
+static inline
+void synthesize_tilt(TiltFilterState *state, const SceCtrlData *pad_state, SceCtrlData2 *pDst)
+{
+    s32 target[2] = { 0, 0 };
+
+    if(pad_state != NULL) {
+#if TILT_SOURCE == TILT_SOURCE_STICK
+        target[0] = (((s32)pad_state->aX - SCE_CTRL_ANALOG_PAD_CENTER_VALUE) * TILT_FULL_SCALE) >> 7;
+        target[1] = (((s32)pad_state->aY - SCE_CTRL_ANALOG_PAD_CENTER_VALUE) * TILT_FULL_SCALE) >> 7;
+#elif TILT_SOURCE == TILT_SOURCE_BUTTONS
+        u32 buttons = pad_state->buttons;
+        target[0] = ((buttons & TILT_BUTTON_RIGHT) ? TILT_FULL_SCALE : 0) - ((buttons & TILT_BUTTON_LEFT) ? TILT_FULL_SCALE : 0);
+        target[1] = ((buttons & TILT_BUTTON_DOWN) ? TILT_FULL_SCALE : 0) - ((buttons & TILT_BUTTON_UP) ? TILT_FULL_SCALE : 0);
+#else
+#error "Unknown TILT_SOURCE"
+#endif
+    }
+
+    s32 tilt[2];
+    for(u32 axis = 0; axis < 2; axis++) {
+        s32 value = target[axis] << TILT_FILTER_FRACTION_BITS;
+        for(u32 i = 0; i < TILT_FILTER_ORDER; i++) {
+            value = tilt_filter_step(&state->stage[i][axis], value);
+        }
+        tilt[axis] = (value + (1 << (TILT_FILTER_FRACTION_BITS - 1))) >> TILT_FILTER_FRACTION_BITS;
+    }
+
+    if(pDst->TiltA == 0) {
+        pDst->TiltA = tilt[0];
+    }
+    if(pDst->TiltB == 0) {
+        pDst->TiltB = tilt[1];
+    }
+}
+
+#endif
+
+#endif /* TILT_H */
@@ -0,0 +1,40 @@
+// PSP-EmulatedControllerTest
+// Turbo (rapid fire) stage of the input pipeline. See turbo.h.
+//
+// Ryan Crosby 2025
+
+#include "turbo.h"
+#include "config.h"
+#include "common.h"
+
+static TurboConfig g_turbo_configs[2];
+TurboConfig * volatile g_turbo_config_active = &g_turbo_configs[0];
+
+static const TurboSetting g_turbo_defaults[] = {
+    TURBO_DEFAULTS
+    { 0, 0, 0 }
+};
+
+void turbo_configure(u32 buttons, u32 on_polls, u32 off_polls)
+{
+    const TurboConfig *current = g_turbo_config_active;
+    TurboConfig *next = current == &g_turbo_configs[0] ? &g_turbo_configs[1] : &g_turbo_configs[0];
+
+    buttons &= TURBO_BUTTONS_MASK;
+    next->mask = on_polls != 0 ? (current->mask | buttons) : (current->mask & ~buttons);
+
+    for(u32 i = 0; i < TURBO_PERIOD_BITS; i++) {
+        next->on_period[i] = (current->on_period[i] & ~buttons) | (((on_polls >> i) & 1) ? buttons : 0);
+        next->off_period[i] = (current->off_period[i] & ~buttons) | (((off_polls >> i) & 1) ? buttons : 0);
+    }
+
+    MEMORY_BARRIER();
+    g_turbo_config_active = next;
+}
+
+void turbo_configure_defaults(void)
+{
+    for(const TurboSetting *turbo = g_turbo_defaults; turbo->buttons != 0; turbo++) {
+        turbo_configure(turbo->buttons, turbo->on_polls, turbo->off_polls);
+    }
+}
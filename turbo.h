@@ -0,0 +1,99 @@
+// PSP-EmulatedControllerTest
+// Turbo (rapid fire) stage of the input pipeline.
+//
+// Ryan Crosby 2025
+//
+// Turbo state and settings are held bit-sliced: bit n of every word belongs to button bit n, and
+// word i holds bit i of that button's counter or period. This updates the counters of every button
+// at once with a handful of word-wide operations per counter bit, rather than looping over buttons.
+
+#ifndef TURBO_H
+#define TURBO_H
+
+#include "ctrl_imports.h"
+
+// The number of bits in each turbo phase counter, which limits the on and off periods.
+#define TURBO_PERIOD_BITS (4)
+#define TURBO_MAX_PERIOD ((1 << TURBO_PERIOD_BITS) - 1)
+
+// Turbo can only be applied to the 16 user buttons.
+#define TURBO_BUTTONS_MASK (0x0000FFFF)
+
+typedef struct {
+    // The buttons turbo applies to.
+    u32 mask;
+    u32 on_period[TURBO_PERIOD_BITS];
+    u32 off_period[TURBO_PERIOD_BITS];
+} TurboConfig;
+
+typedef struct {
+    // The number of polls each button has spent in its current phase.
+    u32 counter[TURBO_PERIOD_BITS];
+    // Set for buttons in their off phase.
+    u32 off_phase;
+} TurboState;
+
+typedef struct {
+    u32 buttons;
+    u32 on_polls;
+    u32 off_polls;
+} TurboSetting;
+
+// The config the controller callback applies. Double buffered like the button remap tables, so the callback
+// never sees a half written config.
+extern TurboConfig * volatile g_turbo_config_active;
+
+// Sets the periods of the given buttons, and publishes the result. on_polls == 0 disables turbo for them.
+// Only called with the configuration writer lock held, or before the controller callback is registered.
+void turbo_configure(u32 buttons, u32 on_polls, u32 off_polls);
+
+// Sets up the TURBO_DEFAULTS. Called once before the controller callback is registered.
+void turbo_configure_defaults(void);
+
+// Applies turbo to the held buttons and advances the phase counters by one poll.
+static inline
+u32 apply_turbo(TurboState *state, u32 buttons)
+{
+    const TurboConfig *config = g_turbo_config_active;
+    u32 active = config->mask & buttons;
+
+    // With no turbo button held, every button is back in its on phase with a zero count. Clearing the state
+    // is all the full update below would do.
+    if(active == 0) {
+        state->off_phase = 0;
+        for(u32 i = 0; i < TURBO_PERIOD_BITS; i++) {
+            state->counter[i] = 0;
+        }
+        return buttons;
+    }
+
+    // Released buttons restart in their on phase with a zero count.
+    // The output uses the phase as it stood before this poll's count.
+    u32 off_phase = state->off_phase & active;
+    u32 result = buttons & ~off_phase;
+
+    // Bit-sliced increment of the active counters
+    u32 carry = active;
+    for(u32 i = 0; i < TURBO_PERIOD_BITS; i++) {
+        u32 counter = state->counter[i] & active;
+        state->counter[i] = counter ^ carry;
+        carry &= counter;
+    }
+
+    // Bit-sliced compare against the period of each button's current phase
+    u32 period_reached = active;
+    for(u32 i = 0; i < TURBO_PERIOD_BITS; i++) {
+        u32 period = (config->on_period[i] & ~off_phase) | (config->off_period[i] & off_phase);
+        period_reached &= ~(state->counter[i] ^ period);
+    }
+
+    // Flip the phase and restart the count of every button that completed its period
+    state->off_phase = off_phase ^ period_reached;
+    for(u32 i = 0; i < TURBO_PERIOD_BITS; i++) {
+        state->counter[i] &= ~period_reached;
+    }
+
+    return result;
+}
+
+#endif /* TURBO_H */